@@ -12,6 +12,9 @@
 #define PAGE_SIZE_4K    (1ull << PAGE_SHIFT_4K)
 #define PAGE_MASK_4K    (PAGE_SIZE_4K - 1)
 #define ENTRIES_PER_PT  512u
+#define PAGE_SHIFT_2M   21u
+#define PAGE_SIZE_2M    (1ull << PAGE_SHIFT_2M)
+#define PAGE_MASK_2M    (PAGE_SIZE_2M - 1)
 
 // 物理/仮想アドレス表現
 typedef uint64_t Phys;
@@ -154,6 +157,44 @@ static PtEntry* l1_entry_for_va(uint64_t va) {
     return &l1[idx_lv1(va)];
 }
 
+// va を含む 2MiB ページの Lv2 エントリ（2MiB でマップされていなければ NULL）
+static PtEntry* l2_leaf_for_va(uint64_t va) {
+    PtEntry *l4 = get_lv4_table(read_cr3());
+    PtEntry e4 = l4[idx_lv4(va)];
+    if (!e4.present) return NULL;
+
+    PtEntry *l3 = get_lv3_table(entry_addr(&e4));
+    PtEntry e3 = l3[idx_lv3(va)];
+    if (!e3.present || e3.ps) return NULL;
+
+    PtEntry *l2 = get_lv2_table(entry_addr(&e3));
+    PtEntry *e2 = &l2[idx_lv2(va)];
+    return (e2->present && e2->ps) ? e2 : NULL;
+}
+
+// 2MiB ページを同じ物理・同じ属性の 4KiB × 512 に割る
+static EFI_STATUS split_2m(PtEntry *e2, uint64_t va) {
+    PtEntry big = *e2;
+    PtEntry tbl = {0};
+    EFI_STATUS st = alloc_new_table(&tbl);
+    if (EFI_ERROR(st)) return st;
+
+    PtEntry *l1 = get_lv1_table(entry_addr(&tbl));
+    Phys base = entry_addr(&big) & ~PAGE_MASK_2M;
+    for (UINTN i = 0; i < (UINTN)ENTRIES_PER_PT; ++i) {
+        PtEntry e = {0};
+        e.present = 1;
+        e.rw      = big.rw;
+        e.ps      = 1;
+        e.xd      = big.xd;
+        entry_set_phys(&e, base + (Phys)i * PAGE_SIZE_4K);
+        l1[i] = e;
+    }
+    *e2 = tbl;                       // テーブル参照は RW・実行可（制限は Lv1 側）
+    invlpg(va & ~PAGE_MASK_2M);      // 2MiB の TLB エントリを捨てる
+    return EFI_SUCCESS;
+}
+
 EFI_STATUS page_set_attr_4k(uint64_t vaddr, PageAttr attr) {
     PtEntry *l1 = l1_entry_for_va(vaddr);
     if (!l1 || !l1->present || !l1->ps) return EFI_NOT_FOUND;
@@ -165,9 +206,21 @@ EFI_STATUS page_set_attr_4k(uint64_t vaddr, PageAttr attr) {
 EFI_STATUS page_apply_attr_range(uint64_t vaddr, uint64_t size, PageAttr attr) {
     uint64_t start = vaddr & ~0xFFFULL;
     uint64_t end   = (vaddr + size + 0xFFFULL) & ~0xFFFULL;
-    for (uint64_t va = start; va < end; va += PAGE_SIZE_4K) {
+    for (uint64_t va = start; va < end; ) {
+        PtEntry *e2 = l2_leaf_for_va(va);
+        if (e2) {
+            if (!(va & PAGE_MASK_2M) && end - va >= PAGE_SIZE_2M) {
+                pte_apply_attr(e2, attr);    // 2MiB 丸ごと
+                invlpg(va);
+                va += PAGE_SIZE_2M;
+                continue;
+            }
+            EFI_STATUS st = split_2m(e2, va);
+            if (EFI_ERROR(st)) return st;
+        }
         EFI_STATUS st = page_set_attr_4k(va, attr);
         if (EFI_ERROR(st)) return st;
+        va += PAGE_SIZE_4K;
     }
     return EFI_SUCCESS;
 }
@@ -192,6 +245,7 @@ EFI_STATUS page_map4k_to(Virt virt, Phys phys, PageAttr attr)
         EFI_STATUS st = alloc_new_table(e3);
         if (EFI_ERROR(st)) return st;
     }
+    if (e3->ps) return EFI_ALREADY_STARTED;   // 1GiB ページの中
 
     Lv2Entry *lv2 = get_lv2_table(entry_addr(e3));
     PtEntry  *e2  = &lv2[idx_lv2(virt)];
@@ -199,6 +253,7 @@ EFI_STATUS page_map4k_to(Virt virt, Phys phys, PageAttr attr)
         EFI_STATUS st = alloc_new_table(e2);
         if (EFI_ERROR(st)) return st;
     }
+    if (e2->ps) return EFI_ALREADY_STARTED;   // 2MiB ページの中
 
     Lv1Entry *lv1 = get_lv1_table(entry_addr(e2));
     PtEntry  *e1  = &lv1[idx_lv1(virt)];
@@ -220,3 +275,43 @@ EFI_STATUS page_map4k_to(Virt virt, Phys phys, PageAttr attr)
     // non-present -> present なので TLB 全体 flush 不要（必要なら invlpg でもOK）
     return EFI_SUCCESS;
 }
+
+// ---- 2MiB ページをマップ（Lv2 に PS=1 で直接置く） ----
+EFI_STATUS page_map2m_to(Virt virt, Phys phys, PageAttr attr)
+{
+    if ((virt & PAGE_MASK_2M) || (phys & PAGE_MASK_2M))
+        return EFI_INVALID_PARAMETER;
+
+    Lv4Entry *lv4 = get_lv4_table(read_cr3());
+    PtEntry  *e4  = &lv4[idx_lv4(virt)];
+    if (!e4->present) {
+        EFI_STATUS st = alloc_new_table(e4);
+        if (EFI_ERROR(st)) return st;
+    }
+
+    Lv3Entry *lv3 = get_lv3_table(entry_addr(e4));
+    PtEntry  *e3  = &lv3[idx_lv3(virt)];
+    if (!e3->present) {
+        EFI_STATUS st = alloc_new_table(e3);
+        if (EFI_ERROR(st)) return st;
+    }
+    if (e3->ps) return EFI_ALREADY_STARTED;
+
+    Lv2Entry *lv2 = get_lv2_table(entry_addr(e3));
+    PtEntry  *e2  = &lv2[idx_lv2(virt)];
+    if (e2->present) {
+        // 2MiB ページ済み、または 4KiB 用の Lv1 がもう下がっている
+        return EFI_ALREADY_STARTED;
+    }
+
+    PtEntry new_e2 = {0};
+    new_e2.present = 1;
+    new_e2.rw      = 1;
+    new_e2.us      = 0;
+    new_e2.ps      = 1;   // Lv2 の PS=1 で 2MiB ページ（bit12 の PAT は 0 のまま）
+    entry_set_phys(&new_e2, phys);
+    pte_apply_attr(&new_e2, attr);
+
+    *e2 = new_e2;
+    return EFI_SUCCESS;
+}
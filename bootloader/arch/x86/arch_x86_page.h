@@ -16,7 +16,10 @@ typedef enum {
 
 EFI_STATUS page_set_lv4_writable(void);
 EFI_STATUS page_map4k_to(uint64_t vaddr, uint64_t paddr, PageAttr attr);
+// 2MiB ページ（Lv2 の PS=1）。vaddr / paddr とも 2MiB 境界
+EFI_STATUS page_map2m_to(uint64_t vaddr, uint64_t paddr, PageAttr attr);
 
 // 追加: 既存マップの保護だけ変える
 EFI_STATUS page_set_attr_4k(uint64_t vaddr, PageAttr attr);
+// 4KiB / 2MiB が混ざっていてよい。2MiB ページの一部だけにかかる場合はその 2MiB を 4KiB に割る
 EFI_STATUS page_apply_attr_range(uint64_t vaddr, uint64_t size, PageAttr attr);
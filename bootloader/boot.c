@@ -7,22 +7,39 @@
 #include "kernel_loader.h"
 #include "memmap.h"
 #include "bootinfo.h" 
+#include "boot_time.h"
+
+/* EFI Configuration Table から RSDP を探す（ACPI 2.0 を優先、無ければ 1.0） */
+static UINT64 find_acpi_rsdp(void)
+{
+    VOID *rsdp = NULL;
+    if (!EFI_ERROR(LibGetSystemConfigurationTable(&Acpi20TableGuid, &rsdp)) && rsdp)
+        return (UINT64)(UINTN)rsdp;
+    if (!EFI_ERROR(LibGetSystemConfigurationTable(&AcpiTableGuid, &rsdp)) && rsdp)
+        return (UINT64)(UINTN)rsdp;
+    return 0;
+}
 
 EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 {
+    boot_time_stamp("efi_main");
     InitializeLib(ImageHandle, SystemTable);
     log_init(SystemTable);
     log_set_scope(L"boot");
     log_set_level(LOG_DEBUG);
 
     if (!ST || !BS) return EFI_ABORTED;
+    boot_time_init();
 
     EFI_STATUS st = init_file();
     if (EFI_ERROR(st)) return st;
     OpenRoot();
+    boot_time_stamp("fs_init");
 
     UINT64 entry = 0;
-    st = load_kernel_elf(L"kernel.elf", &entry);
+    // 圧縮版（make の kernel.elf.lz4）を優先し、無ければ平文の ELF
+    st = load_kernel_elf(L"kernel.elf.lz4", &entry);
+    if (st == EFI_NOT_FOUND) st = load_kernel_elf(L"kernel.elf", &entry);
     if (EFI_ERROR(st)) {
         log_printf(LOG_ERROR, L"load_kernel_elf failed: %r", st);
         CloseRoot();
@@ -31,6 +48,11 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable
     }
 
     CloseRoot();
+    boot_time_stamp("elf_load");
+
+    // --- ACPI RSDP（AP 起動で MADT を読むため） ---
+    UINT64 acpi_rsdp = find_acpi_rsdp();
+    log_printf(LOG_INFO, L"ACPI RSDP @0x%lx", acpi_rsdp);
 
     // --- メモリマップを取得しておく（ExitBootServicesに必須） ---
     MEMORY_MAP mm;
@@ -41,16 +63,20 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable
     if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"GetMemoryMap failed: %r", st); goto halt; }
 
     memmap_print(&mm); // ここまではログ可
+    boot_time_stamp("memmap");
 
     // --- カーネルに渡す BootInfo を用意 ---
     BOOT_INFO bi = {
         .magic       = BOOTINFO_MAGIC,
         .memory_map  = mm,           // descriptors は LoaderData で確保済み。Exit後も内容は残る
+        .acpi_rsdp   = acpi_rsdp,
     };
 
     // --- ExitBootServices（以降はログ禁止） ---
     st = exit_boot_services_with_map(ImageHandle, &mm);
     if (EFI_ERROR(st)) goto halt_silent;
+    boot_time_stamp("exit_bs");
+    boot_time_export(&bi.timeline);
 
     // --- カーネルのエントリにジャンプ ---
     typedef void (*kernel_entry_t)(const BOOT_INFO *bi);
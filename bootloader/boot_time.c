@@ -0,0 +1,44 @@
+#include "boot_time.h"
+#include "asm_x86.h"
+#include "log.h"
+
+#define CALIB_STALL_US  10000u      /* 10ms */
+
+static UINT64 g_tsc_hz = 0;
+static BOOT_TIMELINE g_timeline;
+
+VOID boot_time_init(VOID)
+{
+    UINT64 t0 = rdtsc();
+    uefi_call_wrapper(BS->Stall, 1, (UINTN)CALIB_STALL_US);
+    UINT64 t1 = rdtsc();
+    g_tsc_hz = (t1 - t0) * (1000000u / CALIB_STALL_US);
+    log_printf(LOG_DEBUG, L"TSC ~%lu MHz (calibrated with Stall)", g_tsc_hz / 1000000u);
+}
+
+UINT64 boot_time_now(VOID) { return rdtsc(); }
+
+UINT64 boot_time_tsc_hz(VOID) { return g_tsc_hz; }
+
+UINT64 boot_time_to_us(UINT64 cycles)
+{
+    UINT64 per_us = g_tsc_hz / 1000000u;
+    return per_us ? cycles / per_us : 0;
+}
+
+VOID boot_time_stamp(CONST char *name)
+{
+    if (g_timeline.count >= BOOT_STAMP_MAX) return;
+    BOOT_STAMP *s = &g_timeline.stamp[g_timeline.count++];
+    s->tsc = rdtsc();
+    UINTN i = 0;
+    for (; name && name[i] && i < BOOT_STAMP_NAME_MAX - 1; ++i) s->name[i] = name[i];
+    s->name[i] = '\0';
+}
+
+VOID boot_time_export(BOOT_TIMELINE *out)
+{
+    if (!out) return;
+    g_timeline.tsc_hz = g_tsc_hz;
+    copy_bytes(out, &g_timeline, sizeof(*out));
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <efi.h>
+#include <efilib.h>
+#include <stdint.h>
+#include "bootinfo.h"
+
+/* ローダ内の時間計測（TSC）。周波数は BS->Stall を物差しにして較正する */
+VOID   boot_time_init(VOID);
+UINT64 boot_time_now(VOID);                   /* rdtsc */
+UINT64 boot_time_tsc_hz(VOID);                /* 未較正なら 0 */
+UINT64 boot_time_to_us(UINT64 cycles);        /* 未較正なら 0 */
+
+/* 起動タイムラインに区切りを打つ（rdtsc と名前を記録するだけ。ExitBootServices 後も可） */
+VOID   boot_time_stamp(CONST char *name);
+/* ここまでの区切りを BOOT_INFO へ写す（カーネルへ渡す直前に） */
+VOID   boot_time_export(BOOT_TIMELINE *out);
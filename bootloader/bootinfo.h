@@ -6,7 +6,25 @@
 
 #define BOOTINFO_MAGIC 0xDEADBEEFCAFEBABEull
 
+// 起動タイムライン：ローダ内の区切りごとの TSC（カーネルが続きを打って表にする）
+#define BOOT_STAMP_MAX       16
+#define BOOT_STAMP_NAME_MAX  16
+
+typedef struct {
+    UINT64 tsc;
+    char   name[BOOT_STAMP_NAME_MAX];   // ASCII、NUL 終端
+} BOOT_STAMP;
+
+typedef struct {
+    UINT32     count;
+    UINT32     reserved;
+    UINT64     tsc_hz;     // ローダの較正値（Stall 基準。0 なら未較正）
+    BOOT_STAMP stamp[BOOT_STAMP_MAX];
+} BOOT_TIMELINE;
+
 typedef struct {
     UINT64    magic;      // 検証用
     MEMORY_MAP memory_map; // ExitBootServices前に取得したメモリマップ
+    UINT64    acpi_rsdp;  // RSDP の物理アドレス（EFI Configuration Table から。無ければ 0）
+    BOOT_TIMELINE timeline; // efi_main から ExitBootServices までの区切り
 } BOOT_INFO;
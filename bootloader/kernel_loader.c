@@ -5,24 +5,43 @@
 #include "elf64.h"
 #include "file.h"
 #include "arch_x86_page.h"
+#include "asm_x86.h"
+#include "boot_time.h"
+#include "lz4.h"
 
 #define PAGE_SIZE_4K  4096ull
+#define PAGE_SIZE_2M  (2ull << 20)
+#define READ_CHUNK    (1ull << 20)   // 一括 Read を嫌うファームウェア向けの分割サイズ
 static inline uint64_t align_up(uint64_t x, uint64_t a)   { return (x + a - 1) & ~(a - 1); }
 static inline uint64_t align_down(uint64_t x, uint64_t a) { return x & ~(a - 1); }
 
-static EFI_STATUS file_read_at(EFI_FILE_HANDLE File, UINT64 offset, VOID *buf, UINTN size)
+// ファイル全体を buf へ。まず 1 回の Read で全部を要求し、
+// エラーなら残りを READ_CHUNK ずつ読み直す（短く返ってきた分は続きから読む）
+static EFI_STATUS file_read_whole(EFI_FILE_HANDLE File, VOID *buf, UINTN size, UINTN *out_calls)
 {
-    EFI_STATUS st = uefi_call_wrapper(File->SetPosition, 2, File, offset);
+    EFI_STATUS st = uefi_call_wrapper(File->SetPosition, 2, File, 0);
     if (EFI_ERROR(st)) return st;
 
-    UINTN done = 0;
+    UINTN done = 0, calls = 0;
+    UINTN req  = size;
     while (done < size) {
         UINTN chunk = size - done;
+        if (chunk > req) chunk = req;
         st = uefi_call_wrapper(File->Read, 3, File, &chunk, (UINT8*)buf + done);
-        if (EFI_ERROR(st)) return st;
+        ++calls;
+        if (EFI_ERROR(st)) {
+            if (req <= READ_CHUNK) return st;
+            log_printf(LOG_WARN, L"Read of %lu bytes failed (%r); retrying in chunks",
+                       (UINT64)req, st);
+            req = READ_CHUNK;
+            st = uefi_call_wrapper(File->SetPosition, 2, File, (UINT64)done);
+            if (EFI_ERROR(st)) return st;
+            continue;
+        }
         if (chunk == 0) break; // EOF
         done += chunk;
     }
+    if (out_calls) *out_calls = calls;
     return (done == size) ? EFI_SUCCESS : EFI_END_OF_FILE;
 }
 
@@ -38,15 +57,28 @@ static PageAttr attr_from_phdr(const Elf64_Phdr *p) {
 static PageAttr temp_attr_for_load(const Elf64_Phdr *p) {
     return (p->p_flags & PF_X) ? PAGE_RWX : PAGE_RW;
 }
-static EFI_STATUS map_segment_for_load(const Elf64_Phdr *p) {
+// VA と PA が 2MiB を法として揃っていれば、セグメント内に丸ごと入る 2MiB は 2MiB ページで張る
+// （前後の端数は 4KiB）。2MiB ページはセグメントの外にはみ出さないので属性も 1 つで済む
+static EFI_STATUS map_segment_for_load(const Elf64_Phdr *p, UINTN *n2m, UINTN *n4k) {
     uint64_t v = align_down(p->p_vaddr,  PAGE_SIZE_4K);
     uint64_t pa= align_down(p->p_paddr,  PAGE_SIZE_4K);
     uint64_t sz= align_up(p->p_memsz + (p->p_vaddr - v), PAGE_SIZE_4K);
     PageAttr  a= temp_attr_for_load(p);
+    bool huge  = ((v ^ pa) & (PAGE_SIZE_2M - 1)) == 0;
 
-    for (uint64_t off = 0; off < sz; off += PAGE_SIZE_4K) {
-        EFI_STATUS st = page_map4k_to(v + off, pa + off, a);
+    for (uint64_t off = 0; off < sz; ) {
+        EFI_STATUS st;
+        if (huge && ((v + off) & (PAGE_SIZE_2M - 1)) == 0 && sz - off >= PAGE_SIZE_2M) {
+            st = page_map2m_to(v + off, pa + off, a);
+            if (EFI_ERROR(st)) return st;
+            off += PAGE_SIZE_2M;
+            ++*n2m;
+            continue;
+        }
+        st = page_map4k_to(v + off, pa + off, a);
         if (EFI_ERROR(st)) return st;
+        off += PAGE_SIZE_4K;
+        ++*n4k;
     }
     return EFI_SUCCESS;
 }
@@ -57,66 +89,59 @@ static EFI_STATUS finalize_segment_protection(const Elf64_Phdr *p) {
     return page_apply_attr_range(v, sz, attr_from_phdr(p));
 }
 
-EFI_STATUS load_kernel_elf(CONST CHAR16 *filename, UINT64 *out_entry)
+// ELF ヘッダと PHDR を検証する。buf は ELF ストリームの先頭 len バイト
+// （平文ならファイル全体、LZ4 なら最初のブロック）。PHDR はプールへ写して返す
+static EFI_STATUS elf_read_headers(const UINT8 *buf, UINTN len, Elf64_Ehdr *eh, Elf64_Phdr **out_phdrs)
 {
-    if (!Root || !filename || !filename[0]) return EFI_INVALID_PARAMETER;
-
-    EFI_STATUS st;
-    EFI_FILE_HANDLE file = NULL;
-
-    // 0) 事前準備：Lv4 を writable に
-    st = page_set_lv4_writable();
-    if (EFI_ERROR(st)) {
-        log_printf(LOG_ERROR, L"setLv4Writable failed: %r", st);
-        return st;
-    }
-    log_printf(LOG_DEBUG, L"Set page table writable.");
+    if (len < sizeof(*eh)) return EFI_LOAD_ERROR;
+    copy_bytes(eh, buf, sizeof(*eh));
 
-    // 1) カーネルファイルを開く
-    st = uefi_call_wrapper(Root->Open, 5, Root, &file,
-                           (CHAR16*)filename, EFI_FILE_MODE_READ, 0);
-    if (EFI_ERROR(st) || !file) {
-        log_printf(LOG_ERROR, L"Open(%s) failed: %r", filename, st);
-        return st ? st : EFI_NOT_FOUND;
-    }
-    log_printf(LOG_INFO, L"Opened kernel file.");
-
-    // 2) ELF ヘッダを読む・検証
-    Elf64_Ehdr eh;
-    st = file_read_at(file, 0, &eh, sizeof(eh));
-    if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"Read ELF header failed: %r", st); goto cleanup; }
-
-    if (!(eh.e_ident[EI_MAG0]==0x7F && eh.e_ident[EI_MAG1]=='E' &&
-          eh.e_ident[EI_MAG2]=='L'  && eh.e_ident[EI_MAG3]=='F')) {
+    if (!(eh->e_ident[EI_MAG0]==0x7F && eh->e_ident[EI_MAG1]=='E' &&
+          eh->e_ident[EI_MAG2]=='L'  && eh->e_ident[EI_MAG3]=='F')) {
         log_printf(LOG_ERROR, L"ELF magic mismatch");
-        st = EFI_LOAD_ERROR; goto cleanup;
+        return EFI_LOAD_ERROR;
     }
-    if (eh.e_ident[EI_CLASS] != ELFCLASS64) {
+    if (eh->e_ident[EI_CLASS] != ELFCLASS64) {
         log_printf(LOG_ERROR, L"ELF is not 64-bit");
-        st = EFI_UNSUPPORTED; goto cleanup;
+        return EFI_UNSUPPORTED;
     }
 
     log_printf(LOG_INFO,  L"Parsed kernel ELF header.");
     log_printf(LOG_DEBUG, L"Kernel ELF information:");
-    log_printf(LOG_DEBUG, L"  Entry Point         : 0x%lx", (UINT64)eh.e_entry);
-    log_printf(LOG_DEBUG, L"  # of Program Headers: %u", eh.e_phnum);
+    log_printf(LOG_DEBUG, L"  Entry Point         : 0x%lx", (UINT64)eh->e_entry);
+    log_printf(LOG_DEBUG, L"  # of Program Headers: %u", eh->e_phnum);
+
+    const UINT64 ph_size = (UINT64)eh->e_phentsize * (UINT64)eh->e_phnum;
+    if (eh->e_phentsize != sizeof(Elf64_Phdr) || eh->e_phoff > len || ph_size > len - eh->e_phoff) {
+        log_printf(LOG_ERROR, L"PHDRs out of bounds (need them within the first %lu bytes)", (UINT64)len);
+        return EFI_LOAD_ERROR;
+    }
 
-    // 3) 全 Program Header を読む
-    const UINT64 ph_size = (UINT64)eh.e_phentsize * (UINT64)eh.e_phnum;
     Elf64_Phdr *phdrs = NULL;
-    st = uefi_call_wrapper(BS->AllocatePool, 3, EfiLoaderData, ph_size, (VOID**)&phdrs);
-    if (EFI_ERROR(st) || !phdrs) { st = st ? st : EFI_OUT_OF_RESOURCES; goto cleanup; }
+    EFI_STATUS st = uefi_call_wrapper(BS->AllocatePool, 3, EfiLoaderData, (UINTN)ph_size, (VOID**)&phdrs);
+    if (EFI_ERROR(st) || !phdrs) return st ? st : EFI_OUT_OF_RESOURCES;
+    copy_bytes(phdrs, buf + eh->e_phoff, ph_size);
 
-    st = file_read_at(file, eh.e_phoff, phdrs, (UINTN)ph_size);
-    if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"Read PHDRs failed: %r", st); goto cleanup_ph; }
+    for (UINTN i = 0; i < eh->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_LOAD && phdrs[i].p_filesz > phdrs[i].p_memsz) {
+            log_printf(LOG_ERROR, L"Segment filesz > memsz");
+            uefi_call_wrapper(BS->FreePool, 1, phdrs);
+            return EFI_LOAD_ERROR;
+        }
+    }
+    *out_phdrs = phdrs;
+    return EFI_SUCCESS;
+}
 
-    // 4) 必要な物理/仮想の範囲を計算（p_memsz==0 は無視）
+// 全 PT_LOAD の物理範囲をまとめて確保し、仮想アドレスへマップする（p_memsz==0 は無視）
+static EFI_STATUS alloc_and_map_segments(const Elf64_Ehdr *eh, const Elf64_Phdr *phdrs)
+{
     UINT64 k_phys_start = ~0ull;
     UINT64 k_phys_end   = 0ull;
     UINT64 k_virt_start = ~0ull;
 
-    for (UINTN i = 0; i < eh.e_phnum; ++i) {
-        Elf64_Phdr *p = &phdrs[i];
+    for (UINTN i = 0; i < eh->e_phnum; ++i) {
+        const Elf64_Phdr *p = &phdrs[i];
         if (p->p_type != PT_LOAD) continue;
         if (p->p_memsz == 0)      continue;  // ★重要：空の LOAD を無視
 
@@ -129,14 +154,14 @@ EFI_STATUS load_kernel_elf(CONST CHAR16 *filename, UINT64 *out_entry)
         if (seg_virt_lo < k_virt_start) k_virt_start = seg_virt_lo;
     }
 
-    if (k_phys_start == ~0ull) { st = EFI_LOAD_ERROR; goto cleanup_ph; }
+    if (k_phys_start == ~0ull) return EFI_LOAD_ERROR;
 
-    // 5) 連続で確保（AllocateAddress）
+    // 連続で確保（AllocateAddress）
     UINT64 bytes = k_phys_end - k_phys_start;
     UINTN  pages = (UINTN)(bytes / PAGE_SIZE_4K);
 
     EFI_PHYSICAL_ADDRESS alloc_addr = (EFI_PHYSICAL_ADDRESS)k_phys_start;
-    st = uefi_call_wrapper(
+    EFI_STATUS st = uefi_call_wrapper(
             BS->AllocatePages, 4,
             AllocateAddress,            // 指定アドレスちょうどで
             EfiLoaderData,              // タイプはローダ用データ
@@ -145,46 +170,138 @@ EFI_STATUS load_kernel_elf(CONST CHAR16 *filename, UINT64 *out_entry)
     );
     if (EFI_ERROR(st) || alloc_addr != (EFI_PHYSICAL_ADDRESS)k_phys_start) {
         log_printf(LOG_ERROR, L"AllocatePages(AllocateAddress) failed: %r", st);
-        goto cleanup_ph;
+        return EFI_ERROR(st) ? st : EFI_OUT_OF_RESOURCES;
     }
     log_printf(LOG_INFO, L"Allocated kernel image pages: start=0x%lx pages=%lu",
             k_phys_start, (UINT64)pages);
 
-    // 6) 仮想アドレスへマップ（PT_LOADごと、p_memsz==0 は無視）
-    for (UINTN i = 0; i < eh.e_phnum; ++i) {
-        Elf64_Phdr *p = &phdrs[i];
+    UINTN n2m = 0, n4k = 0;
+    for (UINTN i = 0; i < eh->e_phnum; ++i) {
+        const Elf64_Phdr *p = &phdrs[i];
         if (p->p_type != PT_LOAD) continue;
         if (p->p_memsz == 0)      continue;
-        EFI_STATUS st = map_segment_for_load(p);
+        st = map_segment_for_load(p, &n2m, &n4k);
         if (EFI_ERROR(st)) {
             log_printf(LOG_ERROR, L"map_segment_for_load failed: %r", st);
-            goto cleanup_ph;
+            return st;
         }
     }
-    log_printf(LOG_INFO, L"Mapped memory for kernel image.");
+    log_printf(LOG_INFO, L"Mapped memory for kernel image: %lu x 2MiB + %lu x 4KiB pages.",
+               (UINT64)n2m, (UINT64)n4k);
+    return EFI_SUCCESS;
+}
+
+// ELF ファイルの [off, off+len) の内容を、重なる PT_LOAD の物理アドレスへ直接写す
+static VOID scatter_to_segments(const Elf64_Ehdr *eh, const Elf64_Phdr *phdrs,
+                                UINT64 off, const UINT8 *data, UINTN len)
+{
+    for (UINTN i = 0; i < eh->e_phnum; ++i) {
+        const Elf64_Phdr *p = &phdrs[i];
+        if (p->p_type != PT_LOAD || p->p_filesz == 0) continue;
+        UINT64 lo = (off > p->p_offset) ? off : p->p_offset;
+        UINT64 hi = off + len;
+        if (hi > p->p_offset + p->p_filesz) hi = p->p_offset + p->p_filesz;
+        if (lo >= hi) continue;
+        copy_bytes((VOID*)(uintptr_t)(p->p_paddr + (lo - p->p_offset)), data + (lo - off), hi - lo);
+    }
+}
+
+// カーネルイメージを読む。中身が LZ4 フレームなら展開しながら、平文の ELF ならそのまま配置する
+// （ファイル名ではなく先頭の magic で判別する）
+EFI_STATUS load_kernel_elf(CONST CHAR16 *filename, UINT64 *out_entry)
+{
+    if (!Root || !filename || !filename[0]) return EFI_INVALID_PARAMETER;
+
+    EFI_STATUS st;
+    EFI_FILE_HANDLE file = NULL;
+    UINT8 *img = NULL;
+    Elf64_Phdr *phdrs = NULL;
+    LZ4_FRAME lz = { 0 };
+
+    // 1) カーネルファイルを開く（無ければ呼び出し側が別名を試す）
+    st = uefi_call_wrapper(Root->Open, 5, Root, &file,
+                           (CHAR16*)filename, EFI_FILE_MODE_READ, 0);
+    if (st == EFI_NOT_FOUND) {
+        log_printf(LOG_INFO, L"%s not found", filename);
+        return st;
+    }
+    if (EFI_ERROR(st) || !file) {
+        log_printf(LOG_ERROR, L"Open(%s) failed: %r", filename, st);
+        return st ? st : EFI_NOT_FOUND;
+    }
+    log_printf(LOG_INFO, L"Opened kernel file %s.", filename);
+    boot_time_stamp("kernel_open");
 
-    // 7) 各 PT_LOAD をファイルからロード + .bss を 0 埋め
+    // 2) 事前準備：Lv4 を writable に
+    st = page_set_lv4_writable();
+    if (EFI_ERROR(st)) {
+        log_printf(LOG_ERROR, L"setLv4Writable failed: %r", st);
+        goto cleanup;
+    }
+    log_printf(LOG_DEBUG, L"Set page table writable.");
+
+    // 3) ファイル全体を 1 つのプールバッファへ
+    UINT64 t_start = boot_time_now();
+    EFI_FILE_INFO *info = LibFileInfo(file);
+    if (!info) { log_printf(LOG_ERROR, L"GetInfo(%s) failed", filename); st = EFI_LOAD_ERROR; goto cleanup; }
+    UINTN img_size = (UINTN)info->FileSize;
+    uefi_call_wrapper(BS->FreePool, 1, info);
+
+    if (img_size < sizeof(Elf64_Ehdr)) { st = EFI_LOAD_ERROR; goto cleanup; }
+    st = uefi_call_wrapper(BS->AllocatePool, 3, EfiLoaderData, img_size, (VOID**)&img);
+    if (EFI_ERROR(st) || !img) { st = st ? st : EFI_OUT_OF_RESOURCES; goto cleanup; }
+
+    UINTN read_calls = 0;
+    st = file_read_whole(file, img, img_size, &read_calls);
+    if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"Read kernel image failed: %r", st); goto cleanup; }
+    UINT64 t_read = boot_time_now();
+    boot_time_stamp("kernel_read");
+
+    // 4) ELF ストリームの先頭を得る（平文：ファイル全体 / LZ4：最初のブロック）
+    const bool packed = lz4_is_frame(img, img_size);
+    const UINT8 *chunk = img;
+    UINTN chunk_len = img_size;
+    if (packed) {
+        st = lz4_frame_open(&lz, img, img_size);
+        if (!EFI_ERROR(st)) st = lz4_frame_next(&lz, &chunk, &chunk_len);
+        if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"LZ4 decode failed: %r", st); goto cleanup; }
+    }
+
+    Elf64_Ehdr eh;
+    st = elf_read_headers(chunk, chunk_len, &eh, &phdrs);
+    if (EFI_ERROR(st)) goto cleanup;
+
+    // 5) 物理ページ確保 + マップ
+    st = alloc_and_map_segments(&eh, phdrs);
+    if (EFI_ERROR(st)) goto cleanup;
+
+    // 6) ストリームを順に PT_LOAD の物理アドレスへ（LZ4 はブロックごとに展開しながら）
     log_printf(LOG_INFO, L"Loading kernel image...");
+    UINT64 t_place = boot_time_now();
+    UINT64 elf_size = 0;
+    while (chunk_len) {
+        scatter_to_segments(&eh, phdrs, elf_size, chunk, chunk_len);
+        elf_size += chunk_len;
+        if (!packed) break;
+        st = lz4_frame_next(&lz, &chunk, &chunk_len);
+        if (EFI_ERROR(st)) { log_printf(LOG_ERROR, L"LZ4 decode failed: %r", st); goto cleanup; }
+    }
+    UINT64 t_placed = boot_time_now();
+
+    // 7) ファイル範囲の確認 + .bss を 0 埋め
     for (UINTN i = 0; i < eh.e_phnum; ++i) {
         Elf64_Phdr *p = &phdrs[i];
         if (p->p_type != PT_LOAD) continue;
         if (p->p_memsz == 0)      continue;
 
-        if (p->p_filesz > 0) {
-            st = file_read_at(file, p->p_offset,
-                            (VOID*)(uintptr_t)p->p_paddr,
-                            (UINTN)p->p_filesz);
-            if (EFI_ERROR(st)) {
-                log_printf(LOG_ERROR, L"Read segment failed: %r", st);
-                goto cleanup_ph;
-            }
+        if (p->p_filesz > 0 && (p->p_offset > elf_size || p->p_filesz > elf_size - p->p_offset)) {
+            log_printf(LOG_ERROR, L"Segment out of file bounds");
+            st = EFI_LOAD_ERROR; goto cleanup;
         }
         // BSS を 0 埋め（p_paddr + filesz から）
         if (p->p_memsz > p->p_filesz) {
-            uefi_call_wrapper(BS->SetMem, 3,
-                (VOID*)(uintptr_t)(p->p_paddr + p->p_filesz),
-                (UINTN)(p->p_memsz - p->p_filesz),
-                0);
+            fill_bytes((VOID*)(uintptr_t)(p->p_paddr + p->p_filesz), 0,
+                       p->p_memsz - p->p_filesz);
         }
         log_printf(LOG_INFO, L"  Seg @ 0x%lx - 0x%lx",
                 (UINT64)p->p_vaddr, (UINT64)(p->p_vaddr + p->p_memsz));
@@ -193,20 +310,32 @@ EFI_STATUS load_kernel_elf(CONST CHAR16 *filename, UINT64 *out_entry)
     for (UINTN i = 0; i < eh.e_phnum; ++i) {
         Elf64_Phdr *p = &phdrs[i];
         if (p->p_type != PT_LOAD) continue;
-        EFI_STATUS st = finalize_segment_protection(p);
+        st = finalize_segment_protection(p);
         if (EFI_ERROR(st)) {
             log_printf(LOG_ERROR, L"finalize_segment_protection failed: %r", st);
-            goto cleanup_ph;
+            goto cleanup;
         }
     }
 
+    UINT64 t_end = boot_time_now();
+    log_printf(LOG_INFO, L"Kernel loaded: %lu bytes in %lu Read call(s), read %lu us, total %lu us",
+               (UINT64)img_size, (UINT64)read_calls,
+               boot_time_to_us(t_read - t_start), boot_time_to_us(t_end - t_start));
+    if (packed) {
+        // 展開時間は PT_LOAD への書き込みを含む（展開しながら置くので分けられない）
+        UINT64 dec_us = boot_time_to_us(t_placed - t_place);
+        log_printf(LOG_INFO, L"LZ4: %lu -> %lu bytes, decode %lu us (%lu MiB/s)",
+                   (UINT64)img_size, elf_size, dec_us,
+                   dec_us ? (elf_size * 1000000ull / dec_us) >> 20 : 0ull);
+    }
 
     if (out_entry) *out_entry = eh.e_entry;
     st = EFI_SUCCESS;
 
-cleanup_ph:
-    if (phdrs) uefi_call_wrapper(BS->FreePool, 1, phdrs);
 cleanup:
+    lz4_frame_close(&lz);
+    if (phdrs) uefi_call_wrapper(BS->FreePool, 1, phdrs);
+    if (img)   uefi_call_wrapper(BS->FreePool, 1, img);
     if (file)  uefi_call_wrapper(file->Close, 1, file);
     return st;
 }
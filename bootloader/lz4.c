@@ -0,0 +1,286 @@
+#include "lz4.h"
+#include "asm_x86.h"
+#include "log.h"
+
+// FLG / BD（https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md）
+#define FLG_VERSION_MASK   0xC0
+#define FLG_VERSION_01     0x40
+#define FLG_BLOCK_INDEP    0x20
+#define FLG_BLOCK_CSUM     0x10
+#define FLG_CONTENT_SIZE   0x08
+#define FLG_CONTENT_CSUM   0x04
+#define FLG_RESERVED       0x02
+#define FLG_DICT_ID        0x01
+#define BD_RESERVED        0x8F
+
+#define BLOCK_RAW          0x80000000u   // 圧縮せずに格納されたブロック
+#define LZ4_HIST           (64u * 1024)  // マッチが遡れる最大距離
+#define MIN_MATCH          4
+#define SHORT_COPY         16            // これ未満は rep movsb の立ち上がりの方が高い
+
+static inline UINT32 rd32(const UINT8 *p)
+{
+    return (UINT32)p[0] | ((UINT32)p[1] << 8) | ((UINT32)p[2] << 16) | ((UINT32)p[3] << 24);
+}
+
+static inline UINT64 rd64(const UINT8 *p)
+{
+    return (UINT64)rd32(p) | ((UINT64)rd32(p + 4) << 32);
+}
+
+/* ---- xxHash32 ---- */
+#define XXH_P1  2654435761u
+#define XXH_P2  2246822519u
+#define XXH_P3  3266489917u
+#define XXH_P4   668265263u
+#define XXH_P5   374761393u
+
+static inline UINT32 rotl32(UINT32 x, int r) { return (x << r) | (x >> (32 - r)); }
+
+static inline UINT32 xxh_round(UINT32 acc, UINT32 in)
+{
+    acc += in * XXH_P2;
+    return rotl32(acc, 13) * XXH_P1;
+}
+
+static VOID xxh_reset(LZ4_XXH32 *x)
+{
+    x->acc[0] = XXH_P1 + XXH_P2;
+    x->acc[1] = XXH_P2;
+    x->acc[2] = 0;
+    x->acc[3] = 0u - XXH_P1;
+    x->tail_len = 0;
+    x->total = 0;
+}
+
+static inline VOID xxh_stripe(LZ4_XXH32 *x, const UINT8 *p)
+{
+    x->acc[0] = xxh_round(x->acc[0], rd32(p));
+    x->acc[1] = xxh_round(x->acc[1], rd32(p + 4));
+    x->acc[2] = xxh_round(x->acc[2], rd32(p + 8));
+    x->acc[3] = xxh_round(x->acc[3], rd32(p + 12));
+}
+
+static VOID xxh_update(LZ4_XXH32 *x, const UINT8 *p, UINTN n)
+{
+    x->total += n;
+    if (x->tail_len) {
+        while (n && x->tail_len < sizeof(x->tail)) { x->tail[x->tail_len++] = *p++; --n; }
+        if (x->tail_len < sizeof(x->tail)) return;
+        xxh_stripe(x, x->tail);
+        x->tail_len = 0;
+    }
+    for (; n >= 16; p += 16, n -= 16) xxh_stripe(x, p);
+    while (n--) x->tail[x->tail_len++] = *p++;
+}
+
+static UINT32 xxh_digest(const LZ4_XXH32 *x)
+{
+    UINT32 h;
+    if (x->total >= 16)
+        h = rotl32(x->acc[0], 1) + rotl32(x->acc[1], 7) + rotl32(x->acc[2], 12) + rotl32(x->acc[3], 18);
+    else
+        h = x->acc[2] + XXH_P5;    // acc[2] は seed のまま
+    h += (UINT32)x->total;
+
+    const UINT8 *p = x->tail;
+    UINTN n = x->tail_len;
+    for (; n >= 4; p += 4, n -= 4) h = rotl32(h + rd32(p) * XXH_P3, 17) * XXH_P4;
+    for (; n; ++p, --n)            h = rotl32(h + *p * XXH_P5, 11) * XXH_P1;
+
+    h ^= h >> 15; h *= XXH_P2;
+    h ^= h >> 13; h *= XXH_P3;
+    h ^= h >> 16;
+    return h;
+}
+
+static UINT32 xxh32(const UINT8 *p, UINTN n)
+{
+    LZ4_XXH32 x;
+    xxh_reset(&x);
+    xxh_update(&x, p, n);
+    return xxh_digest(&x);
+}
+
+/* ---- ブロック ---- */
+static inline VOID copy_seq(UINT8 *dst, const UINT8 *src, UINTN n)
+{
+    if (n < SHORT_COPY) { while (n--) *dst++ = *src++; return; }
+    copy_bytes(dst, src, n);   // 重なっていても 1 バイトずつ前から写したのと同じ結果
+}
+
+static bool read_len(const UINT8 **ip, const UINT8 *iend, UINTN *len)
+{
+    UINT8 b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+// [ip, ip+in_len) を op へ展開。マッチは lo まで遡ってよい
+static EFI_STATUS block_decode(const UINT8 *ip, UINTN in_len, const UINT8 *lo,
+                               UINT8 *op, UINTN cap, UINTN *out_len)
+{
+    const UINT8 *iend = ip + in_len;
+    UINT8 *ostart = op, *oend = op + cap;
+
+    for (;;) {
+        if (ip >= iend) return EFI_VOLUME_CORRUPTED;
+        UINT8 token = *ip++;
+
+        UINTN lit = token >> 4;
+        if (lit == 15 && !read_len(&ip, iend, &lit)) return EFI_VOLUME_CORRUPTED;
+        if (lit > (UINTN)(iend - ip) || lit > (UINTN)(oend - op)) return EFI_VOLUME_CORRUPTED;
+        copy_seq(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) break;     // 最後のシーケンスはリテラルだけ
+
+        if (iend - ip < 2) return EFI_VOLUME_CORRUPTED;
+        UINTN off = (UINTN)ip[0] | ((UINTN)ip[1] << 8);
+        ip += 2;
+        if (off == 0 || off > (UINTN)(op - lo)) return EFI_VOLUME_CORRUPTED;
+
+        UINTN mlen = token & 15;
+        if (mlen == 15 && !read_len(&ip, iend, &mlen)) return EFI_VOLUME_CORRUPTED;
+        mlen += MIN_MATCH;
+        if (mlen > (UINTN)(oend - op)) return EFI_VOLUME_CORRUPTED;
+        copy_seq(op, op - off, mlen);
+        op += mlen;
+    }
+    *out_len = (UINTN)(op - ostart);
+    return EFI_SUCCESS;
+}
+
+/* ---- フレーム ---- */
+bool lz4_is_frame(CONST VOID *src, UINTN size)
+{
+    return src && size >= 4 && rd32((const UINT8*)src) == LZ4_FRAME_MAGIC;
+}
+
+EFI_STATUS lz4_frame_open(LZ4_FRAME *f, CONST VOID *src, UINTN size)
+{
+    if (!f || !lz4_is_frame(src, size)) return EFI_INVALID_PARAMETER;
+    fill_bytes(f, 0, sizeof(*f));
+    f->src = (const UINT8*)src;
+    f->src_size = size;
+
+    if (size < 7) return EFI_VOLUME_CORRUPTED;
+    UINT8 flg = f->src[4], bd = f->src[5];
+    if ((flg & FLG_VERSION_MASK) != FLG_VERSION_01 || (flg & FLG_RESERVED) || (bd & BD_RESERVED)) {
+        log_printf(LOG_ERROR, L"LZ4: unsupported frame (FLG=0x%x BD=0x%x)", flg, bd);
+        return EFI_UNSUPPORTED;
+    }
+    if (flg & FLG_DICT_ID) {
+        log_printf(LOG_ERROR, L"LZ4: preset dictionaries are not supported");
+        return EFI_UNSUPPORTED;
+    }
+    UINTN bsid = (bd >> 4) & 7;
+    if (bsid < 4) return EFI_VOLUME_CORRUPTED;
+    f->flg = flg;
+    f->block_max = (UINTN)1 << (8 + 2 * bsid);   // 4:64KiB 5:256KiB 6:1MiB 7:4MiB
+
+    UINTN desc = 2 + ((flg & FLG_CONTENT_SIZE) ? 8 : 0);
+    if (size < 4 + desc + 1) return EFI_VOLUME_CORRUPTED;
+    if (flg & FLG_CONTENT_SIZE) f->content_size = rd64(f->src + 6);
+    if (((xxh32(f->src + 4, desc) >> 8) & 0xFF) != f->src[4 + desc]) {
+        log_printf(LOG_ERROR, L"LZ4: frame header checksum mismatch");
+        return EFI_COMPROMISED_DATA;
+    }
+    f->pos = 4 + desc + 1;
+
+    UINTN win_size = ((flg & FLG_BLOCK_INDEP) ? 0 : LZ4_HIST) + f->block_max;
+    EFI_STATUS st = uefi_call_wrapper(BS->AllocatePool, 3, EfiLoaderData, win_size, (VOID**)&f->win);
+    if (EFI_ERROR(st) || !f->win) { f->win = NULL; return st ? st : EFI_OUT_OF_RESOURCES; }
+
+    xxh_reset(&f->xxh);
+    return EFI_SUCCESS;
+}
+
+// 連結ブロックなら直前の出力の末尾 64KiB を窓の先頭へ寄せる
+static VOID slide_history(LZ4_FRAME *f)
+{
+    if ((f->flg & FLG_BLOCK_INDEP) || !f->last_len) return;
+    UINTN total = f->hist + f->last_len;
+    UINTN keep  = (total < LZ4_HIST) ? total : LZ4_HIST;
+    if (total > keep) copy_bytes(f->win, f->win + (total - keep), keep);
+    f->hist = keep;
+    f->last_len = 0;
+}
+
+static EFI_STATUS frame_end(LZ4_FRAME *f)
+{
+    if (f->flg & FLG_CONTENT_CSUM) {
+        if (f->src_size - f->pos < 4) return EFI_VOLUME_CORRUPTED;
+        if (rd32(f->src + f->pos) != xxh_digest(&f->xxh)) {
+            log_printf(LOG_ERROR, L"LZ4: content checksum mismatch");
+            return EFI_COMPROMISED_DATA;
+        }
+        f->pos += 4;
+    }
+    if ((f->flg & FLG_CONTENT_SIZE) && f->out_total != f->content_size) {
+        log_printf(LOG_ERROR, L"LZ4: size mismatch (%lu != %lu)", f->out_total, f->content_size);
+        return EFI_VOLUME_CORRUPTED;
+    }
+    f->done = true;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS lz4_frame_next(LZ4_FRAME *f, CONST UINT8 **out, UINTN *out_len)
+{
+    if (!f || !f->win || !out || !out_len) return EFI_INVALID_PARAMETER;
+    *out = NULL;
+    *out_len = 0;
+
+    while (!f->done) {
+        slide_history(f);
+
+        if (f->src_size - f->pos < 4) return EFI_VOLUME_CORRUPTED;
+        UINT32 word = rd32(f->src + f->pos);
+        f->pos += 4;
+        if (word == 0) return frame_end(f);   // EndMark
+
+        UINTN bsz = word & ~BLOCK_RAW;
+        if (bsz > f->block_max || bsz > f->src_size - f->pos) return EFI_VOLUME_CORRUPTED;
+        const UINT8 *bp = f->src + f->pos;
+        f->pos += bsz;
+        if (f->flg & FLG_BLOCK_CSUM) {
+            if (f->src_size - f->pos < 4) return EFI_VOLUME_CORRUPTED;
+            if (rd32(f->src + f->pos) != xxh32(bp, bsz)) {
+                log_printf(LOG_ERROR, L"LZ4: block checksum mismatch");
+                return EFI_COMPROMISED_DATA;
+            }
+            f->pos += 4;
+        }
+
+        UINT8 *dst = f->win + f->hist;
+        UINTN n = bsz;
+        if (word & BLOCK_RAW) {
+            copy_bytes(dst, bp, bsz);
+        } else {
+            EFI_STATUS st = block_decode(bp, bsz, f->win, dst, f->block_max, &n);
+            if (EFI_ERROR(st)) {
+                log_printf(LOG_ERROR, L"LZ4: corrupt block at offset %lu", (UINT64)(bp - f->src));
+                return st;
+            }
+        }
+        if (f->flg & FLG_CONTENT_CSUM) xxh_update(&f->xxh, dst, n);
+        f->out_total += n;
+        f->last_len = n;
+        if (n == 0) continue;   // 空ブロックは読み飛ばす（長さ 0 は終端の合図にする）
+
+        *out = dst;
+        *out_len = n;
+        return EFI_SUCCESS;
+    }
+    return EFI_SUCCESS;
+}
+
+VOID lz4_frame_close(LZ4_FRAME *f)
+{
+    if (f && f->win) uefi_call_wrapper(BS->FreePool, 1, f->win);
+    if (f) f->win = NULL;
+}
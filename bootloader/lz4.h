@@ -0,0 +1,45 @@
+#pragma once
+#include <efi.h>
+#include <efilib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* LZ4 フレーム形式（lz4 コマンド / tools/lz4pack.py の出力）のストリーム展開
+ *  - 圧縮データはメモリ上に丸ごと置き、出力はブロック単位で窓に展開して渡す。
+ *    呼び出し側は受け取ったブロックを最終的な置き場所へ写す（全体の展開バッファは持たない）
+ *  - ブロック独立 / 連結（前ブロックの 64KiB を参照）の両方に対応
+ *  - ヘッダ・ブロック・全体の xxHash32 チェックサムがあれば検証する
+ */
+#define LZ4_FRAME_MAGIC  0x184D2204u
+
+typedef struct {            // xxHash32 の逐次計算（seed 0）
+    UINT32  acc[4];
+    UINT8   tail[16];
+    UINTN   tail_len;
+    UINT64  total;
+} LZ4_XXH32;
+
+typedef struct {
+    const UINT8 *src;
+    UINTN   src_size;
+    UINTN   pos;            // 次に読む src の位置
+    UINT8   flg;
+    UINTN   block_max;
+    UINT64  content_size;   // フレームヘッダにあれば。無ければ 0
+    UINT8  *win;            // [履歴 64KiB][ブロック最大]
+    UINTN   hist;           // win 先頭の有効な履歴バイト数
+    UINT64  out_total;      // これまでに渡した展開後バイト数
+    UINTN   last_len;       // 前回渡したブロックの長さ（次の呼び出しで履歴へ回す）
+    LZ4_XXH32 xxh;          // 全体チェックサム
+    bool    done;
+} LZ4_FRAME;
+
+bool       lz4_is_frame(CONST VOID *src, UINTN size);
+
+/* フレームヘッダを読んで窓を確保する */
+EFI_STATUS lz4_frame_open(LZ4_FRAME *f, CONST VOID *src, UINTN size);
+
+/* 次のブロックを展開する。*out は次の呼び出しまで有効。終端なら *out_len = 0 */
+EFI_STATUS lz4_frame_next(LZ4_FRAME *f, CONST UINT8 **out, UINTN *out_len);
+
+VOID       lz4_frame_close(LZ4_FRAME *f);
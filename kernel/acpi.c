@@ -0,0 +1,238 @@
+#include "acpi.h"
+#include "common.h"
+#include "log.h"
+#include "arch/x86/paging.h"
+
+/* MADT エントリ種別 */
+enum {
+    MADT_LOCAL_APIC          = 0,
+    MADT_IO_APIC             = 1,
+    MADT_INT_SRC_OVERRIDE    = 2,
+    MADT_LAPIC_ADDR_OVERRIDE = 5,
+    MADT_LOCAL_X2APIC        = 9,
+};
+
+/* Local APIC flags */
+#define MADT_LAPIC_ENABLED        (1u << 0)
+#define MADT_LAPIC_ONLINE_CAPABLE (1u << 1)
+
+typedef struct __attribute__((packed)) {
+    acpi_sdt_header_t hdr;
+    uint32_t lapic_address;
+    uint32_t flags;
+    /* 以降 可変長エントリ */
+} madt_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t length;
+} madt_entry_t;
+
+typedef struct __attribute__((packed)) {
+    madt_entry_t h;
+    uint8_t  acpi_processor_id;
+    uint8_t  apic_id;
+    uint32_t flags;
+} madt_lapic_t;
+
+typedef struct __attribute__((packed)) {
+    madt_entry_t h;
+    uint8_t  id;
+    uint8_t  reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} madt_ioapic_t;
+
+typedef struct __attribute__((packed)) {
+    madt_entry_t h;
+    uint8_t  bus;
+    uint8_t  source;
+    uint32_t gsi;
+    uint16_t flags;
+} madt_iso_t;
+
+typedef struct __attribute__((packed)) {
+    madt_entry_t h;
+    uint16_t reserved;
+    uint64_t address;
+} madt_lapic_override_t;
+
+typedef struct __attribute__((packed)) {
+    madt_entry_t h;
+    uint16_t reserved;
+    uint32_t x2apic_id;
+    uint32_t flags;
+    uint32_t acpi_uid;
+} madt_x2apic_t;
+
+/* ---- 内部状態 ---- */
+static const acpi_sdt_header_t* g_root = NULL;   /* XSDT or RSDT */
+static int                      g_root_is_xsdt = 0;
+
+static uint8_t sum_bytes(const void* p, size_t n)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    uint8_t s = 0;
+    for (size_t i = 0; i < n; ++i) s = (uint8_t)(s + b[i]);
+    return s;
+}
+
+static const void* acpi_phys(uint64_t pa)
+{
+    return (const void*)(uintptr_t)phys2virt(pa);
+}
+
+static int table_is_valid(const acpi_sdt_header_t* h)
+{
+    if (!h || h->length < sizeof(*h)) return 0;
+    return sum_bytes(h, h->length) == 0;
+}
+
+int acpi_init(uint64_t rsdp_phys)
+{
+    if (rsdp_phys == 0) {
+        KLOG_WARN("acpi", "RSDP not provided by bootloader");
+        return -1;
+    }
+
+    const acpi_rsdp_t* rsdp = (const acpi_rsdp_t*)acpi_phys(rsdp_phys);
+    if (memcmp(rsdp->signature, "RSD PTR ", 8) != 0 || sum_bytes(rsdp, 20) != 0) {
+        KLOG_ERROR("acpi", "RSDP signature/checksum mismatch @0x%llx",
+                   (unsigned long long)rsdp_phys);
+        return -1;
+    }
+
+    if (rsdp->revision >= 2 && rsdp->xsdt_address &&
+        sum_bytes(rsdp, rsdp->length) == 0) {
+        g_root = (const acpi_sdt_header_t*)acpi_phys(rsdp->xsdt_address);
+        g_root_is_xsdt = 1;
+    } else {
+        g_root = (const acpi_sdt_header_t*)acpi_phys(rsdp->rsdt_address);
+        g_root_is_xsdt = 0;
+    }
+
+    if (!table_is_valid(g_root)) {
+        KLOG_ERROR("acpi", "%s checksum mismatch", g_root_is_xsdt ? "XSDT" : "RSDT");
+        g_root = NULL;
+        return -1;
+    }
+
+    KLOG_INFO("acpi", "ACPI rev=%u root=%s", (unsigned)rsdp->revision,
+              g_root_is_xsdt ? "XSDT" : "RSDT");
+    return 0;
+}
+
+const acpi_sdt_header_t* acpi_find_table(const char sig[4])
+{
+    if (!g_root) return NULL;
+
+    const uint8_t* ents = (const uint8_t*)g_root + sizeof(acpi_sdt_header_t);
+    size_t esz   = g_root_is_xsdt ? 8 : 4;
+    size_t count = (g_root->length - sizeof(acpi_sdt_header_t)) / esz;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t pa = 0;
+        if (g_root_is_xsdt) memcpy(&pa, ents + i * 8, 8);
+        else { uint32_t v; memcpy(&v, ents + i * 4, 4); pa = v; }
+
+        const acpi_sdt_header_t* h = (const acpi_sdt_header_t*)acpi_phys(pa);
+        if (memcmp(h->signature, sig, 4) != 0) continue;
+        if (!table_is_valid(h)) {
+            KLOG_WARN("acpi", "table %c%c%c%c has bad checksum",
+                      sig[0], sig[1], sig[2], sig[3]);
+            continue;
+        }
+        return h;
+    }
+    return NULL;
+}
+
+static void madt_add_cpu(acpi_madt_info_t* out, uint32_t apic_id, uint32_t flags)
+{
+    if (!(flags & (MADT_LAPIC_ENABLED | MADT_LAPIC_ONLINE_CAPABLE))) return;
+    if (out->cpu_count >= ACPI_MAX_LAPICS) return;
+    /* LAPIC と x2APIC の両方に載る CPU を二重に数えない */
+    for (int i = 0; i < out->cpu_count; ++i) {
+        if (out->apic_ids[i] == apic_id) return;
+    }
+    out->apic_ids[out->cpu_count++] = apic_id;
+}
+
+int acpi_parse_madt(acpi_madt_info_t* out)
+{
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    const madt_t* madt = (const madt_t*)acpi_find_table("APIC");
+    if (!madt) {
+        KLOG_ERROR("acpi", "MADT not found");
+        return -1;
+    }
+
+    out->lapic_phys = madt->lapic_address;
+    out->flags      = madt->flags;
+
+    const uint8_t* p   = (const uint8_t*)madt + sizeof(*madt);
+    const uint8_t* end = (const uint8_t*)madt + madt->hdr.length;
+
+    while (p + sizeof(madt_entry_t) <= end) {
+        const madt_entry_t* e = (const madt_entry_t*)p;
+        if (e->length < sizeof(madt_entry_t) || p + e->length > end) break;
+
+        switch (e->type) {
+        case MADT_LOCAL_APIC: {
+            const madt_lapic_t* l = (const madt_lapic_t*)e;
+            madt_add_cpu(out, l->apic_id, l->flags);
+            break;
+        }
+        case MADT_LOCAL_X2APIC: {
+            const madt_x2apic_t* x = (const madt_x2apic_t*)e;
+            madt_add_cpu(out, x->x2apic_id, x->flags);
+            break;
+        }
+        case MADT_IO_APIC: {
+            const madt_ioapic_t* io = (const madt_ioapic_t*)e;
+            if (out->ioapic_count < ACPI_MAX_IOAPICS) {
+                acpi_ioapic_t* d = &out->ioapics[out->ioapic_count++];
+                d->id       = io->id;
+                d->phys     = io->address;
+                d->gsi_base = io->gsi_base;
+            }
+            break;
+        }
+        case MADT_INT_SRC_OVERRIDE: {
+            const madt_iso_t* iso = (const madt_iso_t*)e;
+            if (out->iso_count < ACPI_MAX_ISOS) {
+                acpi_iso_t* d = &out->isos[out->iso_count++];
+                d->bus    = iso->bus;
+                d->source = iso->source;
+                d->gsi    = iso->gsi;
+                d->flags  = iso->flags;
+            }
+            break;
+        }
+        case MADT_LAPIC_ADDR_OVERRIDE: {
+            const madt_lapic_override_t* o = (const madt_lapic_override_t*)e;
+            out->lapic_phys = o->address;
+            break;
+        }
+        default:
+            break;
+        }
+        p += e->length;
+    }
+
+    KLOG_INFO("acpi", "MADT: %d CPU(s), %d IOAPIC(s), %d override(s), LAPIC @0x%llx",
+              out->cpu_count, out->ioapic_count, out->iso_count,
+              (unsigned long long)out->lapic_phys);
+    return 0;
+}
+
+const acpi_madt_info_t* acpi_madt(void)
+{
+    static acpi_madt_info_t s_madt;
+    static int              s_state = 0;   /* 0: 未パース, 1: ok, -1: 無し */
+
+    if (s_state == 0) s_state = (acpi_parse_madt(&s_madt) == 0) ? 1 : -1;
+    return (s_state > 0) ? &s_madt : NULL;
+}
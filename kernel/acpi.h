@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* =========================== 概要 ===========================
+ * ACPI テーブルの最小パーサ
+ *  - RSDP（ブートローダが BOOT_INFO で渡す物理アドレス）から XSDT/RSDT を辿る
+ *  - MADT から CPU（Local APIC / x2APIC）を列挙する
+ *  - テーブル本体は Direct Map 経由で参照する（コピーしない）
+ * =========================================================== */
+
+typedef struct __attribute__((packed)) acpi_rsdp {
+    char     signature[8];   /* "RSD PTR " */
+    uint8_t  checksum;       /* 先頭 20 バイトの和 == 0 */
+    char     oem_id[6];
+    uint8_t  revision;       /* 0: ACPI 1.0, 2: ACPI 2.0+ */
+    uint32_t rsdt_address;
+    /* ---- 以降 revision >= 2 ---- */
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t  ext_checksum;
+    uint8_t  reserved[3];
+} acpi_rsdp_t;
+
+typedef struct __attribute__((packed)) acpi_sdt_header {
+    char     signature[4];
+    uint32_t length;         /* ヘッダ込みの全長 */
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} acpi_sdt_header_t;
+
+/* MADT の列挙上限（論理 CPU 数の上限は percpu 側の MAX_CPUS） */
+enum { ACPI_MAX_LAPICS = 256, ACPI_MAX_IOAPICS = 8, ACPI_MAX_ISOS = 16 };
+
+typedef struct acpi_ioapic {
+    uint8_t  id;
+    uint64_t phys;          /* MMIO ベース */
+    uint32_t gsi_base;      /* この IOAPIC の INTIN0 に対応する GSI */
+} acpi_ioapic_t;
+
+/* ISA IRQ → GSI の付け替え（Interrupt Source Override） */
+typedef struct acpi_iso {
+    uint8_t  bus;           /* 0 = ISA */
+    uint8_t  source;        /* ISA IRQ 番号 */
+    uint32_t gsi;
+    uint16_t flags;         /* MPS INTI flags: bit0-1 極性, bit2-3 トリガ */
+} acpi_iso_t;
+
+/* MPS INTI flags */
+#define ACPI_INTI_POLARITY_MASK   0x3
+#define ACPI_INTI_POLARITY_HIGH   0x1
+#define ACPI_INTI_POLARITY_LOW    0x3
+#define ACPI_INTI_TRIGGER_MASK    0xC
+#define ACPI_INTI_TRIGGER_EDGE    0x4
+#define ACPI_INTI_TRIGGER_LEVEL   0xC
+
+typedef struct acpi_madt_info {
+    uint64_t lapic_phys;                   /* Local APIC MMIO（override 反映済み） */
+    uint32_t flags;                        /* bit0: PC-AT 互換 8259 あり */
+    int      cpu_count;                    /* 有効な CPU 数 */
+    uint32_t apic_ids[ACPI_MAX_LAPICS];    /* MADT 記載順（先頭が BSP とは限らない） */
+    int           ioapic_count;
+    acpi_ioapic_t ioapics[ACPI_MAX_IOAPICS];
+    int           iso_count;
+    acpi_iso_t    isos[ACPI_MAX_ISOS];
+} acpi_madt_info_t;
+
+/* 初期化：RSDP を検証し、XSDT（無ければ RSDT）を覚える。0:ok / -1:ng */
+int acpi_init(uint64_t rsdp_phys);
+
+/* シグネチャでテーブルを探す（チェックサム検証済み）。無ければ NULL */
+const acpi_sdt_header_t* acpi_find_table(const char sig[4]);
+
+/* MADT を読んで CPU / IOAPIC / ISO を列挙する。0:ok / -1:MADT 無し */
+int acpi_parse_madt(acpi_madt_info_t* out);
+
+/* 初回にパースしてキャッシュした MADT（acpi_init 後に有効。無ければ NULL） */
+const acpi_madt_info_t* acpi_madt(void);
@@ -0,0 +1,49 @@
+#pragma once
+/* =========================== 概要 ===========================
+ * AP 起動トランポリン（ap_trampoline.S）と C 側の共有定義
+ *  - トランポリンは 1MiB 未満の 1 ページにコピーして SIPI で実行させる
+ *  - 先頭 8 バイト目からパラメータブロック（BSP が AP ごとに書き換える）
+ *  - ページ末尾を 32bit モード中の一時スタックに使う
+ * =========================================================== */
+
+#define AP_TRAMP_PARAMS_OFF   8
+
+#define AP_P_PM_ENTRY   (AP_TRAMP_PARAMS_OFF + 0)    /* u32: 32bit 入口（AP 自身が書く） */
+#define AP_P_PM_SEL     (AP_TRAMP_PARAMS_OFF + 4)    /* u16: 32bit コードセレクタ */
+#define AP_P_GDTR       (AP_TRAMP_PARAMS_OFF + 6)    /* u16 limit + u32 base（base は AP が書く） */
+#define AP_P_CR3        (AP_TRAMP_PARAMS_OFF + 12)   /* u32: 一時 Lv4（4GiB 未満） */
+#define AP_P_CR4        (AP_TRAMP_PARAMS_OFF + 16)   /* u32 */
+#define AP_P_CR0        (AP_TRAMP_PARAMS_OFF + 20)   /* u32 */
+#define AP_P_ENTRY      (AP_TRAMP_PARAMS_OFF + 24)   /* u64: C 入口（上位ハーフ） */
+#define AP_P_STACK      (AP_TRAMP_PARAMS_OFF + 32)   /* u64: RSP 初期値 */
+#define AP_P_ARG        (AP_TRAMP_PARAMS_OFF + 40)   /* u64: 第1引数（percpu_t*） */
+#define AP_P_GDT        (AP_TRAMP_PARAMS_OFF + 48)   /* 一時 GDT（4 エントリ） */
+
+/* 一時 GDT のセレクタ */
+#define AP_SEL_CODE32   0x08
+#define AP_SEL_DATA     0x10
+#define AP_SEL_CODE64   0x18
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+typedef struct __attribute__((packed)) ap_tramp_params {
+    uint32_t pm_entry;
+    uint16_t pm_sel;
+    uint16_t gdtr_limit;
+    uint32_t gdtr_base;
+    uint32_t cr3;
+    uint32_t cr4;
+    uint32_t cr0;
+    uint64_t entry;
+    uint64_t stack;
+    uint64_t arg;
+    uint64_t gdt[4];
+} ap_tramp_params_t;
+
+_Static_assert(sizeof(ap_tramp_params_t) == AP_P_GDT - AP_TRAMP_PARAMS_OFF + 32,
+               "ap_tramp_params_t layout mismatch");
+
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+#endif
@@ -15,4 +15,18 @@ static inline uint8_t inb(uint16_t port) {
 }
 static inline void io_wait(void) {
     __asm__ __volatile__("outb %%al, $0x80" :: "a"(0));
-}
\ No newline at end of file
+}
+static inline void outw(uint16_t port, uint16_t val) {
+    __asm__ __volatile__("outw %0, %1" :: "a"(val), "Nd"(port));
+}
+static inline uint16_t inw(uint16_t port) {
+    uint16_t v; __asm__ __volatile__("inw %1, %0" : "=a"(v) : "Nd"(port));
+    return v;
+}
+static inline void outl(uint16_t port, uint32_t val) {
+    __asm__ __volatile__("outl %0, %1" :: "a"(val), "Nd"(port));
+}
+static inline uint32_t inl(uint16_t port) {
+    uint32_t v; __asm__ __volatile__("inl %1, %0" : "=a"(v) : "Nd"(port));
+    return v;
+}
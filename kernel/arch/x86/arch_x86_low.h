@@ -42,3 +42,11 @@ static inline uint64_t read_cr4(void){uint64_t v;__asm__ __volatile__("mov %%cr4
 static inline void write_cr0(uint64_t v){__asm__ __volatile__("mov %0,%%cr0"::"r"(v):"memory"); }
 static inline void write_cr3(uint64_t v){__asm__ __volatile__("mov %0,%%cr3"::"r"(v):"memory");}
 static inline void write_cr4(uint64_t v){__asm__ __volatile__("mov %0,%%cr4"::"r"(v):"memory");}
+
+/* TSC */
+static inline uint64_t rdtsc(void){uint32_t lo,hi;__asm__ __volatile__("rdtsc":"=a"(lo),"=d"(hi));return ((uint64_t)hi<<32)|lo;}
+
+/* 割込みフラグの退避／復帰（RFLAGS.IF = bit9） */
+#define RFLAGS_IF (1ULL << 9)
+static inline uint64_t irq_save(void){uint64_t f;__asm__ __volatile__("pushfq; popq %0; cli":"=r"(f)::"memory");return f;}
+static inline void irq_restore(uint64_t f){if (f & RFLAGS_IF) __asm__ __volatile__("sti":::"memory");}
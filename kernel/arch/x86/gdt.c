@@ -5,20 +5,9 @@
  * 通常ディスクリプタ：64bit（u64）
  * TSS/LDT ディスクリプタ：128bit（連続する2エントリを使用）
  */
-#define GDT_MAX  8
-
-static __attribute__((aligned(16))) uint64_t gdt[GDT_MAX];
-
-/* GDTR */
-typedef struct __attribute__((packed)) {
-    uint16_t limit;
-    uint64_t base;
-} gdtr_t;
-
-static gdtr_t gdtr;
-
-/* 未使用でも TR!=0 のために TSS を用意 */
-static __attribute__((aligned(16))) tss64_t g_tss;
+/* BSP 用。AP は percpu 領域内の gdt_cpu_t を使う
+ * 未使用でも TR!=0 のために TSS を用意 */
+static gdt_cpu_t g_bsp_gdt;
 
 /* ===== ディスクリプタ生成ヘルパ =====
  * access: P|DPL|S|Type (0..7)
@@ -56,7 +45,7 @@ static uint64_t make_data_desc(void) {
  *  - flags_nib: G=0, DB=0, L=0, AVL=0 → 0x0
  *  - 上位 Qword に base[63:32] を格納（下位32bit）。上位32bit は 0。
  */
-static void set_tss_desc(uint16_t index, uint64_t base, uint32_t limit)
+static void set_tss_desc(uint64_t* gdt, uint16_t index, uint64_t base, uint32_t limit)
 {
     const uint8_t type = 0x9;            /* Available TSS */
     const uint8_t present = 1;
@@ -95,7 +84,7 @@ uint64_t tss_base_from_gdt(uint16_t tr, struct desc_ptr gdtr) {
 
 /* ===== セグメントレジスタ更新 ===== */
 
-static inline void load_gdtr(const gdtr_t* g)
+static inline void load_gdtr(const struct desc_ptr* g)
 {
     __asm__ __volatile__("lgdt (%0)" :: "r"(g));
 }
@@ -131,28 +120,34 @@ static inline void load_tr(uint16_t sel)
 }
 
 /* ===== 公開：初期化 ===== */
-void gdt_init(void)
+void gdt_init_cpu(gdt_cpu_t* t)
 {
+    uint64_t* gdt = t->entries;
+
     /* 0: NULL */
     gdt[0] = 0;
 
     /* 1: kernel data, 2: kernel code */
     gdt[KERNEL_DS_IDX] = make_data_desc();
     gdt[KERNEL_CS_IDX] = make_code64_desc();
+    for (int i = KERNEL_TSS_IDX + 2; i < GDT_MAX; ++i) gdt[i] = 0;
 
     /* TSS 本体を最小初期化（I/O bitmap 無効化） */
-    for (size_t i = 0; i < sizeof(g_tss)/sizeof(uint64_t); ++i) {
-        ((uint64_t*)&g_tss)[i] = 0;
+    for (size_t i = 0; i < sizeof(t->tss)/sizeof(uint64_t); ++i) {
+        ((uint64_t*)&t->tss)[i] = 0;
     }
-    g_tss.iomap_base = (uint16_t)sizeof(g_tss);
+    t->tss.iomap_base = (uint16_t)sizeof(t->tss);
 
     /* 3-4: TSS descriptor（2エントリ使用） */
-    set_tss_desc(KERNEL_TSS_IDX, (uint64_t)(uintptr_t)&g_tss, (uint32_t)(sizeof(g_tss) - 1));
+    set_tss_desc(gdt, KERNEL_TSS_IDX, (uint64_t)(uintptr_t)&t->tss, (uint32_t)(sizeof(t->tss) - 1));
 
     /* GDTR 設定 → LGDT */
-    gdtr.limit = (uint16_t)(sizeof(gdt) - 1);
-    gdtr.base  = (uint64_t)(uintptr_t)gdt;
-    load_gdtr(&gdtr);
+    t->gdtr.limit = (uint16_t)(sizeof(t->entries) - 1);
+    t->gdtr.base  = (uint64_t)(uintptr_t)gdt;
+    load_gdtr(&t->gdtr);
+
+    /* GS セレクタのロードで GS base が 0 に戻るので、percpu のベースを退避しておく */
+    uint64_t gs_base = rdmsr(IA32_GS_BASE);
 
     /* セグメントレジスタの Hidden Part を更新 */
     uint16_t ds_sel = sel_gdt(KERNEL_DS_IDX, 0);
@@ -162,4 +157,16 @@ void gdt_init(void)
     load_ds_es_fs_gs_ss(ds_sel);
     load_cs(cs_sel);
     load_tr(ts_sel);
+
+    wrmsr(IA32_GS_BASE, gs_base);
+}
+
+void gdt_init(void)
+{
+    gdt_init_cpu(&g_bsp_gdt);
+}
+
+gdt_cpu_t* gdt_bsp_table(void)
+{
+    return &g_bsp_gdt;
 }
@@ -34,5 +34,20 @@ typedef struct __attribute__((packed)) tss64 {
     uint16_t iomap_base; /* = sizeof(struct tss64) で I/O bitmap 無効 */
 } tss64_t;
 
-/* 初期化：GDT 構築 → LGDT → DS/ES/FS/GS/SS/CS 更新 → LTR */
+/* CPU ごとの GDT/TSS 一式（TSS はビジー状態を持つため CPU 間で共有できない） */
+#define GDT_MAX  8
+
+typedef struct gdt_cpu {
+    uint64_t        entries[GDT_MAX] __attribute__((aligned(16)));
+    tss64_t         tss              __attribute__((aligned(16)));
+    struct desc_ptr gdtr;
+} gdt_cpu_t;
+
+/* 初期化：GDT 構築 → LGDT → DS/ES/FS/GS/SS/CS 更新 → LTR（BSP 用の静的テーブル） */
 void gdt_init(void);
+
+/* 任意の CPU 用：t を構築して自 CPU にロードする（GS base は保持される） */
+void gdt_init_cpu(gdt_cpu_t* t);
+
+/* BSP が使っている静的テーブル */
+gdt_cpu_t* gdt_bsp_table(void);
@@ -33,3 +33,14 @@ void idt_init(void)
     g_idtr.base  = (uint64_t)(uintptr_t)g_idt;
     lidt(&g_idtr);
 }
+
+/* AP 用：BSP が構築済みの IDT を自 CPU にロードする（IDT は全 CPU で共有） */
+void idt_load(void)
+{
+    lidt(&g_idtr);
+}
+
+const idtr_t* idt_get_idtr(void)
+{
+    return &g_idtr;
+}
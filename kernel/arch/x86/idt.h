@@ -28,6 +28,8 @@ typedef struct __attribute__((packed)) {
 
 /* 外部公開 API */
 void idt_init(void);                       /* IDT 配列を LIDT する */
+void idt_load(void);                       /* 構築済み IDT を LIDT のみ（AP 用） */
+const idtr_t* idt_get_idtr(void);
 void idt_set_gate(int vec, void (*isr)(void),
                   uint16_t cs_selector,    /* 例: sel_gdt(KERNEL_CS_IDX, 0) (GDT実装) */
                   uint8_t gate_type,       /* 0xE: interrupt gate を推奨 */
@@ -2,9 +2,20 @@
 #include "gdt.h"      /* sel_gdt(), KERNEL_CS_IDX */
 #include "../../log.h"   /* KLOG_* */
 #include "idt.h"
+#include "vectors.h"
+#include "../../spinlock.h"
+#include "../../softirq.h"
+#include "../../trace.h"
+#include "../../metrics.h"
+#include "arch_x86_low.h"
+#include "intr_stat.h"
 #include <stddef.h>
 
+/* 登録は g_handlers_lock で直列化し、ディスパッチはロック無しで 1 ワード読むだけ
+ * （ポインタ 1 つの読み書きは原子的なので、古いか新しいかのどちらかが見える） */
 static intr_handler_t g_handlers[256];
+static DEFINE_SPINLOCK(g_handlers_lock);
+static uint64_t g_vec_used[256 / 64];   /* intr_alloc_vector の払い出し済みビット */
 
 static const char* exception_name(unsigned v)
 {
@@ -64,18 +75,72 @@ static void default_unhandled(intr_context_t* c)
 void intr_register_handler(int vec, intr_handler_t fn)
 {
     if (vec < 0 || vec >= 256) return;
-    g_handlers[vec] = fn ? fn : default_unhandled;
+    uint64_t flags = spin_lock_irqsave(&g_handlers_lock);
+    __atomic_store_n(&g_handlers[vec], fn ? fn : default_unhandled, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&g_handlers_lock, flags);
 }
 
+int intr_alloc_vector(intr_handler_t fn)
+{
+    if (!fn) return -1;
+    int vec = -1;
+    uint64_t flags = spin_lock_irqsave(&g_handlers_lock);
+    for (int v = VEC_DEVICE_FIRST; v <= VEC_DEVICE_LAST; ++v) {
+        if (g_vec_used[v / 64] & (1ULL << (v % 64))) continue;
+        g_vec_used[v / 64] |= (1ULL << (v % 64));
+        __atomic_store_n(&g_handlers[v], fn, __ATOMIC_RELEASE);
+        vec = v;
+        break;
+    }
+    spin_unlock_irqrestore(&g_handlers_lock, flags);
+    return vec;
+}
+
+void intr_free_vector(int vec)
+{
+    if (vec < VEC_DEVICE_FIRST || vec > VEC_DEVICE_LAST) return;
+    uint64_t flags = spin_lock_irqsave(&g_handlers_lock);
+    g_vec_used[vec / 64] &= ~(1ULL << (vec % 64));
+    __atomic_store_n(&g_handlers[vec], default_unhandled, __ATOMIC_RELEASE);
+    spin_unlock_irqrestore(&g_handlers_lock, flags);
+}
+
+TRACE_EVENT_DEFINE(irq, "vec=%llu cycles=%llu rip=0x%llx");
+METRIC_HISTOGRAM_DEFINE(irq_cycles, "irq.cycles");
+
 /* 共通 ISR から C 呼び出し時の入口 */
 void intr_dispatch_entry(intr_context_t* ctx)
 {
-    intr_handler_t h = g_handlers[(unsigned)ctx->vector];
+    unsigned vec = (unsigned)ctx->vector;
+    intr_handler_t h = __atomic_load_n(&g_handlers[vec], __ATOMIC_ACQUIRE);
+
+    uint64_t t0 = rdtsc();
     h(ctx);
+    uint64_t cycles = rdtsc() - t0;
+    intr_stat_record(vec, cycles);
+    TRACE3(irq, vec, cycles, ctx->rip);
+    METRIC_OBSERVE(irq_cycles, cycles);
+
+    /* 外部割込みの出口で後半処理（例外の中では回さない） */
+    if (vec >= 32) softirq_irq_exit((ctx->rflags & RFLAGS_IF) != 0);
 }
 
-/* 256 本のスタブを IDT に登録し、IF=1 */
 extern void (*__isr_stub_table[])(void); /* isr_stubs.c で定義 */
+
+int intr_register_fast(int vec, void (*stub)(void))
+{
+    if (vec < 32 || vec >= 256 || !stub) return -1;   /* 例外は全コンテキスト経路のまま */
+    idt_set_gate(vec, stub, sel_gdt(KERNEL_CS_IDX, 0), 0xE /*interrupt*/, 0 /*ring0*/);
+    return 0;
+}
+
+void intr_unregister_fast(int vec)
+{
+    if (vec < 32 || vec >= 256) return;
+    idt_set_gate(vec, __isr_stub_table[vec], sel_gdt(KERNEL_CS_IDX, 0), 0xE, 0);
+}
+
+/* 256 本のスタブを IDT に登録し、IF=1 */
 void intr_init_all_vectors(void)
 {
     /* まずすべてデフォルトに */
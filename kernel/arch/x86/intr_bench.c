@@ -0,0 +1,153 @@
+#include "arch/x86/intr_bench.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/pic.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/vectors.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+#include "log.h"
+
+#define BENCH_ITERS 10000
+
+typedef struct bench_result {
+    uint64_t min;
+    uint64_t sum;
+} bench_result_t;
+
+static void bench_add(bench_result_t* r, uint64_t dt)
+{
+    if (dt < r->min) r->min = dt;
+    r->sum += dt;
+}
+
+static void bench_report(const char* what, const bench_result_t* r, int iters)
+{
+    KLOG_INFO("bench", "%s: avg=%llu min=%llu cycles", what,
+              (unsigned long long)(r->sum / (uint64_t)iters), (unsigned long long)r->min);
+}
+
+/* ---- 自己 IPI 往復 ---- */
+static volatile uint64_t g_ipi_seen_tsc = 0;
+
+static void bench_ipi_handler(intr_context_t* ctx)
+{
+    (void)ctx;
+    g_ipi_seen_tsc = rdtsc();
+    lapic_eoi();
+}
+
+void intr_bench_pic_vs_lapic(void)
+{
+    bench_result_t r;
+    uint64_t flags = irq_save();
+
+    /* EOI: 8259 は primary で outb 1 回、secondary 経由なら 2 回（どちらも I/O ポート） */
+    r = (bench_result_t){ ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        uint64_t t0 = rdtsc();
+        pic_notify_eoi(IRQ_TIMER);
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report("PIC EOI (primary)", &r, BENCH_ITERS);
+
+    r = (bench_result_t){ ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        uint64_t t0 = rdtsc();
+        pic_notify_eoi(IRQ_RTC);
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report("PIC EOI (secondary)", &r, BENCH_ITERS);
+
+    /* 何も in-service でない EOI は LAPIC 側で無視されるので安全 */
+    r = (bench_result_t){ ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        uint64_t t0 = rdtsc();
+        lapic_eoi();
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report(lapic_is_x2apic() ? "LAPIC EOI (x2APIC MSR)" : "LAPIC EOI (xAPIC MMIO)",
+                 &r, BENCH_ITERS);
+
+    /* マスク変更（IMR キャッシュで outb 1 回） */
+    r = (bench_result_t){ ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        uint64_t t0 = rdtsc();
+        pic_set_mask(IRQ_OPEN1);
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report("PIC mask update", &r, BENCH_ITERS);
+
+    irq_restore(flags);
+
+    /* 自己 IPI 往復（割込み許可状態で測る） */
+    intr_register_handler(VEC_BENCH, bench_ipi_handler);
+    r = (bench_result_t){ ~0ULL, 0 };
+    bench_result_t rt = { ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        g_ipi_seen_tsc = 0;
+        uint64_t t0 = rdtsc();
+        lapic_send_self_ipi(VEC_BENCH);
+        while (!g_ipi_seen_tsc) cpu_relax();
+        uint64_t t1 = rdtsc();
+        bench_add(&r, g_ipi_seen_tsc - t0);   /* 送信 → ハンドラ到達 */
+        bench_add(&rt, t1 - t0);              /* ハンドラから復帰まで */
+    }
+    intr_register_handler(VEC_BENCH, NULL);
+    bench_report("LAPIC self-IPI delivery", &r, BENCH_ITERS);
+    bench_report("LAPIC self-IPI round trip", &rt, BENCH_ITERS);
+}
+
+/* ---- 割込み入口: 共通経路 vs 高速経路 ----
+ * int $VEC_BENCH（ソフト割込み、LAPIC を通らないので EOI 不要）の往復と、
+ * 自己 IPI の往復をそれぞれの入口で測る */
+static void bench_nop_handler(intr_context_t* ctx) { (void)ctx; }
+static void bench_fast_nop(void) { }
+DEFINE_FAST_ISR(bench_fast_nop_stub, bench_fast_nop)
+
+static void bench_fast_ipi(void)
+{
+    g_ipi_seen_tsc = rdtsc();
+    lapic_eoi();
+}
+DEFINE_FAST_ISR(bench_fast_ipi_stub, bench_fast_ipi)
+
+static void bench_soft_int(const char* what)
+{
+    bench_result_t r = { ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        uint64_t t0 = rdtsc();
+        __asm__ __volatile__("int %0" :: "i"(VEC_BENCH) : "memory");
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report(what, &r, BENCH_ITERS);
+}
+
+static void bench_self_ipi(const char* what)
+{
+    bench_result_t r = { ~0ULL, 0 };
+    for (int i = 0; i < BENCH_ITERS; ++i) {
+        g_ipi_seen_tsc = 0;
+        uint64_t t0 = rdtsc();
+        lapic_send_self_ipi(VEC_BENCH);
+        while (!g_ipi_seen_tsc) cpu_relax();
+        bench_add(&r, rdtsc() - t0);
+    }
+    bench_report(what, &r, BENCH_ITERS);
+}
+
+void intr_bench_entry_paths(void)
+{
+    intr_register_handler(VEC_BENCH, bench_nop_handler);
+    bench_soft_int("int round trip (isr_common)");
+
+    intr_register_fast(VEC_BENCH, bench_fast_nop_stub);
+    bench_soft_int("int round trip (fast stub)");
+
+    intr_register_fast(VEC_BENCH, bench_fast_ipi_stub);
+    bench_self_ipi("self-IPI round trip (fast stub)");
+
+    intr_unregister_fast(VEC_BENCH);
+    intr_register_handler(VEC_BENCH, bench_ipi_handler);
+    bench_self_ipi("self-IPI round trip (isr_common)");
+    intr_register_handler(VEC_BENCH, NULL);
+}
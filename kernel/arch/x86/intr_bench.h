@@ -0,0 +1,12 @@
+#pragma once
+
+/* =========================== 概要 ===========================
+ * 割込み経路のマイクロベンチマーク（make BENCH=1 のときに main から呼ぶ）
+ *  - 8259 PIC と LAPIC の EOI コスト、PIC のマスク変更コスト
+ *  - LAPIC 自己 IPI の往復（送信 → ハンドラ到達 → EOI → 復帰）
+ *  - 割込み入口の比較: 共通経路（isr_common）と高速経路（DEFINE_FAST_ISR）
+ * 結果は TSC サイクルで KLOG に出す。
+ * =========================================================== */
+
+void intr_bench_pic_vs_lapic(void);
+void intr_bench_entry_paths(void);
@@ -0,0 +1,79 @@
+#include "arch/x86/intr_stat.h"
+#include "log.h"
+
+intr_cpu_stat_t g_intr_stat[MAX_CPUS];
+
+uint64_t intr_stat_total(unsigned vec)
+{
+    uint64_t sum = 0;
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) sum += g_intr_stat[cpu].count[vec & 0xFF];
+    return sum;
+}
+
+/* 右寄せ width 桁で 10 進を追記（kvprintf は %s の幅指定を持たないので行はここで組む） */
+static char* put_u64(char* p, char* end, uint64_t v, int width)
+{
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    for (int i = n; i < width && p < end; ++i) *p++ = ' ';
+    while (n && p < end) *p++ = tmp[--n];
+    return p;
+}
+
+static char* put_str(char* p, char* end, const char* s)
+{
+    while (*s && p < end) *p++ = *s++;
+    return p;
+}
+
+void intr_stat_dump(void)
+{
+    uint32_t ncpu = percpu_count();
+    char line[16 + MAX_CPUS * 11];
+    char* end = line + sizeof(line) - 1;
+
+    char* p = put_str(line, end, "vec ");
+    for (uint32_t cpu = 0; cpu < ncpu; ++cpu) {
+        p = put_str(p, end, "      cpu");
+        p = put_u64(p, end, cpu, 2);
+    }
+    *p = '\0';
+    KLOG_INFO("intr", "%s", line);
+
+    for (unsigned v = 0; v < 256; ++v) {
+        if (!intr_stat_total(v)) continue;
+        p = line;
+        *p++ = "0123456789ABCDEF"[v >> 4];
+        *p++ = "0123456789ABCDEF"[v & 0xF];
+        *p++ = ':';
+        *p++ = ' ';
+        for (uint32_t cpu = 0; cpu < ncpu; ++cpu) {
+            p = put_u64(p, end, g_intr_stat[cpu].count[v], 11);
+        }
+        *p = '\0';
+        KLOG_INFO("intr", "%s", line);
+    }
+}
+
+void intr_stat_dump_hist(unsigned vec)
+{
+    vec &= 0xFF;
+    uint64_t b[INTR_HIST_BUCKETS] = {0};
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) {
+        for (int i = 0; i < INTR_HIST_BUCKETS; ++i) b[i] += g_intr_stat[cpu].hist[vec][i];
+    }
+
+    KLOG_INFO("intr", "vector 0x%02x handler cycles (total %llu):", vec,
+              (unsigned long long)intr_stat_total(vec));
+    for (int i = 0; i < INTR_HIST_BUCKETS; ++i) {
+        if (!b[i]) continue;
+        uint64_t lo = i ? (1ULL << (i + INTR_HIST_SHIFT - 1)) : 0;
+        if (i == INTR_HIST_BUCKETS - 1) {
+            KLOG_INFO("intr", "  >= %10llu : %llu", (unsigned long long)lo, (unsigned long long)b[i]);
+        } else {
+            KLOG_INFO("intr", "  %10llu - %10llu : %llu", (unsigned long long)lo,
+                      (unsigned long long)(1ULL << (i + INTR_HIST_SHIFT)), (unsigned long long)b[i]);
+        }
+    }
+}
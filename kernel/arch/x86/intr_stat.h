@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include "arch/x86/percpu.h"
+
+/* =========================== 概要 ===========================
+ * 割込み統計（/proc/interrupts 相当）
+ *  - CPU ごと・ベクタごとの発生回数と、ハンドラ実行時間（TSC）の log2 ヒストグラム
+ *  - 各 CPU は自分の行だけを書く（64B 整列の CPU 別領域）→ 共有キャッシュラインなし、原子命令なし
+ *  - 共通経路（intr_dispatch_entry）は自動で記録。高速経路のハンドラは
+ *    自分で intr_stat_record() を呼ぶ
+ * =========================================================== */
+
+#define INTR_HIST_BUCKETS  16
+#define INTR_HIST_SHIFT    7     /* bucket 0 = [0, 128)、i = [2^(i+6), 2^(i+7))、最後は上限なし */
+
+typedef struct intr_cpu_stat {
+    uint64_t count[256];
+    uint32_t hist[256][INTR_HIST_BUCKETS];
+} __attribute__((aligned(64))) intr_cpu_stat_t;
+
+extern intr_cpu_stat_t g_intr_stat[MAX_CPUS];
+
+static inline unsigned intr_hist_bucket(uint64_t cycles)
+{
+    if (cycles < (1ULL << INTR_HIST_SHIFT)) return 0;
+    unsigned b = (unsigned)(63 - __builtin_clzll(cycles)) - (INTR_HIST_SHIFT - 1);
+    return b < INTR_HIST_BUCKETS ? b : INTR_HIST_BUCKETS - 1;
+}
+
+/* 自 CPU の vec に 1 回分（ハンドラ実行 cycles）を記録。IF=0 で呼ぶ */
+static inline void intr_stat_record(unsigned vec, uint64_t cycles)
+{
+    intr_cpu_stat_t* s = &g_intr_stat[this_cpu_id()];
+    s->count[vec & 0xFF]++;
+    s->hist[vec & 0xFF][intr_hist_bucket(cycles)]++;
+}
+
+/* 全 CPU の合計 */
+uint64_t intr_stat_total(unsigned vec);
+
+/* 発生したベクタごとに CPU 別の回数を 1 行ずつ KLOG に出す */
+void intr_stat_dump(void);
+/* vec の実行時間ヒストグラム（全 CPU 合算）を出す */
+void intr_stat_dump_hist(unsigned vec);
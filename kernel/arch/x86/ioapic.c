@@ -0,0 +1,138 @@
+#include "arch/x86/ioapic.h"
+#include "arch/x86/paging.h"
+#include "spinlock.h"
+#include "acpi.h"
+#include "log.h"
+
+typedef struct ioapic {
+    volatile uint32_t* mmio;
+    uint8_t            id;
+    uint32_t           gsi_base;
+    uint32_t           nr_pins;      /* リダイレクションエントリ数 */
+    spinlock_t         lock;         /* REGSEL/IOWIN の 2 段アクセスを保護 */
+} ioapic_t;
+
+static ioapic_t g_ioapics[ACPI_MAX_IOAPICS];
+static int      g_ioapic_count = 0;
+
+static uint32_t ioapic_read(ioapic_t* io, uint32_t reg)
+{
+    io->mmio[IOAPIC_REGSEL / 4] = reg;
+    return io->mmio[IOAPIC_IOWIN / 4];
+}
+
+static void ioapic_write(ioapic_t* io, uint32_t reg, uint32_t val)
+{
+    io->mmio[IOAPIC_REGSEL / 4] = reg;
+    io->mmio[IOAPIC_IOWIN / 4] = val;
+}
+
+static ioapic_t* ioapic_for_gsi(uint32_t gsi, uint32_t* pin)
+{
+    for (int i = 0; i < g_ioapic_count; ++i) {
+        ioapic_t* io = &g_ioapics[i];
+        if (gsi >= io->gsi_base && gsi < io->gsi_base + io->nr_pins) {
+            *pin = gsi - io->gsi_base;
+            return io;
+        }
+    }
+    return NULL;
+}
+
+int ioapic_init(void)
+{
+    const acpi_madt_info_t* madt = acpi_madt();
+    if (!madt || madt->ioapic_count == 0) {
+        KLOG_WARN("ioapic", "no IOAPIC in MADT");
+        return -1;
+    }
+
+    for (int i = 0; i < madt->ioapic_count; ++i) {
+        ioapic_t* io = &g_ioapics[g_ioapic_count++];
+        io->mmio     = (volatile uint32_t*)(uintptr_t)phys2virt(madt->ioapics[i].phys);
+        io->id       = madt->ioapics[i].id;
+        io->gsi_base = madt->ioapics[i].gsi_base;
+        io->lock     = (spinlock_t)SPINLOCK_INIT("ioapic");
+        io->nr_pins  = ((ioapic_read(io, IOAPIC_REG_VER) >> 16) & 0xFF) + 1;
+
+        for (uint32_t pin = 0; pin < io->nr_pins; ++pin) {
+            ioapic_write(io, IOAPIC_REG_REDTBL(pin) + 1, 0);
+            ioapic_write(io, IOAPIC_REG_REDTBL(pin), IOAPIC_RTE_MASKED);
+        }
+        KLOG_INFO("ioapic", "IOAPIC id=%u @0x%llx GSI %u-%u (all masked)",
+                  io->id, (unsigned long long)madt->ioapics[i].phys,
+                  io->gsi_base, io->gsi_base + io->nr_pins - 1);
+    }
+    return 0;
+}
+
+uint32_t ioapic_isa_to_gsi(uint8_t irq, uint16_t* out_flags)
+{
+    const acpi_madt_info_t* madt = acpi_madt();
+    if (out_flags) *out_flags = IOAPIC_FLAGS_DEFAULT;
+    if (!madt) return irq;
+    for (int i = 0; i < madt->iso_count; ++i) {
+        if (madt->isos[i].bus == 0 && madt->isos[i].source == irq) {
+            if (out_flags) *out_flags = madt->isos[i].flags;
+            return madt->isos[i].gsi;
+        }
+    }
+    return irq;
+}
+
+int ioapic_route_gsi(uint32_t gsi, uint8_t vector, uint32_t dest_apic, uint16_t flags)
+{
+    uint32_t pin;
+    ioapic_t* io = ioapic_for_gsi(gsi, &pin);
+    if (!io) return -1;
+    /* 割込みリマップ無しの物理宛先は 8bit まで */
+    if (dest_apic > 0xFF) return -1;
+
+    uint32_t lo = vector | IOAPIC_RTE_DELIV_FIXED | IOAPIC_RTE_DEST_PHYS | IOAPIC_RTE_MASKED;
+    if ((flags & ACPI_INTI_POLARITY_MASK) == ACPI_INTI_POLARITY_LOW) lo |= IOAPIC_RTE_ACTIVE_LOW;
+    if ((flags & ACPI_INTI_TRIGGER_MASK)  == ACPI_INTI_TRIGGER_LEVEL) lo |= IOAPIC_RTE_LEVEL;
+
+    /* マスクしたまま書き換え、最後に呼び出し側が unmask する */
+    uint64_t irqf = spin_lock_irqsave(&io->lock);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin), IOAPIC_RTE_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin) + 1, dest_apic << 24);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin), lo);
+    spin_unlock_irqrestore(&io->lock, irqf);
+    return 0;
+}
+
+int ioapic_route_isa_irq(uint8_t irq, uint8_t vector, uint32_t dest_apic)
+{
+    uint16_t flags;
+    uint32_t gsi = ioapic_isa_to_gsi(irq, &flags);
+    return ioapic_route_gsi(gsi, vector, dest_apic, flags);
+}
+
+int ioapic_set_affinity(uint32_t gsi, uint32_t dest_apic)
+{
+    uint32_t pin;
+    ioapic_t* io = ioapic_for_gsi(gsi, &pin);
+    if (!io || dest_apic > 0xFF) return -1;
+
+    uint64_t irqf = spin_lock_irqsave(&io->lock);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin) + 1, dest_apic << 24);
+    spin_unlock_irqrestore(&io->lock, irqf);
+    return 0;
+}
+
+static int ioapic_update_mask(uint32_t gsi, int masked)
+{
+    uint32_t pin;
+    ioapic_t* io = ioapic_for_gsi(gsi, &pin);
+    if (!io) return -1;
+
+    uint64_t irqf = spin_lock_irqsave(&io->lock);
+    uint32_t lo = ioapic_read(io, IOAPIC_REG_REDTBL(pin));
+    lo = masked ? (lo | IOAPIC_RTE_MASKED) : (lo & ~IOAPIC_RTE_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDTBL(pin), lo);
+    spin_unlock_irqrestore(&io->lock, irqf);
+    return 0;
+}
+
+int ioapic_mask(uint32_t gsi)   { return ioapic_update_mask(gsi, 1); }
+int ioapic_unmask(uint32_t gsi) { return ioapic_update_mask(gsi, 0); }
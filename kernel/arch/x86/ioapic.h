@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * IOAPIC（MADT から検出）
+ *  - GSI ごとにリダイレクションエントリ（ベクタ・宛先 APIC ID・極性/トリガ）を書く
+ *  - ISA IRQ は MADT の Interrupt Source Override を通して GSI に直す
+ *  - 初期化時は全エントリをマスク。使う側が route → unmask する
+ * =========================================================== */
+
+/* IOAPIC レジスタ（間接アクセス：IOREGSEL に番号 → IOWIN で読み書き） */
+#define IOAPIC_REGSEL        0x00
+#define IOAPIC_IOWIN         0x10
+#define IOAPIC_REG_ID        0x00
+#define IOAPIC_REG_VER       0x01
+#define IOAPIC_REG_REDTBL(n) (0x10 + 2 * (n))
+
+/* リダイレクションエントリ（下位 32bit） */
+#define IOAPIC_RTE_DELIV_FIXED   (0u << 8)
+#define IOAPIC_RTE_DEST_PHYS     (0u << 11)
+#define IOAPIC_RTE_ACTIVE_LOW    (1u << 13)
+#define IOAPIC_RTE_LEVEL         (1u << 15)
+#define IOAPIC_RTE_MASKED        (1u << 16)
+
+/* ioapic_route_gsi の flags（ACPI の INTI flags をそのまま渡してよい） */
+#define IOAPIC_FLAGS_DEFAULT     0       /* バス既定（ISA: エッジ/High） */
+
+/* MADT から IOAPIC を登録し、全エントリをマスクする。IOAPIC 無しで -1 */
+int ioapic_init(void);
+
+/* GSI → (vector, dest_apic)。flags は ACPI_INTI_* 。0:ok / -1:該当 IOAPIC 無し等 */
+int ioapic_route_gsi(uint32_t gsi, uint8_t vector, uint32_t dest_apic, uint16_t flags);
+
+/* ISA IRQ（0-15）を ISO を考慮して route する */
+int ioapic_route_isa_irq(uint8_t irq, uint8_t vector, uint32_t dest_apic);
+
+/* 宛先 CPU だけ差し替える（割込み負荷の分散・vCPU 用コアからの退避） */
+int ioapic_set_affinity(uint32_t gsi, uint32_t dest_apic);
+
+int ioapic_mask(uint32_t gsi);
+int ioapic_unmask(uint32_t gsi);
+
+/* ISA IRQ → GSI（ISO が無ければ恒等） */
+uint32_t ioapic_isa_to_gsi(uint8_t irq, uint16_t* out_flags);
@@ -26,3 +26,56 @@ void intr_dispatch_entry(intr_context_t* ctx);
 typedef void (*intr_handler_t)(intr_context_t* ctx);
 void intr_register_handler(int vec, intr_handler_t fn);
 void intr_init_all_vectors(void);    /* 256本のスタブを IDT に登録し STI する */
+
+/* デバイス用ベクタ（VEC_DEVICE_FIRST..LAST）を 1 つ確保して fn を登録。失敗で -1 */
+int  intr_alloc_vector(intr_handler_t fn);
+void intr_free_vector(int vec);
+
+/* =========================== 高速経路 ===========================
+ * タイマ・IPI・デバイス IRQ のような頻度の高いベクタ用。
+ *  - caller-saved（rax rcx rdx rsi rdi r8-r11）だけを退避し、ハンドラを直接 call
+ *  - intr_context_t は作らない（ハンドラは引数なし）。EOI はハンドラ側で行う
+ *  - 例外（0..31）は従来どおり isr_common（全レジスタ保存）を通す
+ * 入口で RSP≡8 (mod 16)（CPU が 16B 整列してから 5 ワード push）なので、
+ * 9 本 push した時点で 16B 整列済み。再整列は不要。
+ *
+ * 使い方:
+ *   static void my_irq(void) { ...; lapic_eoi(); }
+ *   DEFINE_FAST_ISR(my_irq_stub, my_irq)
+ *   intr_register_fast(vec, my_irq_stub);
+ * ================================================================ */
+#define DEFINE_FAST_ISR(NAME, FN)                                        \
+    static void (*const NAME##_fn)(void) __attribute__((used)) = FN;     \
+    void NAME(void) __attribute__((naked));                              \
+    void NAME(void) {                                                    \
+        __asm__ __volatile__ (                                           \
+            "pushq %rax \n\t"                                            \
+            "pushq %rcx \n\t"                                            \
+            "pushq %rdx \n\t"                                            \
+            "pushq %rsi \n\t"                                            \
+            "pushq %rdi \n\t"                                            \
+            "pushq %r8  \n\t"                                            \
+            "pushq %r9  \n\t"                                            \
+            "pushq %r10 \n\t"                                            \
+            "pushq %r11 \n\t"                                            \
+            "cld        \n\t"                                            \
+            "call " #FN " \n\t"                                          \
+            "popq %r11  \n\t"                                            \
+            "popq %r10  \n\t"                                            \
+            "popq %r9   \n\t"                                            \
+            "popq %r8   \n\t"                                            \
+            "popq %rdi  \n\t"                                            \
+            "popq %rsi  \n\t"                                            \
+            "popq %rdx  \n\t"                                            \
+            "popq %rcx  \n\t"                                            \
+            "popq %rax  \n\t"                                            \
+            "iretq      \n\t"                                            \
+        );                                                               \
+    }
+
+/* vec（32..255）の IDT ゲートを高速スタブに差し替える（IDT は全 CPU 共有）。
+ * ゲートは 16B で原子的に書けないので、そのベクタが飛んで来ない状態で呼ぶこと。
+ * 失敗で -1 */
+int  intr_register_fast(int vec, void (*stub)(void));
+/* 共通経路（isr_stub_N → isr_common）へ戻す */
+void intr_unregister_fast(int vec);
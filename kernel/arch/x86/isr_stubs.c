@@ -7,12 +7,12 @@
 #define _PUSH0_IF0_0             "pushq $0\n\t"
 #define _PUSH0_IF0_1             /* empty */
 
-/* VEC: ベクタ番号、HASERR: そのベクタがエラーコードを自動 push するなら 1, しないなら 0 */
+/* VEC: ベクタ番号、HASERR: そのベクタがエラーコードを自動 push するなら 1, しないなら 0
+ * 全ゲートは interrupt gate（IF は CPU が落とす）なので、ここで cli は要らない */
 #define DEFINE_ISR_STUB(VEC, HASERR)                         \
     void isr_stub_##VEC(void) __attribute__((naked));        \
     void isr_stub_##VEC(void) {                              \
         __asm__ __volatile__ (                               \
-            "cli\n\t"                                        \
             _PUSH0_IF0(HASERR)                               \
             "pushq $" #VEC "\n\t"                            \
             "jmp isr_common\n\t"                             \
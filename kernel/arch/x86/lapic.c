@@ -0,0 +1,213 @@
+#include "arch/x86/lapic.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+#include "arch/x86/cpuid.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/isr.h"
+#include "ktime.h"
+#include "log.h"
+
+/* 動作モード（全 CPU 共通。BSP の lapic_init で決める）
+ *  - x2APIC : レジスタは MSR 0x800 + (offset >> 4)。EOI/ICR は WRMSR 1 回
+ *  - xAPIC  : MMIO（Direct Map 経由）。全 CPU で同じ物理アドレス */
+static int               g_x2apic     = -1;   /* -1: 未決定（決まるまでは xAPIC 扱い。判定は > 0） */
+static volatile uint8_t* g_lapic_mmio = 0;
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    if (g_x2apic > 0) return (uint32_t)rdmsr(X2APIC_MSR_BASE + (reg >> 4));
+    return *(volatile uint32_t*)(g_lapic_mmio + reg);
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val)
+{
+    if (g_x2apic > 0) { wrmsr(X2APIC_MSR_BASE + (reg >> 4), val); return; }
+    *(volatile uint32_t*)(g_lapic_mmio + reg) = val;
+}
+
+/* Spurious は EOI 不要。何もしない */
+static void lapic_spurious_handler(intr_context_t* ctx)
+{
+    (void)ctx;
+}
+
+static int cpu_has_x2apic(void)
+{
+    return (cpuid_leaf(1).ecx & (1u << 21)) != 0;
+}
+
+void lapic_init(void)
+{
+    uint64_t base = rdmsr(IA32_APIC_BASE_MSR);
+
+    if (g_x2apic < 0) {
+        g_x2apic = cpu_has_x2apic();
+        g_lapic_mmio = (volatile uint8_t*)(uintptr_t)phys2virt(base & APIC_BASE_ADDR_MASK);
+        intr_register_handler(LAPIC_SPURIOUS_VECTOR, lapic_spurious_handler);
+    }
+
+    /* EN → EXTD の順で立てる（EXTD 単独は不正な遷移） */
+    if (!(base & APIC_BASE_ENABLE)) {
+        base |= APIC_BASE_ENABLE;
+        wrmsr(IA32_APIC_BASE_MSR, base);
+    }
+    if (g_x2apic > 0 && !(base & APIC_BASE_X2APIC)) {
+        base |= APIC_BASE_X2APIC;
+        wrmsr(IA32_APIC_BASE_MSR, base);
+    }
+
+    /* 全優先度を受け付け、SVR でソフトウェア有効化 */
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    /* ESR は書いてから読む（前回エラーのクリア） */
+    lapic_write(LAPIC_REG_ESR, 0);
+    (void)lapic_read(LAPIC_REG_ESR);
+
+    KLOG_DEBUG("lapic", "LAPIC enabled: id=%u mode=%s", lapic_id(), g_x2apic > 0 ? "x2APIC" : "xAPIC");
+}
+
+int lapic_is_x2apic(void)
+{
+    return g_x2apic > 0;
+}
+
+uint32_t lapic_id(void)
+{
+    /* x2APIC の ID は 32bit そのまま、xAPIC は上位 8bit */
+    if (g_x2apic > 0) return (uint32_t)rdmsr(X2APIC_MSR_BASE + (LAPIC_REG_ID >> 4));
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+void lapic_eoi(void)
+{
+    if (g_x2apic > 0) wrmsr(X2APIC_MSR_EOI, 0);
+    else          *(volatile uint32_t*)(g_lapic_mmio + LAPIC_REG_EOI) = 0;
+}
+
+/* ---- タイマ ---- */
+static int      g_timer_deadline = -1;     /* -1: 未決定 */
+static uint64_t g_timer_ticks_per_tsc = 0; /* one-shot 用。LAPIC tick / TSC cycle（32.32 固定小数点） */
+
+#define LAPIC_TIMER_DIV16       0x3
+
+/* one-shot の分周後クロックを TSC に対して測る（10ms） */
+static int lapic_timer_calibrate(void)
+{
+    uint64_t hz = g_ktime.hz;
+    if (!hz) return -1;
+
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_LVT_TIMER_ONESHOT);
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV16);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+    uint64_t t0 = rdtsc(), dt;
+    while ((dt = rdtsc() - t0) < hz / 100) cpu_relax();
+    uint32_t ticks = 0xFFFFFFFFu - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    if (!ticks) return -1;
+    g_timer_ticks_per_tsc = ((uint64_t)ticks << 32) / dt;
+    KLOG_INFO("lapic", "timer: one-shot, %llu kHz after /16",
+              (unsigned long long)((uint64_t)ticks * 100 / 1000));
+    return 0;
+}
+
+int lapic_timer_init(uint8_t vector)
+{
+    if (g_timer_deadline < 0) {
+        g_timer_deadline = (cpuid_leaf(1).ecx & (1u << 24)) != 0;
+        if (!g_timer_deadline && lapic_timer_calibrate() != 0) {
+            g_timer_deadline = -1;
+            return -1;
+        }
+        if (g_timer_deadline) KLOG_INFO("lapic", "timer: TSC-deadline mode");
+    }
+
+    if (g_timer_deadline) {
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_TIMER_TSC_DEADLINE | vector);
+        /* LVT の書き込みを deadline MSR より先に見せる（SDM 10.5.4.1） */
+        __asm__ __volatile__("mfence" ::: "memory");
+        wrmsr(IA32_TSC_DEADLINE_MSR, 0);
+    } else {
+        lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV16);
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_TIMER_ONESHOT | vector);
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    }
+    return 0;
+}
+
+int lapic_timer_is_deadline(void)
+{
+    return g_timer_deadline > 0;
+}
+
+void lapic_timer_arm(uint64_t tsc_deadline)
+{
+    if (g_timer_deadline > 0) {
+        wrmsr(IA32_TSC_DEADLINE_MSR, tsc_deadline);
+        return;
+    }
+    if (!tsc_deadline) {
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+        return;
+    }
+    uint64_t now   = rdtsc();
+    uint64_t delta = tsc_deadline > now ? tsc_deadline - now : 1;
+    uint64_t count = (uint64_t)(((unsigned __int128)delta * g_timer_ticks_per_tsc) >> 32);
+    if (count == 0) count = 1;
+    if (count > 0xFFFFFFFFu) count = 0xFFFFFFFFu;   /* 長すぎる分は途中で一度起きて積み直す */
+    lapic_write(LAPIC_REG_TIMER_INIT, (uint32_t)count);
+}
+
+void lapic_write_lvt(uint32_t reg, uint32_t val)
+{
+    lapic_write(reg, val);
+}
+
+static void lapic_wait_icr_idle(void)
+{
+    while (lapic_read(LAPIC_REG_ICR_LO) & ICR_SEND_PENDING) cpu_relax();
+}
+
+static void lapic_send_icr(uint32_t apic_id, uint32_t lo)
+{
+    if (g_x2apic > 0) {
+        /* x2APIC の WRMSR は直列化しないので、先行するストア（キュー push 等）を見せてから送る。
+         * ICR は 64bit 1 回で完結し、Send Pending のポーリングも不要 */
+        __asm__ __volatile__("mfence; lfence" ::: "memory");
+        wrmsr(X2APIC_MSR_ICR, ((uint64_t)apic_id << 32) | lo);
+        return;
+    }
+    lapic_wait_icr_idle();
+    lapic_write(LAPIC_REG_ICR_HI, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LO, lo);     /* 下位の書き込みで送信される */
+    lapic_wait_icr_idle();
+}
+
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector)
+{
+    lapic_send_icr(apic_id, ICR_DELIVERY_FIXED | vector);
+}
+
+void lapic_send_ipi_allbut_self(uint8_t vector)
+{
+    lapic_send_icr(0, ICR_DEST_ALL_BUT_SELF | ICR_DELIVERY_FIXED | vector);
+}
+
+void lapic_send_self_ipi(uint8_t vector)
+{
+    if (g_x2apic > 0) { wrmsr(X2APIC_MSR_SELF_IPI, vector); return; }
+    lapic_send_icr(0, ICR_DEST_SELF | ICR_DELIVERY_FIXED | vector);
+}
+
+void lapic_send_init(uint32_t apic_id)
+{
+    lapic_send_icr(apic_id, ICR_DELIVERY_INIT | ICR_LEVEL_ASSERT | ICR_TRIGGER_LEVEL);
+    /* INIT de-assert（古い CPU 向け。最近の CPU は無視する） */
+    lapic_send_icr(apic_id, ICR_DELIVERY_INIT | ICR_TRIGGER_LEVEL);
+}
+
+void lapic_send_sipi(uint32_t apic_id, uint8_t start_page)
+{
+    lapic_send_icr(apic_id, ICR_DELIVERY_STARTUP | start_page);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include "arch/x86/vectors.h"
+
+/* ── Local APIC（x2APIC MSR / xAPIC MMIO） ─────────────────────────
+ * CPUID.1:ECX[21] があれば x2APIC、無ければ xAPIC（MMIO）で動かす。 */
+#define IA32_APIC_BASE_MSR      0x1B
+#define APIC_BASE_BSP           (1ULL << 8)
+#define APIC_BASE_X2APIC        (1ULL << 10)
+#define APIC_BASE_ENABLE        (1ULL << 11)
+#define APIC_BASE_ADDR_MASK     0x000FFFFFFFFFF000ULL
+
+/* レジスタオフセット（MMIO） */
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_VERSION       0x030
+#define LAPIC_REG_TPR           0x080
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0
+#define LAPIC_REG_ESR           0x280
+#define LAPIC_REG_ICR_LO        0x300
+#define LAPIC_REG_ICR_HI        0x310
+#define LAPIC_REG_LVT_TIMER     0x320
+#define LAPIC_REG_LVT_PERF      0x340
+#define LAPIC_REG_TIMER_INIT    0x380
+#define LAPIC_REG_TIMER_CUR     0x390
+#define LAPIC_REG_TIMER_DIV     0x3E0
+
+/* x2APIC MSR（= 0x800 + MMIO オフセット >> 4） */
+#define X2APIC_MSR_BASE         0x800
+#define X2APIC_MSR_EOI          0x80B
+#define X2APIC_MSR_ICR          0x830
+#define X2APIC_MSR_SELF_IPI     0x83F
+
+/* LVT 共通 */
+#define LAPIC_LVT_DELIVERY_NMI  (4u << 8)
+#define LAPIC_LVT_MASKED        (1u << 16)
+#define LAPIC_LVT_TIMER_ONESHOT (0u << 17)
+#define LAPIC_LVT_TIMER_TSC_DEADLINE (2u << 17)
+
+#define IA32_TSC_DEADLINE_MSR   0x6E0
+
+/* SVR */
+#define LAPIC_SVR_ENABLE        (1u << 8)
+#define LAPIC_SPURIOUS_VECTOR   VEC_SPURIOUS
+
+/* ICR（下位 32bit） */
+#define ICR_DELIVERY_FIXED      (0u << 8)
+#define ICR_DELIVERY_INIT       (5u << 8)
+#define ICR_DELIVERY_STARTUP    (6u << 8)
+#define ICR_SEND_PENDING        (1u << 12)
+#define ICR_LEVEL_ASSERT        (1u << 14)
+#define ICR_TRIGGER_LEVEL       (1u << 15)
+#define ICR_DEST_SELF           (1u << 18)
+#define ICR_DEST_ALL_BUT_SELF   (3u << 18)
+
+/* ── API ───────────────────────────────────────────────────────── */
+void     lapic_init(void);                  /* 自 CPU の LAPIC を有効化（BSP/AP 共通） */
+int      lapic_is_x2apic(void);
+uint32_t lapic_id(void);                    /* 自 CPU の APIC ID */
+void     lapic_eoi(void);                   /* x2APIC なら WRMSR 1 回 */
+void     lapic_write_lvt(uint32_t reg, uint32_t val);   /* LAPIC_REG_LVT_* を書く */
+
+/* ワンショットタイマ
+ *  - TSC-deadline モードがあれば IA32_TSC_DEADLINE に絶対時刻を書くだけ
+ *  - 無ければ one-shot モード。LAPIC タイマと TSC の比を最初に 1 回測って換算する
+ * lapic_timer_init は ktime（TSC）較正後に各 CPU で呼ぶ */
+int  lapic_timer_init(uint8_t vector);
+void lapic_timer_arm(uint64_t tsc_deadline);   /* 0 で停止 */
+int  lapic_timer_is_deadline(void);
+
+/* IPI 送信（完了＝Send Pending が落ちるまで待つ） */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+void lapic_send_ipi_allbut_self(uint8_t vector);            /* 宛先ショートハンドで 1 回の ICR 書き込み */
+void lapic_send_self_ipi(uint8_t vector);
+void lapic_send_init(uint32_t apic_id);
+void lapic_send_sipi(uint32_t apic_id, uint8_t start_page); /* 実行開始 = start_page << 12 */
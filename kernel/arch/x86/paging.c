@@ -168,20 +168,37 @@ int paging_reconstruct(void)
 
 static int g_mapping_reconstructed = 0;
 
+/* リンカスクリプトの配置（絶対シンボル）。__kernel_phys_text は上位ハーフの
+   コードから RIP 相対では届かないので movabs で読む */
+static inline uint64_t image_virt_base(void)
+{
+    uint64_t v;
+    __asm__("movabs $__kernel_virt_text, %0" : "=r"(v));
+    return v;
+}
+
+static inline uint64_t image_phys_base(void)
+{
+    uint64_t v;
+    __asm__("movabs $__kernel_phys_text, %0" : "=r"(v));
+    return v;
+}
+
 uint64_t paging_virt2phys(uint64_t va)
 {
+    if (va >= KERNEL_BASE) {
+        /* Kernel image 領域：ローダは各セグメントを AT() の物理へ置くので、
+           va - KERNEL_VADDR_TEXT + KERNEL_PHYS_TEXT（置換の前後で変わらない） */
+        return va - image_virt_base() + image_phys_base();
+    }
+
     if (!g_mapping_reconstructed) {
         /* 置換前＝UEFI のストレートマップ扱い（仮想==物理） */
         return va;
     }
 
-    if (va < KERNEL_BASE) {
-        /* Direct Map: va = DIRECT_MAP_BASE + pa */
-        return va - DIRECT_MAP_BASE;
-    } else {
-        /* Kernel image 領域: va = KERNEL_BASE + pa */
-        return va - KERNEL_BASE;
-    }
+    /* Direct Map: va = DIRECT_MAP_BASE + pa */
+    return va - DIRECT_MAP_BASE;
 }
 
 uint64_t paging_phys2virt(uint64_t pa)
@@ -207,3 +224,101 @@ int paging_reconstruct_and_mark(void)
     if (rc == 0) paging_mark_reconstructed();
     return rc;
 }
+
+/* ------- 4KiB 単位の map / unmap（再構築後の CR3 が対象） ------- */
+
+/* 下位テーブルを辿る。無ければ alloc=1 のとき確保して繋ぐ */
+static pt_t *walk_next(pt_t *tbl, uint16_t idx, int alloc)
+{
+    uint64_t pte = (*tbl)[idx];
+    if (pte & PTE_P) {
+        if (pte & PTE_PS) return NULL;   /* 大きいページは分割しない */
+        return pt_from_pte(pte);
+    }
+    if (!alloc) return NULL;
+
+    pt_t *next = alloc_pt_zeroed();
+    if (!next) return NULL;
+    uint64_t pa = paging_virt2phys((uint64_t)next);
+    (*tbl)[idx] = pte_from_pa(pa) | PTE_P | PTE_W;
+    return next;
+}
+
+int paging_map_4k(uint64_t va, uint64_t pa, uint64_t flags)
+{
+    if (!g_mapping_reconstructed || !g_new_lv4) return -1;
+    if ((va | pa) & 0xFFFULL) return -1;
+
+    pt_t *lv3 = walk_next(g_new_lv4, idx_lv4(va), 1);
+    if (!lv3) return -1;
+    pt_t *lv2 = walk_next(lv3, idx_lv3(va), 1);
+    if (!lv2) return -1;
+    pt_t *lv1 = walk_next(lv2, idx_lv2(va), 1);
+    if (!lv1) return -1;
+
+    uint64_t *e = &(*lv1)[idx_lv1(va)];
+    if (*e & PTE_P) return -1;           /* 二重マップは呼び出し側のバグ */
+
+    /* non-present → present なので無効化は不要 */
+    *e = pte_from_pa(pa) | (flags & ~PTE_ADDR_MASK) | PTE_P;
+    return 0;
+}
+
+static int lv1_is_empty(const pt_t *lv1)
+{
+    for (uint32_t i = 0; i < PT_ENTRIES; ++i) {
+        if ((*lv1)[i] & PTE_P) return 0;
+    }
+    return 1;
+}
+
+/* 大きいページ（PS=1）の葉か */
+static int is_large_leaf(uint64_t pte)
+{
+    return (pte & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+int paging_unmap_range(tlb_gather_t *g, uint64_t va, uint64_t size)
+{
+    if (!g_mapping_reconstructed || !g_new_lv4 || !g) return -1;
+    if (size == 0) return 0;
+    if (va + (size - 1) < va) return -1;     /* アドレス空間の末尾を越える */
+
+    /* 終端は「最後のページ」で持つ（末尾まで届く範囲でも 0 に回らない） */
+    uint64_t cur  = va & ~0xFFFULL;
+    uint64_t last = (va + (size - 1)) & ~0xFFFULL;
+
+    for (;;) {
+        /* この 2MiB 区間の最後のページ。next_2m が 0 に回っても引き算で末尾になる */
+        uint64_t next_2m  = (cur + (1ULL << LV2_SHIFT)) & ~((1ULL << LV2_SHIFT) - 1);
+        uint64_t seg_last = next_2m - 0x1000ULL;
+        if (seg_last > last) seg_last = last;
+
+        pt_t *lv3 = walk_next(g_new_lv4, idx_lv4(cur), 0);
+        if (lv3 && is_large_leaf((*lv3)[idx_lv3(cur)])) return -1;   /* 1GiB は分割しない */
+        pt_t *lv2 = lv3 ? walk_next(lv3, idx_lv3(cur), 0) : NULL;
+        if (lv2 && is_large_leaf((*lv2)[idx_lv2(cur)])) return -1;   /* 2MiB も同様 */
+        pt_t *lv1 = lv2 ? walk_next(lv2, idx_lv2(cur), 0) : NULL;
+
+        if (lv1) {
+            for (uint64_t p = cur; ; p += 0x1000ULL) {
+                uint64_t *e = &(*lv1)[idx_lv1(p)];
+                if (*e & PTE_P) {
+                    *e = 0;
+                    tlb_gather_add_page(g, p);
+                }
+                if (p == seg_last) break;
+            }
+
+            /* 空になった Lv1 はフラッシュ後に解放（Lv2 側の参照は今外す） */
+            if (lv1_is_empty(lv1)) {
+                (*lv2)[idx_lv2(cur)] = 0;
+                tlb_gather_free_table(g, lv1);
+            }
+        }
+
+        if (seg_last == last) break;
+        cur = seg_last + 0x1000ULL;
+    }
+    return 0;
+}
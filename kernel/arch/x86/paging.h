@@ -1,6 +1,7 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include "arch/x86/tlb.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,13 @@ uint64_t paging_phys2virt(uint64_t pa);
 uint64_t virt2phys(uint64_t va);
 uint64_t phys2virt(uint64_t pa);
 
+/* 4KiB 単位の map / unmap（paging_reconstruct_and_mark 後に使用）
+ *  - map は non-present への追加のみ（無効化不要）
+ *  - unmap は無効化を g に積むだけ。tlb_gather_finish() で反映される
+ *    2MiB/1GiB の葉に掛かる範囲は分割せず -1（そこまでに外した分は g に積まれている） */
+int paging_map_4k(uint64_t va, uint64_t pa, uint64_t flags);
+int paging_unmap_range(tlb_gather_t *g, uint64_t va, uint64_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,215 @@
+#include "arch/x86/pci.h"
+#include "arch/x86/arch_x86_io.h"
+#include "arch/x86/paging.h"
+#include "spinlock.h"
+#include "log.h"
+
+/* CONFIG_ADDRESS → CONFIG_DATA の 2 段アクセスを CPU 間で混ぜない */
+static DEFINE_SPINLOCK(g_pci_cfg_lock);
+
+static inline uint32_t cfg_addr(pci_addr_t a, uint8_t off)
+{
+    return 0x80000000u | ((uint32_t)a.bus << 16) | ((uint32_t)(a.dev & 0x1F) << 11)
+         | ((uint32_t)(a.fn & 0x7) << 8) | (off & 0xFC);
+}
+
+uint32_t pci_read32(pci_addr_t a, uint8_t off)
+{
+    uint64_t f = spin_lock_irqsave(&g_pci_cfg_lock);
+    outl(PCI_CONFIG_ADDR, cfg_addr(a, off));
+    uint32_t v = inl(PCI_CONFIG_DATA);
+    spin_unlock_irqrestore(&g_pci_cfg_lock, f);
+    return v;
+}
+
+uint16_t pci_read16(pci_addr_t a, uint8_t off)
+{
+    uint64_t f = spin_lock_irqsave(&g_pci_cfg_lock);
+    outl(PCI_CONFIG_ADDR, cfg_addr(a, off));
+    uint16_t v = inw((uint16_t)(PCI_CONFIG_DATA + (off & 2)));
+    spin_unlock_irqrestore(&g_pci_cfg_lock, f);
+    return v;
+}
+
+uint8_t pci_read8(pci_addr_t a, uint8_t off)
+{
+    uint64_t f = spin_lock_irqsave(&g_pci_cfg_lock);
+    outl(PCI_CONFIG_ADDR, cfg_addr(a, off));
+    uint8_t v = inb((uint16_t)(PCI_CONFIG_DATA + (off & 3)));
+    spin_unlock_irqrestore(&g_pci_cfg_lock, f);
+    return v;
+}
+
+void pci_write32(pci_addr_t a, uint8_t off, uint32_t v)
+{
+    uint64_t f = spin_lock_irqsave(&g_pci_cfg_lock);
+    outl(PCI_CONFIG_ADDR, cfg_addr(a, off));
+    outl(PCI_CONFIG_DATA, v);
+    spin_unlock_irqrestore(&g_pci_cfg_lock, f);
+}
+
+void pci_write16(pci_addr_t a, uint8_t off, uint16_t v)
+{
+    uint64_t f = spin_lock_irqsave(&g_pci_cfg_lock);
+    outl(PCI_CONFIG_ADDR, cfg_addr(a, off));
+    outw((uint16_t)(PCI_CONFIG_DATA + (off & 2)), v);
+    spin_unlock_irqrestore(&g_pci_cfg_lock, f);
+}
+
+void pci_enumerate(pci_enum_fn_t fn, void* ctx)
+{
+    if (!fn) return;
+    for (uint32_t bus = 0; bus < 256; ++bus) {
+        for (uint8_t dev = 0; dev < 32; ++dev) {
+            pci_addr_t a = { (uint8_t)bus, dev, 0 };
+            if (pci_read16(a, PCI_VENDOR_ID) == 0xFFFF) continue;
+
+            uint8_t nfn = (pci_read8(a, PCI_HEADER_TYPE) & 0x80) ? 8 : 1;
+            for (uint8_t f = 0; f < nfn; ++f) {
+                a.fn = f;
+                uint16_t vendor = pci_read16(a, PCI_VENDOR_ID);
+                if (vendor == 0xFFFF) continue;
+                fn(a, vendor, pci_read16(a, PCI_DEVICE_ID), pci_read32(a, PCI_CLASS_REV), ctx);
+            }
+        }
+    }
+}
+
+uint8_t pci_find_capability(pci_addr_t a, uint8_t cap_id)
+{
+    if (!(pci_read16(a, PCI_STATUS) & PCI_STATUS_CAP_LIST)) return 0;
+
+    uint8_t ptr = pci_read8(a, PCI_CAP_PTR) & 0xFC;
+    for (int guard = 0; ptr && guard < 48; ++guard) {   /* 壊れたリストで回り続けない */
+        if (pci_read8(a, ptr) == cap_id) return ptr;
+        ptr = pci_read8(a, (uint8_t)(ptr + 1)) & 0xFC;
+    }
+    return 0;
+}
+
+static void pci_disable_intx(pci_addr_t a)
+{
+    uint16_t cmd = pci_read16(a, PCI_COMMAND);
+    pci_write16(a, PCI_COMMAND, (uint16_t)(cmd | PCI_COMMAND_INTX_DISABLE));
+}
+
+/* ---- MSI ----
+ * cap+0x2: Message Control
+ * cap+0x4: Address (下位)、64bit なら cap+0x8 が上位
+ * cap+0x8 or 0xC: Data
+ * PVM 付きなら Data の後に Mask Bits */
+int pci_msi_enable(pci_addr_t a, uint8_t vector, uint32_t dest_apic)
+{
+    uint8_t cap = pci_find_capability(a, PCI_CAP_ID_MSI);
+    if (!cap || dest_apic > 0xFF) return -1;
+
+    uint16_t ctrl = pci_read16(a, (uint8_t)(cap + 2));
+    int is64 = (ctrl & PCI_MSI_CTRL_64BIT) != 0;
+
+    /* 書き換え中に古いメッセージが飛ばないよう一旦無効化 */
+    pci_write16(a, (uint8_t)(cap + 2), (uint16_t)(ctrl & ~PCI_MSI_CTRL_ENABLE));
+
+    pci_write32(a, (uint8_t)(cap + 4), MSI_ADDR_BASE | MSI_ADDR_DEST(dest_apic));
+    uint8_t data_off;
+    if (is64) {
+        pci_write32(a, (uint8_t)(cap + 8), 0);
+        data_off = (uint8_t)(cap + 0xC);
+    } else {
+        data_off = (uint8_t)(cap + 8);
+    }
+    pci_write16(a, data_off, vector);     /* Fixed / Edge */
+    if (ctrl & PCI_MSI_CTRL_PVM) pci_write32(a, (uint8_t)(data_off + 4), 0);
+
+    /* ベクタは 1 つだけ（MME=0） */
+    ctrl = (uint16_t)((ctrl & ~PCI_MSI_CTRL_MME_MASK) | PCI_MSI_CTRL_ENABLE);
+    pci_disable_intx(a);
+    pci_write16(a, (uint8_t)(cap + 2), ctrl);
+    return 0;
+}
+
+void pci_msi_disable(pci_addr_t a)
+{
+    uint8_t cap = pci_find_capability(a, PCI_CAP_ID_MSI);
+    if (!cap) return;
+    uint16_t ctrl = pci_read16(a, (uint8_t)(cap + 2));
+    pci_write16(a, (uint8_t)(cap + 2), (uint16_t)(ctrl & ~PCI_MSI_CTRL_ENABLE));
+}
+
+/* ---- MSI-X ----
+ * cap+0x2: Message Control、cap+0x4: Table Offset/BIR
+ * テーブルは BAR[BIR] + offset の MMIO（Direct Map 経由で触る） */
+static volatile uint32_t* msix_table(pci_addr_t a, uint8_t cap)
+{
+    uint32_t tbl = pci_read32(a, (uint8_t)(cap + 4));
+    uint8_t  bir = tbl & 0x7;
+    if (bir > 5) return NULL;
+
+    uint8_t  bar_off = (uint8_t)(PCI_BAR0 + bir * 4);
+    uint32_t bar_lo  = pci_read32(a, bar_off);
+    if (bar_lo & 1) return NULL;                      /* I/O BAR は不可 */
+
+    uint64_t base = bar_lo & ~0xFULL;
+    if (((bar_lo >> 1) & 0x3) == 0x2) {               /* 64bit BAR */
+        base |= (uint64_t)pci_read32(a, (uint8_t)(bar_off + 4)) << 32;
+    }
+    return (volatile uint32_t*)(uintptr_t)phys2virt(base + (tbl & ~0x7u));
+}
+
+int pci_msix_enable(pci_addr_t a)
+{
+    uint8_t cap = pci_find_capability(a, PCI_CAP_ID_MSIX);
+    if (!cap) return -1;
+
+    volatile uint32_t* t = msix_table(a, cap);
+    if (!t) return -1;
+
+    uint16_t ctrl = pci_read16(a, (uint8_t)(cap + 2));
+    int n = (int)(ctrl & PCI_MSIX_CTRL_TABLE_SIZE) + 1;
+
+    /* Function Mask を立てたまま有効化 → 全エントリをマスク → Function Mask を外す */
+    pci_write16(a, (uint8_t)(cap + 2),
+                (uint16_t)(ctrl | PCI_MSIX_CTRL_ENABLE | PCI_MSIX_CTRL_FUNC_MASK));
+    for (int i = 0; i < n; ++i) {
+        t[i * 4 + 3] |= PCI_MSIX_ENTRY_CTRL_MASK;
+    }
+    pci_disable_intx(a);
+    pci_write16(a, (uint8_t)(cap + 2),
+                (uint16_t)((ctrl | PCI_MSIX_CTRL_ENABLE) & ~PCI_MSIX_CTRL_FUNC_MASK));
+    return n;
+}
+
+int pci_msix_set_vector(pci_addr_t a, uint16_t entry, uint8_t vector, uint32_t dest_apic)
+{
+    uint8_t cap = pci_find_capability(a, PCI_CAP_ID_MSIX);
+    if (!cap || dest_apic > 0xFF) return -1;
+
+    uint16_t ctrl = pci_read16(a, (uint8_t)(cap + 2));
+    if (entry > (ctrl & PCI_MSIX_CTRL_TABLE_SIZE)) return -1;
+
+    volatile uint32_t* e = msix_table(a, cap);
+    if (!e) return -1;
+    e += entry * 4;
+
+    /* マスク → アドレス/データ更新 → アンマスク（途中のメッセージを出さない） */
+    e[3] |= PCI_MSIX_ENTRY_CTRL_MASK;
+    e[0] = MSI_ADDR_BASE | MSI_ADDR_DEST(dest_apic);
+    e[1] = 0;
+    e[2] = vector;
+    e[3] &= ~PCI_MSIX_ENTRY_CTRL_MASK;
+    return 0;
+}
+
+int pci_msix_mask(pci_addr_t a, uint16_t entry, int masked)
+{
+    uint8_t cap = pci_find_capability(a, PCI_CAP_ID_MSIX);
+    if (!cap) return -1;
+    uint16_t ctrl = pci_read16(a, (uint8_t)(cap + 2));
+    if (entry > (ctrl & PCI_MSIX_CTRL_TABLE_SIZE)) return -1;
+
+    volatile uint32_t* e = msix_table(a, cap);
+    if (!e) return -1;
+    e += entry * 4;
+    if (masked) e[3] |= PCI_MSIX_ENTRY_CTRL_MASK;
+    else        e[3] &= ~PCI_MSIX_ENTRY_CTRL_MASK;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * PCI コンフィグ空間（ポート 0xCF8/0xCFC の Mechanism #1）と MSI / MSI-X
+ *  - MSI/MSI-X のメッセージは LAPIC 宛て（0xFEE00000 | dest << 12）に直接書かれる
+ *    ので、IOAPIC を経由せずに任意の CPU・ベクタへ届けられる
+ *  - 有効化時は INTx を無効にする（Command.InterruptDisable）
+ * =========================================================== */
+
+#define PCI_CONFIG_ADDR      0xCF8
+#define PCI_CONFIG_DATA      0xCFC
+
+/* ヘッダの主なオフセット */
+#define PCI_VENDOR_ID        0x00
+#define PCI_DEVICE_ID        0x02
+#define PCI_COMMAND          0x04
+#define PCI_STATUS           0x06
+#define PCI_CLASS_REV        0x08
+#define PCI_HEADER_TYPE      0x0E
+#define PCI_BAR0             0x10
+#define PCI_CAP_PTR          0x34
+
+#define PCI_COMMAND_INTX_DISABLE (1u << 10)
+#define PCI_STATUS_CAP_LIST      (1u << 4)
+
+/* Capability ID */
+#define PCI_CAP_ID_MSI       0x05
+#define PCI_CAP_ID_MSIX      0x11
+
+/* MSI Message Control */
+#define PCI_MSI_CTRL_ENABLE      (1u << 0)
+#define PCI_MSI_CTRL_MME_MASK    (7u << 4)
+#define PCI_MSI_CTRL_64BIT       (1u << 7)
+#define PCI_MSI_CTRL_PVM         (1u << 8)   /* per-vector masking */
+
+/* MSI-X Message Control / テーブル */
+#define PCI_MSIX_CTRL_TABLE_SIZE 0x07FFu
+#define PCI_MSIX_CTRL_FUNC_MASK  (1u << 14)
+#define PCI_MSIX_CTRL_ENABLE     (1u << 15)
+#define PCI_MSIX_ENTRY_SIZE      16
+#define PCI_MSIX_ENTRY_CTRL_MASK (1u << 0)
+
+/* メッセージアドレス（LAPIC 宛て、物理宛先） */
+#define MSI_ADDR_BASE        0xFEE00000u
+#define MSI_ADDR_DEST(id)    ((uint32_t)(id) << 12)
+
+typedef struct pci_addr {
+    uint8_t bus;
+    uint8_t dev;
+    uint8_t fn;
+} pci_addr_t;
+
+/* ---- コンフィグ空間アクセス ---- */
+uint32_t pci_read32(pci_addr_t a, uint8_t off);
+uint16_t pci_read16(pci_addr_t a, uint8_t off);
+uint8_t  pci_read8 (pci_addr_t a, uint8_t off);
+void     pci_write32(pci_addr_t a, uint8_t off, uint32_t v);
+void     pci_write16(pci_addr_t a, uint8_t off, uint16_t v);
+
+/* 見つかった function ごとに fn を呼ぶ */
+typedef void (*pci_enum_fn_t)(pci_addr_t a, uint16_t vendor, uint16_t device,
+                              uint32_t class_rev, void* ctx);
+void pci_enumerate(pci_enum_fn_t fn, void* ctx);
+
+/* capability リストを辿って cap_id の位置を返す（無ければ 0） */
+uint8_t pci_find_capability(pci_addr_t a, uint8_t cap_id);
+
+/* ---- MSI ---- */
+/* 単一ベクタで MSI を有効化（dest_apic はその CPU の APIC ID）。0:ok / -1:MSI 無し */
+int  pci_msi_enable(pci_addr_t a, uint8_t vector, uint32_t dest_apic);
+void pci_msi_disable(pci_addr_t a);
+
+/* ---- MSI-X ---- */
+/* 全エントリをマスクした状態で MSI-X を有効化。戻り値はテーブルのエントリ数（-1: 無し） */
+int pci_msix_enable(pci_addr_t a);
+/* entry 番目を (vector, dest_apic) に向けてアンマスク。アフィニティ変更にも使う */
+int pci_msix_set_vector(pci_addr_t a, uint16_t entry, uint8_t vector, uint32_t dest_apic);
+int pci_msix_mask(pci_addr_t a, uint16_t entry, int masked);
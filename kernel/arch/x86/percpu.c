@@ -0,0 +1,126 @@
+#include "arch/x86/percpu.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/paging.h"
+#include "page_alloc.h"
+#include "memmap.h"
+#include "common.h"
+#include "log.h"
+
+/* リンカスクリプトの BSP スタック */
+extern uint8_t __stack_bottom[];
+extern uint8_t __stack_top[];
+
+static percpu_t  g_bsp_cpu;
+static percpu_t* g_cpus[MAX_CPUS];
+static uint32_t  g_cpu_count = 0;
+static percpu_t* g_spare = NULL;     /* 起動に失敗した AP の領域（スタックごと次の AP に回す） */
+
+void percpu_install(percpu_t* cpu)
+{
+    wrmsr(IA32_GS_BASE, (uint64_t)(uintptr_t)cpu);
+}
+
+void percpu_init_bsp(void)
+{
+    percpu_t* c = &g_bsp_cpu;
+    memset(c, 0, sizeof(*c));
+    c->self         = c;
+    c->cpu_id       = 0;
+    c->stack_bottom = (uint64_t)(uintptr_t)__stack_bottom;
+    c->stack_top    = (uint64_t)(uintptr_t)__stack_top;
+    c->gdt          = gdt_bsp_table();
+    c->online       = 1;
+
+    g_cpus[0]   = c;
+    g_cpu_count = 1;
+    percpu_install(c);
+}
+
+void percpu_finish_bsp(uint32_t apic_id)
+{
+    g_bsp_cpu.apic_id    = apic_id;
+    g_bsp_cpu.idtr       = idt_get_idtr();
+    g_bsp_cpu.active_cr3 = read_cr3();
+}
+
+/* スロット: [guard 4KiB][stack CPU_STACK_PAGES][未マップ...]
+ * 下端のガードでオーバーフローを #PF として捕まえる */
+static int map_cpu_stack(percpu_t* c)
+{
+    uint64_t slot   = CPU_STACK_REGION_BASE + (uint64_t)c->cpu_id * CPU_STACK_SLOT_SIZE;
+    uint64_t bottom = slot + PAGE_SIZE_4K;
+
+    for (uint32_t i = 0; i < CPU_STACK_PAGES; ++i) {
+        void* pg = page_alloc_4k_aligned();
+        if (!pg) return -1;
+        memset(pg, 0, PAGE_SIZE_4K);
+        uint64_t va = bottom + (uint64_t)i * PAGE_SIZE_4K;
+        if (paging_map_4k(va, virt2phys((uint64_t)(uintptr_t)pg),
+                          PTE_W | PTE_A | PTE_D | PTE_G | PTE_NX) != 0) {
+            return -1;
+        }
+    }
+
+    c->stack_bottom = bottom;
+    c->stack_top    = bottom + (uint64_t)CPU_STACK_PAGES * PAGE_SIZE_4K;
+    return 0;
+}
+
+percpu_t* percpu_alloc_ap(uint32_t apic_id)
+{
+    if (g_cpu_count >= MAX_CPUS) return NULL;
+
+    /* 同じ番号のスタックスロットはマップ済みなので、そのまま使い回す */
+    if (g_spare && g_spare->cpu_id == g_cpu_count) {
+        percpu_t* c = g_spare;
+        uint64_t bottom = c->stack_bottom, top = c->stack_top;
+        g_spare = NULL;
+        memset(c, 0, sizeof(*c));
+        c->self         = c;
+        c->cpu_id       = g_cpu_count;
+        c->apic_id      = apic_id;
+        c->gdt          = &c->gdt_area;
+        c->idtr         = idt_get_idtr();
+        c->stack_bottom = bottom;
+        c->stack_top    = top;
+        g_cpus[g_cpu_count++] = c;
+        return c;
+    }
+
+    size_t pages = (sizeof(percpu_t) + PAGE_SIZE_4K - 1) / PAGE_SIZE_4K;
+    percpu_t* c = (percpu_t*)page_alloc_pages(pages, PAGE_SIZE_4K);
+    if (!c) return NULL;
+    memset(c, 0, sizeof(*c));
+
+    c->self    = c;
+    c->cpu_id  = g_cpu_count;
+    c->apic_id = apic_id;
+    c->gdt     = &c->gdt_area;
+    c->idtr    = idt_get_idtr();
+
+    if (map_cpu_stack(c) != 0) {
+        KLOG_ERROR("percpu", "stack map failed for cpu%u", c->cpu_id);
+        page_free_bytes(c, pages * PAGE_SIZE_4K);
+        return NULL;
+    }
+
+    g_cpus[g_cpu_count++] = c;
+    return c;
+}
+
+void percpu_release_ap(percpu_t* c)
+{
+    if (!c || c->cpu_id == 0 || c->cpu_id + 1 != g_cpu_count || g_cpus[c->cpu_id] != c) return;
+    g_cpus[--g_cpu_count] = NULL;
+    g_spare = c;
+}
+
+percpu_t* percpu_get(uint32_t cpu_id)
+{
+    return (cpu_id < g_cpu_count) ? g_cpus[cpu_id] : NULL;
+}
+
+uint32_t percpu_count(void)
+{
+    return g_cpu_count;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "arch/x86/gdt.h"
+#include "arch/x86/idt.h"
+
+/* =========================== 概要 ===========================
+ * CPU ごとのデータ領域
+ *  - GS base に自分の percpu_t を指させる（gs:0 は self ポインタ）
+ *  - this_cpu() は 1 命令（mov %gs:0）で取れる
+ *  - BSP は静的領域、AP は page_alloc から確保（Direct Map 上）
+ * =========================================================== */
+
+enum { MAX_CPUS = 64 };
+
+struct smp_call_entry;
+struct work;
+
+typedef struct percpu {
+    struct percpu*  self;          /* gs:0 固定。this_cpu() が読む */
+    uint32_t        cpu_id;        /* 論理 CPU 番号（BSP=0、起動順） */
+    uint32_t        apic_id;       /* Local APIC ID */
+    uint64_t        stack_bottom;  /* 使用可能範囲 [bottom, top) */
+    uint64_t        stack_top;
+    gdt_cpu_t*      gdt;           /* この CPU がロードした GDT/TSS */
+    const idtr_t*   idtr;          /* IDT は全 CPU 共有 */
+    volatile uint32_t online;      /* AP が初期化完了したら 1 */
+    volatile uint64_t active_cr3;  /* 今ロードしている CR3（TLB shootdown の宛先選別用） */
+    struct smp_call_entry* volatile call_queue;  /* smp_call_function の受信キュー（MPSC） */
+    volatile uint32_t softirq_pending;   /* raise_softirq のビット（自 CPU のみが立てる/取る） */
+    uint32_t        softirq_active;      /* softirq 実行中（割込み出口での再入防止） */
+    struct work* volatile work_queue;    /* queue_work の受信キュー（MPSC、idle で処理） */
+    volatile uint32_t work_depth;        /* キュー中の work 数 */
+
+    gdt_cpu_t       gdt_area;      /* AP 用の GDT/TSS 実体（BSP は gdt.c の静的領域） */
+} __attribute__((aligned(64))) percpu_t;
+
+/* 現在 CPU の percpu_t（percpu_init_bsp / AP 初期化後に有効） */
+static inline percpu_t* this_cpu(void)
+{
+    percpu_t* p;
+    __asm__ __volatile__("movq %%gs:0, %0" : "=r"(p));
+    return p;
+}
+
+static inline uint32_t this_cpu_id(void)
+{
+    uint32_t id;
+    __asm__ __volatile__("movl %%gs:%c1, %0" : "=r"(id) : "i"(offsetof(percpu_t, cpu_id)));
+    return id;
+}
+
+/* BSP の percpu を GS base に設定（kernelMain の最初に呼ぶ） */
+void percpu_init_bsp(void);
+
+/* BSP の残りの項目（APIC ID・GDT・IDT）を埋める。lapic_init / IDT 構築後に呼ぶ */
+void percpu_finish_bsp(uint32_t apic_id);
+
+/* AP 用の percpu を確保し、ガード付きスタックをマップする。失敗で NULL */
+percpu_t* percpu_alloc_ap(uint32_t apic_id);
+
+/* 起動できなかった AP の登録を取り消す（直前に確保した分のみ）。
+ * 領域とスタックは解放せず、次の percpu_alloc_ap が同じ番号で使い回す */
+void percpu_release_ap(percpu_t* cpu);
+
+/* 自 CPU の GS base を cpu に向ける */
+void percpu_install(percpu_t* cpu);
+
+/* 論理番号から引く（未登録なら NULL） */
+percpu_t* percpu_get(uint32_t cpu_id);
+
+/* 登録済み（確保済み）CPU 数 */
+uint32_t percpu_count(void);
@@ -1,5 +1,6 @@
 #include "arch/x86/pic.h"
 #include "arch/x86/arch_x86_io.h"
+#include "arch/x86/isr.h"
 
 
 /* ── ICW/OCW 定数 ──────────────────────────────────────────────── */
@@ -10,8 +11,12 @@
 #define OCW3_READ_IRR  0x0A
 #define OCW3_READ_ISR  0x0B
 
-static inline void pic_set_imr_primary(uint8_t imr) { outb(PIC1_DATA, imr); }
-static inline void pic_set_imr_secondary(uint8_t imr){ outb(PIC2_DATA, imr); }
+/* IMR のキャッシュ。マスク変更は読み戻し無しの outb 1 回で済ませる */
+static uint8_t g_imr1 = 0xFF;
+static uint8_t g_imr2 = 0xFF;
+
+static inline void pic_set_imr_primary(uint8_t imr) { g_imr1 = imr; outb(PIC1_DATA, imr); }
+static inline void pic_set_imr_secondary(uint8_t imr){ g_imr2 = imr; outb(PIC2_DATA, imr); }
 
 /* ── 初期化：再マップ、カスケード設定、ICW4 設定、全マスク ─────────── */
 void pic_init(void)
@@ -48,29 +53,44 @@ void pic_init(void)
 void pic_set_mask(pic_irq_t irq)
 {
     if (pic_irq_is_primary(irq)) {
-        uint8_t imr = inb(PIC1_DATA);
-        imr |= (1u << pic_irq_delta(irq));
-        outb(PIC1_DATA, imr);
+        pic_set_imr_primary((uint8_t)(g_imr1 | (1u << pic_irq_delta(irq))));
     } else {
-        uint8_t imr = inb(PIC2_DATA);
-        imr |= (1u << pic_irq_delta(irq));
-        outb(PIC2_DATA, imr);
+        pic_set_imr_secondary((uint8_t)(g_imr2 | (1u << pic_irq_delta(irq))));
     }
 }
 
 void pic_clear_mask(pic_irq_t irq)
 {
     if (pic_irq_is_primary(irq)) {
-        uint8_t imr = inb(PIC1_DATA);
-        imr &= ~(1u << pic_irq_delta(irq));
-        outb(PIC1_DATA, imr);
+        pic_set_imr_primary((uint8_t)(g_imr1 & ~(1u << pic_irq_delta(irq))));
     } else {
-        uint8_t imr = inb(PIC2_DATA);
-        imr &= ~(1u << pic_irq_delta(irq));
-        outb(PIC2_DATA, imr);
+        pic_set_imr_secondary((uint8_t)(g_imr2 & ~(1u << pic_irq_delta(irq))));
     }
 }
 
+/* ── 無効化：LAPIC に任せる ─────────────────────────────────────
+ * 再マップして全マスク。マスク後も IRQ7/15 の spurious は届きうるので、
+ * そのベクタだけ黙って捨てる。spurious に secondary の EOI は送らない */
+static void pic_spurious_primary(intr_context_t* ctx)
+{
+    (void)ctx;
+}
+
+/* secondary の spurious でも primary 側はカスケード（IRQ2）を本物として
+ * ISR に立てているので、primary にだけ EOI を返す */
+static void pic_spurious_secondary(intr_context_t* ctx)
+{
+    (void)ctx;
+    outb(PIC1_CMD, OCW2_EOI | 2); /* IRQ2 */
+}
+
+void pic_disable(void)
+{
+    pic_init();
+    intr_register_handler(PIC_PRIMARY_OFFSET + IRQ_PARALLEL1, pic_spurious_primary);
+    intr_register_handler(PIC_SECONDARY_OFFSET + (IRQ_SECONDARY_ATA - 8), pic_spurious_secondary);
+}
+
 /* ── Specific EOI ─────────────────────────────────────────────── */
 void pic_notify_eoi(pic_irq_t irq)
 {
@@ -33,6 +33,7 @@ typedef enum {
 
 /* ── API ───────────────────────────────────────────────────────── */
 void pic_init(void);                    /* 再マップ＋全マスク */
+void pic_disable(void);                 /* 全マスク＋spurious(IRQ7/15) を無視（LAPIC 運用時） */
 void pic_set_mask(pic_irq_t irq);       /* その IRQ をマスク   */
 void pic_clear_mask(pic_irq_t irq);     /* その IRQ をアンマスク */
 void pic_notify_eoi(pic_irq_t irq);     /* Specific EOI (slave時は両方) */
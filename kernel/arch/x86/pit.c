@@ -0,0 +1,37 @@
+#include "arch/x86/pit.h"
+#include "arch/x86/arch_x86_io.h"
+
+/* 1 回でカウントできる上限（16bit）に収まるよう分割する。~50ms 単位 */
+#define PIT_MAX_CHUNK_US  50000u
+
+static void pit_delay_chunk(uint32_t us)
+{
+    uint32_t count = (uint32_t)(((uint64_t)PIT_FREQ_HZ * us) / 1000000u);
+    if (count == 0) count = 1;
+    if (count > 0xFFFF) count = 0xFFFF;
+
+    /* ゲート OFF・スピーカ OFF */
+    uint8_t b = inb(PIT_PORT_B);
+    b = (uint8_t)((b & ~0x03) | 0x00);
+    outb(PIT_PORT_B, b);
+
+    /* ch2, lobyte/hibyte, mode 0 (interrupt on terminal count), binary */
+    outb(PIT_CMD, 0xB0);
+    outb(PIT_CH2_DATA, (uint8_t)(count & 0xFF));
+    outb(PIT_CH2_DATA, (uint8_t)(count >> 8));
+
+    /* ゲート ON でカウント開始。終端で OUT2 が 1 になる */
+    outb(PIT_PORT_B, (uint8_t)(b | 0x01));
+    while (!(inb(PIT_PORT_B) & 0x20)) cpu_relax();
+
+    outb(PIT_PORT_B, b);
+}
+
+void pit_delay_us(uint32_t us)
+{
+    while (us > PIT_MAX_CHUNK_US) {
+        pit_delay_chunk(PIT_MAX_CHUNK_US);
+        us -= PIT_MAX_CHUNK_US;
+    }
+    if (us) pit_delay_chunk(us);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+/* ── 8254 PIT ──────────────────────────────────────────────────────
+ * 割込みを使わず、チャンネル 2（スピーカゲート）をポーリングして待つ。
+ * LAPIC タイマ等の較正前でも使える唯一の時間源。
+ */
+#define PIT_FREQ_HZ      1193182u
+#define PIT_CH2_DATA     0x42
+#define PIT_CMD          0x43
+#define PIT_PORT_B       0x61   /* bit0: ch2 gate, bit1: speaker, bit5: ch2 OUT */
+
+/* us マイクロ秒ビジーウェイト（精度は ~1us 程度） */
+void pit_delay_us(uint32_t us);
@@ -0,0 +1,202 @@
+#include "arch/x86/prof.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/smp.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/cpuid.h"
+#include "arch/x86/arch_x86_low.h"
+#include "ksyms.h"
+#include "log.h"
+
+/* アーキテクチャ PMU の MSR */
+#define IA32_PMC0                   0x0C1
+#define IA32_PERFEVTSEL0            0x186
+#define IA32_PERF_GLOBAL_STATUS     0x38E
+#define IA32_PERF_GLOBAL_CTRL       0x38F
+#define IA32_PERF_GLOBAL_OVF_CTRL   0x390
+
+/* PERFEVTSEL */
+#define EVTSEL_UNHALTED_CORE_CYCLES 0x003C   /* event 0x3C / umask 0x00 */
+#define EVTSEL_USR                  (1u << 16)
+#define EVTSEL_OS                   (1u << 17)
+#define EVTSEL_INT                  (1u << 20)
+#define EVTSEL_EN                   (1u << 22)
+
+#define NMI_VECTOR                  2
+
+typedef struct prof_ring {
+    uint64_t rip[PROF_RING_SIZE];
+    uint64_t head;            /* 通算サンプル数（書き込み位置は head & (SIZE-1)） */
+    uint64_t spurious;        /* PMC0 のオーバーフローでなかった NMI */
+} __attribute__((aligned(64))) prof_ring_t;
+
+static prof_ring_t g_ring[MAX_CPUS];
+static volatile uint32_t g_period  = 0;
+static volatile uint32_t g_running = 0;
+static volatile uint32_t g_nmi_registered = 0;
+
+/* 32bit 書き込みは符号拡張されるので -period（< 2^31）がそのまま入る */
+static inline void pmc0_rearm(void)
+{
+    wrmsr(IA32_PMC0, (uint64_t)(-(int64_t)g_period));
+}
+
+/* NMI 文脈。ロックもログも使わない */
+static void prof_sample(uint64_t rip)
+{
+    prof_ring_t* r = &g_ring[this_cpu_id()];
+    if (!(rdmsr(IA32_PERF_GLOBAL_STATUS) & 1)) {
+        r->spurious++;
+        return;
+    }
+    r->rip[r->head & (PROF_RING_SIZE - 1)] = rip;
+    r->head++;
+
+    pmc0_rearm();
+    wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+    lapic_write_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_DELIVERY_NMI);   /* PMI 配送で自動マスクされる */
+}
+
+static void prof_nmi_handler(intr_context_t* ctx)
+{
+    prof_sample(ctx->rip);
+}
+
+void prof_guest_nmi(void)
+{
+    prof_sample(PROF_RIP_GUEST);
+}
+
+static int pmu_supported(void)
+{
+    if (cpuid_leaf(0).eax < 0xA) return 0;
+    cpuid_regs_t r = cpuid_leaf(0xA);
+    uint32_t version = r.eax & 0xFF;
+    uint32_t ngp     = (r.eax >> 8) & 0xFF;
+    uint32_t ebx_len = (r.eax >> 24) & 0xFF;
+    /* EBX bit0 = 1 は「コアサイクル事象が使えない」 */
+    return version >= 2 && ngp >= 1 && ebx_len >= 1 && !(r.ebx & 1);
+}
+
+static void prof_cpu_start(void* arg)
+{
+    (void)arg;
+    wrmsr(IA32_PERF_GLOBAL_CTRL, 0);
+    wrmsr(IA32_PERFEVTSEL0, 0);
+    pmc0_rearm();
+    wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+    lapic_write_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_DELIVERY_NMI);
+    wrmsr(IA32_PERFEVTSEL0, EVTSEL_UNHALTED_CORE_CYCLES | EVTSEL_USR | EVTSEL_OS |
+                            EVTSEL_INT | EVTSEL_EN);
+    wrmsr(IA32_PERF_GLOBAL_CTRL, 1);
+}
+
+static void prof_cpu_stop(void* arg)
+{
+    (void)arg;
+    wrmsr(IA32_PERF_GLOBAL_CTRL, 0);
+    wrmsr(IA32_PERFEVTSEL0, 0);
+    lapic_write_lvt(LAPIC_REG_LVT_PERF, LAPIC_LVT_DELIVERY_NMI | LAPIC_LVT_MASKED);
+    wrmsr(IA32_PERF_GLOBAL_OVF_CTRL, 1);
+}
+
+int prof_start(uint32_t period)
+{
+    if (!pmu_supported()) {
+        KLOG_WARN("prof", "architectural PMU v2 not available");
+        return -1;
+    }
+    if (period < 10000) period = 10000;          /* NMI 嵐を避ける */
+    if (period > 0x7FFFFFFFu) period = 0x7FFFFFFFu;
+
+    if (!__atomic_exchange_n(&g_nmi_registered, 1, __ATOMIC_ACQ_REL)) {
+        intr_register_handler(NMI_VECTOR, prof_nmi_handler);
+    }
+    g_period = period;
+    __atomic_store_n(&g_running, 1, __ATOMIC_RELEASE);
+    smp_call_function(smp_online_mask(), prof_cpu_start, NULL, 1);
+    KLOG_INFO("prof", "sampling every %u cycles", period);
+    return 0;
+}
+
+void prof_stop(void)
+{
+    if (!__atomic_exchange_n(&g_running, 0, __ATOMIC_ACQ_REL)) return;
+    smp_call_function(smp_online_mask(), prof_cpu_stop, NULL, 1);
+}
+
+int prof_is_running(void)
+{
+    return __atomic_load_n(&g_running, __ATOMIC_ACQUIRE) != 0;
+}
+
+void prof_reset(void)
+{
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; ++cpu) {
+        g_ring[cpu].head = 0;
+        g_ring[cpu].spurious = 0;
+    }
+}
+
+/* ---- 集計 ----
+ * キー：ksyms のインデックス（-1 = 表に無い、-2 = ゲスト）
+ * 開番地ハッシュで数え、上位 n を選択ソートで取り出す */
+#define PROF_TOP_SLOTS   1024
+#define KEY_UNKNOWN      (-1)
+#define KEY_GUEST        (-2)
+
+typedef struct prof_bucket {
+    int64_t  key;
+    uint64_t count;
+} prof_bucket_t;
+
+static prof_bucket_t g_buckets[PROF_TOP_SLOTS];
+
+static void bucket_add(int64_t key)
+{
+    uint32_t h = (uint32_t)((uint64_t)key * 0x9E3779B97F4A7C15ULL >> 54) & (PROF_TOP_SLOTS - 1);
+    for (uint32_t i = 0; i < PROF_TOP_SLOTS; ++i) {
+        prof_bucket_t* b = &g_buckets[(h + i) & (PROF_TOP_SLOTS - 1)];
+        if (b->count == 0) { b->key = key; b->count = 1; return; }
+        if (b->key == key) { b->count++; return; }
+    }
+}
+
+void prof_report_top(int n)
+{
+    uint64_t total = 0, spurious = 0;
+    for (uint32_t i = 0; i < PROF_TOP_SLOTS; ++i) g_buckets[i].count = 0;
+
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) {
+        const prof_ring_t* r = &g_ring[cpu];
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        uint64_t cnt  = head < PROF_RING_SIZE ? head : PROF_RING_SIZE;
+        for (uint64_t i = 0; i < cnt; ++i) {
+            uint64_t rip = r->rip[(head - 1 - i) & (PROF_RING_SIZE - 1)];
+            int64_t key  = (rip == PROF_RIP_GUEST) ? KEY_GUEST : ksym_index(rip);
+            bucket_add(key < 0 && key != KEY_GUEST ? KEY_UNKNOWN : key);
+            ++total;
+        }
+        spurious += r->spurious;
+    }
+
+    KLOG_INFO("prof", "top %d of %llu samples (spurious NMIs %llu):", n,
+              (unsigned long long)total, (unsigned long long)spurious);
+    if (!total) return;
+
+    for (int k = 0; k < n; ++k) {
+        prof_bucket_t* best = NULL;
+        for (uint32_t i = 0; i < PROF_TOP_SLOTS; ++i) {
+            if (g_buckets[i].count && (!best || g_buckets[i].count > best->count)) best = &g_buckets[i];
+        }
+        if (!best) break;
+
+        const char* name = best->key == KEY_GUEST   ? "[guest]"
+                         : best->key == KEY_UNKNOWN ? "[unknown]"
+                         : ksym_name(best->key);
+        uint64_t permille = best->count * 1000 / total;
+        KLOG_INFO("prof", "%8llu %3llu.%llu%%  %s", (unsigned long long)best->count,
+                  (unsigned long long)(permille / 10), (unsigned long long)(permille % 10), name);
+        best->count = 0;
+    }
+}
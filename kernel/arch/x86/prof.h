@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * PMU サンプリングプロファイラ（perf top 相当）
+ *  - アーキテクチャ性能カウンタ PMC0 に「アンハルテッド・コアサイクル」を数えさせ、
+ *    period 回ごとのオーバーフローを LAPIC LVT Perf 経由で NMI として受ける
+ *  - NMI で割込まれた RIP を CPU ごとのリングに記録（自 CPU しか書かない）
+ *  - ゲスト実行中の NMI は VM-exit（NMI exiting）になり、[guest] として数える
+ *  - 集計はリンク時に埋め込んだシンボル表（ksyms）で関数単位にまとめる
+ * 要件: CPUID.0AH の PMU バージョン 2 以上（GLOBAL_CTRL/STATUS を使う）
+ * =========================================================== */
+
+#define PROF_RING_SIZE      1024          /* 2 の冪 */
+#define PROF_RIP_GUEST      0ULL          /* ゲスト実行中のサンプル */
+
+/* online の全 CPU でサンプリング開始。period はサンプル間隔（コアサイクル、< 2^31）。
+ * PMU が無い/古いなら -1 */
+int  prof_start(uint32_t period);
+void prof_stop(void);
+int  prof_is_running(void);
+
+/* NMI exiting で VM-exit したときに VMM から呼ぶ */
+void prof_guest_nmi(void);
+
+/* 全 CPU のサンプルを関数ごとに集計し、多い順に n 個を KLOG に出す */
+void prof_report_top(int n);
+
+/* 記録済みサンプルを捨てる */
+void prof_reset(void);
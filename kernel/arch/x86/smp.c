@@ -0,0 +1,239 @@
+#include "arch/x86/smp.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/vectors.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/tlb.h"
+#include "arch/x86/intr_stat.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+#include "bin_alloc.h"
+#include "log.h"
+
+static int g_ipi_registered = 0;
+
+cpumask_t smp_online_mask(void)
+{
+    cpumask_t m = 0;
+    uint32_t n = percpu_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        percpu_t* c = percpu_get(i);
+        if (c && __atomic_load_n(&c->online, __ATOMIC_ACQUIRE)) m |= CPUMASK_CPU(i);
+    }
+    return m;
+}
+
+/* ---- 受信側 ---- */
+
+static void run_entry(smp_call_entry_t* e)
+{
+    /* pending を減らした瞬間に送信側のスタック上の e が消えうるので先に読む */
+    smp_call_fn_t      fn      = e->fn;
+    void*              arg     = e->arg;
+    volatile uint32_t* pending = e->pending;
+
+    fn(arg);
+
+    if (pending) __atomic_sub_fetch(pending, 1, __ATOMIC_RELEASE);
+    else         kfree(e, sizeof(*e));
+}
+
+void smp_call_drain_local(void)
+{
+    percpu_t* me = this_cpu();
+    smp_call_entry_t* list;
+
+    while ((list = __atomic_exchange_n(&me->call_queue, NULL, __ATOMIC_ACQUIRE)) != NULL) {
+        /* push は LIFO なので反転して到着順に実行 */
+        smp_call_entry_t* fifo = NULL;
+        while (list) {
+            smp_call_entry_t* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+        while (fifo) {
+            smp_call_entry_t* next = fifo->next;
+            run_entry(fifo);
+            fifo = next;
+        }
+    }
+}
+
+/* 高速経路（caller-saved のみ退避）で直接呼ばれる */
+static void smp_ipi_call_handler(void)
+{
+    uint64_t t0 = rdtsc();
+    lapic_eoi();
+    smp_call_drain_local();
+    intr_stat_record(VEC_IPI_CALL, rdtsc() - t0);
+}
+DEFINE_FAST_ISR(smp_ipi_call_stub, smp_ipi_call_handler)
+
+void smp_init_cpu(void)
+{
+    if (!__atomic_exchange_n(&g_ipi_registered, 1, __ATOMIC_ACQ_REL)) {
+        intr_register_fast(VEC_IPI_CALL, smp_ipi_call_stub);
+    }
+    this_cpu()->call_queue = NULL;
+}
+
+/* ---- 送信側 ---- */
+
+/* push して、空だったなら 1 を返す（＝IPI が必要） */
+static int queue_push(percpu_t* c, smp_call_entry_t* e)
+{
+    smp_call_entry_t* head = __atomic_load_n(&c->call_queue, __ATOMIC_RELAXED);
+    do {
+        e->next = head;
+    } while (!__atomic_compare_exchange_n(&c->call_queue, &head, e, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return head == NULL;
+}
+
+int smp_call_function(cpumask_t mask, smp_call_fn_t fn, void* arg, int wait)
+{
+    if (!fn) return -1;
+
+    percpu_t* self   = this_cpu();
+    cpumask_t online = smp_online_mask();
+    cpumask_t others = online & ~CPUMASK_CPU(self->cpu_id);
+    int run_local    = (mask & CPUMASK_CPU(self->cpu_id)) != 0;
+    mask &= others;
+
+    smp_call_entry_t  stack_ents[MAX_CPUS];   /* wait 時のみ使う（完了まで呼び出し側が生きている） */
+    volatile uint32_t pending = 0;
+    cpumask_t need_ipi = 0;
+    int sent = 0;
+
+    for (cpumask_t m = mask; m; m &= m - 1) {
+        uint32_t id = (uint32_t)__builtin_ctzll(m);
+        percpu_t* c = percpu_get(id);
+
+        smp_call_entry_t* e;
+        if (wait) {
+            e = &stack_ents[id];
+        } else {
+            e = (smp_call_entry_t*)kmalloc(sizeof(*e), 0);
+            if (!e) break;
+        }
+        e->fn      = fn;
+        e->arg     = arg;
+        e->pending = wait ? &pending : NULL;
+        if (wait) __atomic_add_fetch(&pending, 1, __ATOMIC_RELAXED);
+
+        if (queue_push(c, e)) need_ipi |= CPUMASK_CPU(id);
+        ++sent;
+    }
+
+    /* 通知：全員に必要ならショートハンド 1 発、そうでなければ個別に */
+    if (need_ipi) {
+        if (need_ipi == others && others != 0 && (others & (others - 1))) {
+            lapic_send_ipi_allbut_self(VEC_IPI_CALL);
+        } else {
+            for (cpumask_t m = need_ipi; m; m &= m - 1) {
+                percpu_t* c = percpu_get((uint32_t)__builtin_ctzll(m));
+                lapic_send_ipi(c->apic_id, VEC_IPI_CALL);
+            }
+        }
+    }
+
+    if (run_local) {
+        uint64_t flags = irq_save();
+        fn(arg);
+        irq_restore(flags);
+    }
+
+    if (wait) {
+        /* 相手も割込み禁止でこちらを待っている場合に備え、自分宛ても捌きながら待つ */
+        while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE)) {
+            smp_call_drain_local();
+            cpu_relax();
+        }
+    }
+
+    return (sent == 0 && mask != 0) ? -1 : sent;
+}
+
+/* ---- TLB shootdown ---- */
+
+typedef struct shootdown_req {
+    const uint64_t* va;
+    size_t          nr;
+    int             full;
+} shootdown_req_t;
+
+static void shootdown_fn(void* arg)
+{
+    const shootdown_req_t* r = (const shootdown_req_t*)arg;
+    if (r->full) {
+        tlb_flush_all();
+        return;
+    }
+    for (size_t i = 0; i < r->nr; ++i) tlb_invlpg(r->va[i]);
+}
+
+static cpumask_t shootdown_targets(uint64_t cr3)
+{
+    cpumask_t m = 0;
+    uint32_t self = this_cpu_id();
+    uint32_t n = percpu_count();
+    for (uint32_t i = 0; i < n; ++i) {
+        if (i == self) continue;
+        percpu_t* c = percpu_get(i);
+        if (!c || !__atomic_load_n(&c->online, __ATOMIC_ACQUIRE)) continue;
+        if (cr3 != 0 && (__atomic_load_n(&c->active_cr3, __ATOMIC_RELAXED) & PTE_ADDR_MASK)
+                        != (cr3 & PTE_ADDR_MASK)) {
+            continue;
+        }
+        m |= CPUMASK_CPU(i);
+    }
+    return m;
+}
+
+void smp_tlb_shootdown(uint64_t cr3, const uint64_t* va, size_t nr, int full)
+{
+    if (!full && nr == 0) return;
+    cpumask_t targets = shootdown_targets(cr3);
+    if (!targets) return;
+
+    shootdown_req_t req = { .va = va, .nr = nr, .full = full };
+    smp_call_function(targets, shootdown_fn, &req, 1);
+}
+
+/* ---- ベンチマーク ---- */
+
+#define SHOOTDOWN_BENCH_ITERS 1000
+
+void smp_tlb_shootdown_bench(void)
+{
+    cpumask_t others = smp_online_mask() & ~CPUMASK_CPU(this_cpu_id());
+    if (!others) {
+        KLOG_INFO("smp", "shootdown bench: no other CPU online");
+        return;
+    }
+
+    /* 自分のスタック上のアドレスを 1 ページ分だけ無効化させる（害は無い） */
+    uint64_t va = (uint64_t)(uintptr_t)&others & ~0xFFFULL;
+    shootdown_req_t req = { .va = &va, .nr = 1, .full = 0 };
+
+    cpumask_t targets = 0;
+    int ntargets = 0;
+    for (cpumask_t m = others; m; m &= m - 1) {
+        targets |= (m & -m);
+        ++ntargets;
+
+        uint64_t min = ~0ULL, max = 0, sum = 0;
+        for (int i = 0; i < SHOOTDOWN_BENCH_ITERS; ++i) {
+            uint64_t t0 = rdtsc();
+            smp_call_function(targets, shootdown_fn, &req, 1);
+            uint64_t dt = rdtsc() - t0;
+            sum += dt;
+            if (dt < min) min = dt;
+            if (dt > max) max = dt;
+        }
+        KLOG_INFO("smp", "shootdown targets=%d: avg=%llu min=%llu max=%llu cycles",
+                  ntargets, (unsigned long long)(sum / SHOOTDOWN_BENCH_ITERS),
+                  (unsigned long long)min, (unsigned long long)max);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "arch/x86/percpu.h"
+
+/* =========================== 概要 ===========================
+ * CPU 間の関数呼び出し（IPI）と TLB shootdown
+ *  - 各 CPU は lock-free の MPSC キュー（percpu_t.call_queue）を持つ
+ *    送信側は CAS で push、受信側は xchg で丸ごと取り出して FIFO 順に実行
+ *  - IPI はキューが「空 → 非空」になったときだけ送る（後続は同じ IPI で処理される）
+ *  - 全 AP 宛てで全員に IPI が要るときは宛先ショートハンド 1 回で済ませる
+ * =========================================================== */
+
+/* 論理 CPU 番号のビットマスク（MAX_CPUS <= 64） */
+typedef uint64_t cpumask_t;
+#define CPUMASK_CPU(id)   (1ULL << (id))
+
+typedef void (*smp_call_fn_t)(void* arg);
+
+typedef struct smp_call_entry {
+    struct smp_call_entry* next;
+    smp_call_fn_t          fn;
+    void*                  arg;
+    volatile uint32_t*     pending;   /* wait 時の完了カウンタ。NULL = 非同期（受信側で kfree） */
+} smp_call_entry_t;
+
+/* 自 CPU の IPI 受信を有効化（BSP/AP の初期化で 1 回ずつ） */
+void smp_init_cpu(void);
+
+/* online な CPU のマスク */
+cpumask_t smp_online_mask(void);
+
+/* mask の各 CPU で fn(arg) を実行する。自 CPU が含まれれば割込み禁止でその場で実行。
+ * wait=1 なら全員の完了まで待つ（待ちの間も自分宛てのキューは処理する）。
+ * 戻り値：依頼した（自分以外の）CPU 数。確保失敗時 -1 */
+int smp_call_function(cpumask_t mask, smp_call_fn_t fn, void* arg, int wait);
+
+/* 自分宛てのキューを処理する（IPI ハンドラ・待ちループから呼ばれる） */
+void smp_call_drain_local(void);
+
+/* cr3 を使っている他 CPU の TLB から va[0..nr) を消す（full=1 なら全体）。
+ * cr3 == 0 はカーネル（Global）マッピング扱いで online な全 CPU が対象。
+ * PCID 無しなので、今 cr3 を使っていない CPU は次の CR3 ロードで消える → 送らない */
+void smp_tlb_shootdown(uint64_t cr3, const uint64_t* va, size_t nr, int full);
+
+/* shootdown 遅延を宛先 CPU 数ごとに測って KLOG に出す（KERNEL_BENCH 用） */
+void smp_tlb_shootdown_bench(void);
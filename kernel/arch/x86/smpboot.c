@@ -0,0 +1,182 @@
+#include "arch/x86/smpboot.h"
+#include "arch/x86/ap_trampoline.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/smp.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/gdt.h"
+#include "arch/x86/idt.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+#include "page_alloc.h"
+#include "memmap.h"
+#include "common.h"
+#include "acpi.h"
+#include "workqueue.h"
+#include "timer.h"
+#include "log.h"
+
+/* 待ち時間（Intel SDM の推奨値） */
+#define INIT_DELAY_US        10000u
+#define SIPI_DELAY_US        200u
+#define AP_ONLINE_TIMEOUT_US 100000u
+#define AP_ONLINE_POLL_US    100u
+
+/* CR4 のうち、ロングモード前に立ててはいけない／AP 側で後から決めるビット */
+#define CR4_VMXE   (1ULL << 13)
+#define CR4_PCIDE  (1ULL << 17)
+#define CR4_CET    (1ULL << 23)
+
+static uint64_t g_tramp_phys = 0;       /* 1MiB 未満 */
+static uint64_t g_kernel_cr3 = 0;       /* AP が上位ハーフに入ったら切り替える先 */
+static uint32_t g_cpus_online = 1;
+
+void smp_reserve_trampoline(void)
+{
+    /* まだ Direct Map 前（va == pa）なので物理アドレスだけ覚えておく */
+    void* p = page_alloc_pages_below(1, PAGE_SIZE_4K, 0x100000ULL);
+    if (!p) {
+        KLOG_WARN("smp", "no page below 1MiB for AP trampoline");
+        return;
+    }
+    g_tramp_phys = virt2phys((uint64_t)(uintptr_t)p);
+}
+
+uint32_t smp_cpus_online(void)
+{
+    return __atomic_load_n(&g_cpus_online, __ATOMIC_ACQUIRE);
+}
+
+/* AP の C 入口（一時 CR3・トランポリンの GDT のまま来る） */
+static void ap_entry(percpu_t* cpu)
+{
+    write_cr3(g_kernel_cr3);
+    cpu->active_cr3 = g_kernel_cr3;
+
+    gdt_init_cpu(cpu->gdt);
+    percpu_install(cpu);
+    idt_load();
+    lapic_init();
+    smp_init_cpu();
+    workqueue_init_cpu();
+    if (timer_init_cpu() != 0) {
+        KLOG_WARN("smp", "cpu%u: LAPIC timer unavailable", cpu->cpu_id);
+    }
+
+    KLOG_INFO("smp", "cpu%u (apic %u) online, stack [0x%llx, 0x%llx)",
+              cpu->cpu_id, cpu->apic_id,
+              (unsigned long long)cpu->stack_bottom, (unsigned long long)cpu->stack_top);
+
+    __atomic_add_fetch(&g_cpus_online, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&cpu->online, 1, __ATOMIC_RELEASE);
+
+    cpu_idle_loop();
+}
+
+/* 一時 Lv4: [0] = 恒等 1GiB、上位ハーフはカーネルの Lv4 をそのまま共有 */
+typedef uint64_t pt_t[PT_ENTRIES];
+static pt_t* g_tmp_lv4 = NULL;
+static pt_t* g_tmp_lv3 = NULL;
+
+static int build_tmp_page_table(void)
+{
+    if (!g_tmp_lv4) {
+        g_tmp_lv4 = (pt_t*)page_alloc_pages_below(1, PAGE_SIZE_4K, 1ULL << 32);
+        g_tmp_lv3 = (pt_t*)page_alloc_pages_below(1, PAGE_SIZE_4K, 1ULL << 32);
+        if (!g_tmp_lv4 || !g_tmp_lv3) return -1;
+        memset(g_tmp_lv4, 0, sizeof(pt_t));
+        memset(g_tmp_lv3, 0, sizeof(pt_t));
+        (*g_tmp_lv3)[0] = 0 | PTE_P | PTE_W | PTE_PS;
+        (*g_tmp_lv4)[0] = pte_from_pa(virt2phys((uint64_t)(uintptr_t)g_tmp_lv3)) | PTE_P | PTE_W;
+    }
+
+    /* AP スタック用の Lv4 エントリが後から増えるので毎回コピーし直す */
+    const pt_t* klv4 = (const pt_t*)(uintptr_t)phys2virt(g_kernel_cr3 & PTE_ADDR_MASK);
+    for (uint32_t i = PT_ENTRIES / 2; i < PT_ENTRIES; ++i) (*g_tmp_lv4)[i] = (*klv4)[i];
+    return 0;
+}
+
+static int wait_online(percpu_t* cpu, uint32_t timeout_us)
+{
+    for (uint32_t t = 0; t < timeout_us; t += AP_ONLINE_POLL_US) {
+        if (__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE)) return 0;
+        pit_delay_us(AP_ONLINE_POLL_US);
+    }
+    return __atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE) ? 0 : -1;
+}
+
+static int boot_one_ap(uint32_t apic_id)
+{
+    percpu_t* cpu = percpu_alloc_ap(apic_id);
+    if (!cpu) return -1;
+
+    if (build_tmp_page_table() != 0) {
+        percpu_release_ap(cpu);
+        return -1;
+    }
+
+    ap_tramp_params_t* p =
+        (ap_tramp_params_t*)(uintptr_t)phys2virt(g_tramp_phys + AP_TRAMP_PARAMS_OFF);
+    p->cr3   = (uint32_t)virt2phys((uint64_t)(uintptr_t)g_tmp_lv4);
+    p->cr4   = (uint32_t)(read_cr4() & ~(CR4_VMXE | CR4_PCIDE | CR4_CET));
+    p->cr0   = (uint32_t)read_cr0();
+    p->entry = (uint64_t)(uintptr_t)ap_entry;
+    p->stack = cpu->stack_top;
+    p->arg   = (uint64_t)(uintptr_t)cpu;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint8_t vector = (uint8_t)(g_tramp_phys >> 12);
+
+    lapic_send_init(apic_id);
+    pit_delay_us(INIT_DELAY_US);
+
+    lapic_send_sipi(apic_id, vector);
+    pit_delay_us(SIPI_DELAY_US);
+    if (!__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE)) {
+        lapic_send_sipi(apic_id, vector);   /* 1 回目を取りこぼす CPU 向けの再送 */
+    }
+
+    if (wait_online(cpu, AP_ONLINE_TIMEOUT_US) != 0) {
+        KLOG_ERROR("smp", "cpu%u (apic %u) did not come online", cpu->cpu_id, apic_id);
+        /* 遅れて走り出さないよう INIT で止めてから、番号を次の AP に回す */
+        lapic_send_init(apic_id);
+        pit_delay_us(INIT_DELAY_US);
+        percpu_release_ap(cpu);
+        return -1;
+    }
+    return 0;
+}
+
+int smp_boot_aps(void)
+{
+    uint32_t bsp_apic = this_cpu()->apic_id;   /* lapic_init / percpu_finish_bsp 済み */
+    smp_init_cpu();
+    workqueue_init_cpu();
+
+    const acpi_madt_info_t* madt = acpi_madt();
+    if (!madt) return -1;
+
+    if (g_tramp_phys == 0) {
+        KLOG_ERROR("smp", "AP trampoline page not reserved");
+        return -1;
+    }
+
+    size_t len = (size_t)(ap_trampoline_end - ap_trampoline_start);
+    memcpy((void*)(uintptr_t)phys2virt(g_tramp_phys), ap_trampoline_start, len);
+    g_kernel_cr3 = read_cr3();
+
+    int booted = 0;
+    for (int i = 0; i < madt->cpu_count; ++i) {
+        uint32_t apic = madt->apic_ids[i];
+        if (apic == bsp_apic) continue;
+        if (percpu_count() >= MAX_CPUS) {
+            KLOG_WARN("smp", "MAX_CPUS (%d) reached, ignoring the rest", MAX_CPUS);
+            break;
+        }
+        if (boot_one_ap(apic) == 0) ++booted;
+    }
+
+    KLOG_INFO("smp", "%d AP(s) online, %u CPU(s) total", booted, smp_cpus_online());
+    return booted;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * AP（Application Processor）の起動
+ *  - MADT で CPU を列挙し、INIT-SIPI-SIPI で 1 台ずつ起こす
+ *  - AP は ap_trampoline.S → ap_entry() で GDT/TSS/IDT/LAPIC/GS を整えて待機
+ * =========================================================== */
+
+/* 1MiB 未満のトランポリン用ページを確保しておく（page_allocator_init 直後に呼ぶ） */
+void smp_reserve_trampoline(void);
+
+/* 全 AP を起動する。戻り値は online になった AP の数（失敗時 -1） */
+int smp_boot_aps(void);
+
+/* online な CPU 数（BSP 含む） */
+uint32_t smp_cpus_online(void);
@@ -0,0 +1,127 @@
+#include "arch/x86/tlb.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/smp.h"
+
+#define CR4_PGE (1ULL << 7)
+
+static size_t      g_flush_threshold = TLB_DEFAULT_FLUSH_THRESHOLD;
+static tlb_stats_t g_stats;
+
+void tlb_flush_all(void)
+{
+    uint64_t cr4 = read_cr4();
+    if (cr4 & CR4_PGE) {
+        /* PGE を落として戻すと Global エントリも含めて全消去される */
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+    } else {
+        /* Global 無しなら CR3 の再ロードで十分 */
+        write_cr3(read_cr3());
+    }
+}
+
+/* 溜めた分だけ空にする（対象アドレス空間は保持） */
+static void tlb_gather_reset(tlb_gather_t* g)
+{
+    g->nr_va     = 0;
+    g->nr_pages  = 0;
+    g->nr_tables = 0;
+    g->need_full = 0;
+}
+
+void tlb_gather_init_as(tlb_gather_t* g, uint64_t cr3)
+{
+    if (!g) return;
+    tlb_gather_reset(g);
+    g->cr3 = cr3;
+}
+
+void tlb_gather_init(tlb_gather_t* g)
+{
+    tlb_gather_init_as(g, 0);
+}
+
+void tlb_gather_add_page(tlb_gather_t* g, uint64_t va)
+{
+    if (!g) return;
+    g->nr_pages++;
+    if (g->need_full) return;
+
+    if (g->nr_va >= TLB_GATHER_MAX_PAGES || g->nr_pages > g_flush_threshold) {
+        /* 個別に覚えきれない or 閾値超え → 全体フラッシュに切替 */
+        g->need_full = 1;
+        return;
+    }
+    g->va[g->nr_va++] = va & ~0xFFFULL;
+}
+
+void tlb_gather_add_range(tlb_gather_t* g, uint64_t va, uint64_t size)
+{
+    if (!g || size == 0) return;
+    uint64_t start = va & ~0xFFFULL;
+    uint64_t end   = (va + size + 0xFFFULL) & ~0xFFFULL;
+
+    /* 範囲が閾値を超えるのが明らかなら 1 ページずつ積まない */
+    if ((end - start) / 0x1000ULL > g_flush_threshold) {
+        g->nr_pages += (size_t)((end - start) / 0x1000ULL);
+        g->need_full = 1;
+        return;
+    }
+    for (uint64_t p = start; p < end; p += 0x1000ULL) tlb_gather_add_page(g, p);
+}
+
+/* 溜めた VA をフラッシュし、待たせていたテーブルを解放する */
+static void tlb_gather_flush(tlb_gather_t* g)
+{
+    if (g->need_full) {
+        tlb_flush_all();
+        __atomic_add_fetch(&g_stats.full_flushes, 1, __ATOMIC_RELAXED);
+    } else {
+        for (size_t i = 0; i < g->nr_va; ++i) tlb_invlpg(g->va[i]);
+        __atomic_add_fetch(&g_stats.invlpg_pages, g->nr_va, __ATOMIC_RELAXED);
+    }
+
+    /* 他 CPU も同じ無効化を終えるまで待つ（テーブル解放はその後） */
+    if (smp_online_mask() & ~CPUMASK_CPU(this_cpu_id())) {
+        smp_tlb_shootdown(g->cr3, g->va, g->nr_va, g->need_full);
+        __atomic_add_fetch(&g_stats.remote_batches, 1, __ATOMIC_RELAXED);
+    }
+
+    /* ここまで来れば古い変換はどこにも残っていない */
+    for (size_t i = 0; i < g->nr_tables; ++i) page_free_4k(g->tables[i]);
+    __atomic_add_fetch(&g_stats.tables_freed, g->nr_tables, __ATOMIC_RELAXED);
+
+    tlb_gather_reset(g);
+}
+
+void tlb_gather_free_table(tlb_gather_t* g, void* table)
+{
+    if (!g || !table) return;
+    if (g->nr_tables >= TLB_GATHER_MAX_TABLES) {
+        /* 保持枠が満杯：一旦フラッシュして吐き出す */
+        tlb_gather_flush(g);
+    }
+    g->tables[g->nr_tables++] = table;
+}
+
+void tlb_gather_finish(tlb_gather_t* g)
+{
+    if (!g) return;
+    if (g->nr_va == 0 && !g->need_full && g->nr_tables == 0) return;
+    __atomic_add_fetch(&g_stats.batches, 1, __ATOMIC_RELAXED);
+    tlb_gather_flush(g);
+}
+
+void tlb_set_flush_threshold(size_t pages)
+{
+    if (pages > TLB_GATHER_MAX_PAGES) pages = TLB_GATHER_MAX_PAGES;
+    g_flush_threshold = pages;
+}
+
+size_t tlb_get_flush_threshold(void) { return g_flush_threshold; }
+
+void tlb_get_stats(tlb_stats_t* out)
+{
+    if (out) *out = g_stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* =========================== 概要 ===========================
+ * TLB 無効化のバッチ API（Linux の mmu_gather 相当）
+ *  - ページテーブル更新の間に無効化対象の VA を溜め、最後に 1 回だけ
+ *    INVLPG 群 or 全体フラッシュを実行する
+ *  - 外したページテーブルページはフラッシュ完了まで解放しない
+ *    （他の TLB/PSC エントリが参照している可能性があるため）
+ *  - INVLPG と全体フラッシュの切り替えはページ数の閾値で決める
+ *  - 自 CPU の後、同じアドレス空間を使う他 CPU へ IPI で同じ無効化を依頼する
+ * =========================================================== */
+
+/* 1 バッチで個別に覚えておける VA 数（超えたら全体フラッシュに切替） */
+enum { TLB_GATHER_MAX_PAGES  = 64 };
+/* フラッシュ待ちで保持できるページテーブル数（溢れたら途中フラッシュ） */
+enum { TLB_GATHER_MAX_TABLES = 32 };
+
+/* 既定の閾値：これを超えるページ数なら全体フラッシュ（Linux の 33 に倣う） */
+#define TLB_DEFAULT_FLUSH_THRESHOLD 33u
+
+typedef struct tlb_gather {
+    uint64_t va[TLB_GATHER_MAX_PAGES];     /* 無効化対象（4KiB 境界） */
+    size_t   nr_va;
+    size_t   nr_pages;                     /* 溢れた分も含む総ページ数 */
+    void*    tables[TLB_GATHER_MAX_TABLES];/* フラッシュ後に解放するテーブル */
+    size_t   nr_tables;
+    int      need_full;                    /* 1: 全体フラッシュ確定 */
+    uint64_t cr3;                          /* 対象アドレス空間（0 = カーネル/Global → 全 CPU） */
+} tlb_gather_t;
+
+/* 統計（チューニング用） */
+typedef struct tlb_stats {
+    uint64_t batches;         /* finish された回数 */
+    uint64_t invlpg_pages;    /* INVLPG で無効化したページ数 */
+    uint64_t full_flushes;    /* 全体フラッシュ回数 */
+    uint64_t tables_freed;    /* フラッシュ後に解放したテーブル数 */
+    uint64_t remote_batches;  /* 他 CPU へ shootdown を依頼した回数 */
+} tlb_stats_t;
+
+/* ---- 単発の無効化 ---- */
+static inline void tlb_invlpg(uint64_t va)
+{
+    __asm__ __volatile__("invlpg (%0)" :: "r"(va) : "memory");
+}
+
+/* Global ページも含めて全 TLB をフラッシュ（CR4.PGE トグル） */
+void tlb_flush_all(void);
+
+/* ---- バッチ API ---- */
+void tlb_gather_init(tlb_gather_t* g);                      /* カーネル空間（cr3 = 0） */
+void tlb_gather_init_as(tlb_gather_t* g, uint64_t cr3);     /* 特定のアドレス空間 */
+void tlb_gather_add_page(tlb_gather_t* g, uint64_t va);
+void tlb_gather_add_range(tlb_gather_t* g, uint64_t va, uint64_t size);
+/* table はフラッシュ完了後に page_free_4k() される */
+void tlb_gather_free_table(tlb_gather_t* g, void* table);
+/* 溜めた分をフラッシュ → テーブル解放。g は再利用可能な状態に戻る */
+void tlb_gather_finish(tlb_gather_t* g);
+
+/* ---- チューニング ---- */
+void   tlb_set_flush_threshold(size_t pages);
+size_t tlb_get_flush_threshold(void);
+void   tlb_get_stats(tlb_stats_t* out);
@@ -0,0 +1,105 @@
+#include "arch/x86/tsc.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/cpuid.h"
+#include "arch/x86/arch_x86_low.h"
+#include "ktime.h"
+#include "log.h"
+
+ktime_conv_t g_ktime = { 0, 0, 0, 0 };
+
+static int g_invariant = 0;
+
+#define PIT_CAL_US     20000u    /* 1 回 20ms */
+#define PIT_CAL_TRIES  3
+
+/* PIT の待ちの前後で TSC を読む。準備の I/O は余分に数えるだけなので最小値を採る */
+static uint64_t tsc_hz_from_pit(void)
+{
+    uint64_t best = ~0ULL;
+    for (int i = 0; i < PIT_CAL_TRIES; ++i) {
+        uint64_t flags = irq_save();
+        uint64_t t0 = rdtsc();
+        pit_delay_us(PIT_CAL_US);
+        uint64_t dt = rdtsc() - t0;
+        irq_restore(flags);
+        if (dt < best) best = dt;
+    }
+    return best * (1000000u / PIT_CAL_US);
+}
+
+static uint64_t tsc_hz_from_cpuid(void)
+{
+    uint32_t max = cpuid_leaf(0).eax;
+    if (max < 0x15) return 0;
+
+    cpuid_regs_t r = cpuid_leaf(0x15);
+    if (r.eax == 0 || r.ebx == 0) return 0;       /* 比が列挙されていない */
+
+    uint64_t crystal = r.ecx;
+    if (crystal == 0 && max >= 0x16) {
+        /* クリスタル周波数が無い世代：ベース周波数（MHz）× 比の逆でクリスタルを逆算 */
+        uint32_t base_mhz = cpuid_leaf(0x16).eax & 0xFFFF;
+        if (base_mhz) crystal = (uint64_t)base_mhz * 1000000ULL * r.eax / r.ebx;
+    }
+    if (crystal == 0) return 0;
+    return crystal * r.ebx / r.eax;
+}
+
+int tsc_init(void)
+{
+    if (!(cpuid_leaf(1).edx & (1u << 4))) {
+        KLOG_ERROR("tsc", "no TSC");
+        return -1;
+    }
+
+    if (cpuid_leaf(0x80000000).eax >= 0x80000007) {
+        g_invariant = (cpuid_leaf(0x80000007).edx & (1u << 8)) != 0;
+    }
+    if (!g_invariant) {
+        KLOG_WARN("tsc", "TSC is not invariant; rate may change with P/C-states");
+    }
+
+    uint64_t hz_pit   = tsc_hz_from_pit();
+    uint64_t hz_cpuid = tsc_hz_from_cpuid();
+    uint64_t hz       = hz_pit;
+    const char* src   = "PIT";
+
+    if (hz_cpuid) {
+        uint64_t diff = hz_cpuid > hz_pit ? hz_cpuid - hz_pit : hz_pit - hz_cpuid;
+        if (diff * 100 > hz_pit) {
+            KLOG_WARN("tsc", "CPUID says %llu Hz but PIT measures %llu Hz; using PIT",
+                      (unsigned long long)hz_cpuid, (unsigned long long)hz_pit);
+        } else {
+            hz  = hz_cpuid;
+            src = "CPUID";
+        }
+    }
+    if (hz == 0) {
+        KLOG_ERROR("tsc", "calibration failed");
+        return -1;
+    }
+
+    g_ktime.mult     = (NSEC_PER_SEC << KTIME_SHIFT) / hz;
+    g_ktime.inv_mult = (hz << KTIME_INV_SHIFT) / NSEC_PER_SEC;
+    g_ktime.base_cycles = rdtsc();
+    __atomic_store_n(&g_ktime.hz, hz, __ATOMIC_RELEASE);
+
+    KLOG_INFO("tsc", "TSC %llu.%03llu MHz (%s)%s", (unsigned long long)(hz / 1000000),
+              (unsigned long long)(hz / 1000 % 1000), src, g_invariant ? ", invariant" : "");
+    return 0;
+}
+
+uint64_t tsc_hz(void)
+{
+    return g_ktime.hz;
+}
+
+int tsc_is_invariant(void)
+{
+    return g_invariant;
+}
+
+int tsc_has_deadline_timer(void)
+{
+    return (cpuid_leaf(1).ecx & (1u << 24)) != 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * TSC の周波数較正
+ *  1) CPUID.15H（TSC/クリスタル比 × クリスタル周波数）
+ *  2) 1) でクリスタル周波数が 0 なら CPUID.16H のベース周波数で補う
+ *  3) どちらも無ければ PIT ch2 で実測（複数回の最小値）
+ * CPUID で得られた場合も PIT と突き合わせ、1% 以上ずれたら警告して実測値を使う。
+ * Invariant TSC（CPUID.80000007H:EDX[8]）が無いと C/P ステートで速度が変わるので警告。
+ * 結果は ktime（kernel/ktime.h）の換算係数として公開する。
+ * =========================================================== */
+
+/* 較正して ktime を有効化する。TSC が無ければ -1 */
+int tsc_init(void);
+
+uint64_t tsc_hz(void);
+int      tsc_is_invariant(void);
+int      tsc_has_deadline_timer(void);   /* CPUID.1:ECX[24] */
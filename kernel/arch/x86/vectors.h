@@ -0,0 +1,19 @@
+#pragma once
+
+/* =========================== 概要 ===========================
+ * 割込みベクタの割り当て（一覧をここに集約）
+ *  0x00-0x1F : CPU 例外
+ *  0x20-0x2F : 8259 PIC（再マップ先。全マスク）
+ *  0x30-0xDF : デバイス割込み（IOAPIC / MSI / MSI-X。intr_alloc_vector で動的に配る）
+ *  0xE0-0xEF : LAPIC 内部ソース（タイマ）・ベンチ用
+ *  0xF0-     : IPI / LAPIC 内部ソース（優先度クラスを高くしておく）
+ * =========================================================== */
+
+#define VEC_DEVICE_FIRST      0x30
+#define VEC_DEVICE_LAST       0xDF
+
+#define VEC_BENCH             0xE0   /* intr_bench の自己 IPI */
+#define VEC_TIMER             0xEC   /* LAPIC ワンショットタイマ（timer wheel） */
+#define VEC_IPI_CALL          0xF0   /* smp_call_function のキュー処理 */
+#define VEC_IPI_WAKE          0xF1   /* idle 中の CPU を起こすだけ（queue_work_on） */
+#define VEC_SPURIOUS          0xFF   /* LAPIC spurious（EOI 不要） */
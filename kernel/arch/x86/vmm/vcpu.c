@@ -12,6 +12,15 @@
 #include "arch/x86/vmm/vcpu.h"
 #include "arch/x86/msr.h"
 #include "arch/x86/gdt.h"
+#include "arch/x86/prof.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/vectors.h"
+#include "softirq.h"
+#include "workqueue.h"
+#include "trace.h"
+#include "metrics.h"
+#include "boottime.h"
 
 #define AR_TYPE(x)   ((uint32_t)((x) & 0xF))    /* bits 0-3 */
 #define AR_S_CODEDATA (1u<<4)                   /* S=1 */
@@ -101,9 +110,14 @@ static inline uint64_t pick_ctrl_msr(uint32_t msr_true, uint32_t msr_legacy)
  *==========================================================*/
 static int setup_exec_controls(void)
 {
-    /* --- Pin-based ---（今回はデフォルト＝0から Allowed を適用） */
+    /* --- Pin-based ---
+     *  NMI exiting     : ゲスト中の PMU NMI をホストで受ける
+     *  External-int.   : ホストのタイマ/IPI をゲストの IDT に流さない */
     uint32_t pin = 0;
     {
+        const uint32_t PIN_CTL_EXT_INT_EXITING = (1u << 0);
+        const uint32_t PIN_CTL_NMI_EXITING     = (1u << 3);
+        pin |= PIN_CTL_EXT_INT_EXITING | PIN_CTL_NMI_EXITING;
         uint64_t m = pick_ctrl_msr(IA32_VMX_TRUE_PINBASED_CTLS, IA32_VMX_PINBASED_CTLS);
         pin = adjust_ctrl_u32(pin, m);
         if (vmcs_vmwrite(VMCS_PIN_BASED_CTLS, pin) != 0) return -1;
@@ -296,6 +310,10 @@ int vcpu_build_vmcs_and_launch(void)
     if (setup_host_state() != 0)            { KLOG_ERROR("vcpu","host state"); return -1; }
     if (setup_guest_state() != 0)           { KLOG_ERROR("vcpu","guest state"); return -1; }
     if (setup_entry_exit_controls() != 0)   { KLOG_ERROR("vcpu","entry/exit"); return -1; }
+    boottime_stamp("vmcs_build");
+
+    /* 起動はここまで（成功すると戻って来ないので、表は VMLAUNCH の前に出す） */
+    boottime_report();
 
     /* いよいよ VMLAUNCH */
     uint64_t rflags = 0;
@@ -364,26 +382,140 @@ static inline ExitInfo exitinfo_load(void) {
  * VMEXIT → C 側ディスパッチ
  *  - 今は HLT だけ RIP を進めて続行
  * ========================================================= */
+TRACE_EVENT_DEFINE(vmexit, "reason=%llu inst_len=%llu");
+
+/* Exit 理由ごとの統計（vCPU の CPU だけが書く。読み手は目安として読む） */
+#define VMEXIT_REASON_MAX  72
+
+typedef struct vmexit_stat {
+    uint64_t count;
+    uint64_t cycles;       /* vmexit_dispatch 内の処理時間 */
+    uint64_t max_cycles;
+} vmexit_stat_t;
+
+static vmexit_stat_t g_exit_stat[VMEXIT_REASON_MAX];
+METRIC_HISTOGRAM_DEFINE(vmexit_cycles, "vmexit.cycles");
+METRIC_GAUGE_DEFINE(vcpu_paused, "vcpu.paused");
+
+static void vmexit_account(uint32_t basic, uint64_t t0) {
+    if (basic >= VMEXIT_REASON_MAX) basic = VMEXIT_REASON_MAX - 1;
+    uint64_t dt = rdtsc() - t0;
+    vmexit_stat_t* st = &g_exit_stat[basic];
+    st->count++;
+    st->cycles += dt;
+    if (dt > st->max_cycles) st->max_cycles = dt;
+    METRIC_OBSERVE(vmexit_cycles, dt);
+}
+
 void vmexit_dispatch(Vcpu* vcpu) {
     (void)vcpu;
+    uint64_t t0 = rdtsc();
     ExitInfo ei = exitinfo_load();
 
     /* 下位 16bit が基本理由 */
     uint32_t basic = (ei.reason & 0xFFFFu);
+    TRACE2(vmexit, basic, ei.inst_len);
     switch (basic) {
+    case 0: /* Exception or NMI */
+    {
+        uint64_t info = 0;
+        vmcs_vmread(VMCS_EXIT_INTERRUPT_INFO, &info);
+        /* valid(31) かつ type(10:8) = 2（NMI） */
+        if ((info & (1u << 31)) && ((info >> 8) & 7) == 2) {
+            prof_guest_nmi();
+            break;
+        }
+        KLOG_ERROR("vmexit", "Unhandled exception exit: info=0x%x", (unsigned)info);
+        for(;;) __asm__ __volatile__("hlt");
+    }
+    case 1: /* External interrupt */
+        /* ack-on-exit は使っていないので LAPIC に保留されたまま。
+         * ホストは VM-exit 直後 IF=0 なので、ここで 1 命令分だけ開けて受ける */
+        __asm__ __volatile__("sti; nop; cli" ::: "memory");
+        break;
     case 12: /* HLT */
     {
         uint64_t rip=0;
         vmcs_vmread(VMCS_GUEST_RIP, &rip);
         rip += ei.inst_len;
         vmcs_vmwrite(VMCS_GUEST_RIP, rip);
-        KLOG_DEBUG("vmexit", "HLT -> step RIP (+%u)", ei.inst_len);
+        KLOG_DEBUG_DEFER_RATELIMITED("vmexit", "HLT -> step RIP (+%u)", ei.inst_len);
         break;
     }
     default:
         KLOG_ERROR("vmexit", "Unhandled VMEXIT: reason=0x%x", basic);
         for(;;) __asm__ __volatile__("hlt");
     }
+    vmexit_account(basic, t0);
+}
+
+void vcpu_dump_exit_stats(void) {
+    uint64_t total = 0;
+    for (uint32_t r = 0; r < VMEXIT_REASON_MAX; ++r) {
+        const vmexit_stat_t* st = &g_exit_stat[r];
+        if (!st->count) continue;
+        total += st->count;
+        KLOG_INFO("vmexit", "reason %2u: count=%llu avg=%llu max=%llu cycles", r,
+                  (unsigned long long)st->count, (unsigned long long)(st->cycles / st->count),
+                  (unsigned long long)st->max_cycles);
+    }
+    KLOG_INFO("vmexit", "total exits=%llu", (unsigned long long)total);
+}
+
+/* =========================================================
+ * 一時停止（console から）
+ *  - g_pause_req を立てて vCPU の CPU に起床 IPI を送る。
+ *    external-interrupt exiting で VM-exit し、Exit 処理の後ろで止まる
+ *  - Exit 処理の後ろでは自 CPU 宛ての work も拾う（BSP だけの構成で
+ *    console の work が vCPU の CPU に積まれた時用。IF=0 の Exit 処理中には走らない）
+ * ========================================================= */
+static volatile uint32_t g_pause_req = 0;
+static volatile uint32_t g_paused    = 0;
+static volatile int32_t  g_vcpu_cpu  = -1;
+
+static void vcpu_kick(void) {
+    int32_t cpu = __atomic_load_n(&g_vcpu_cpu, __ATOMIC_ACQUIRE);
+    if (cpu < 0 || (uint32_t)cpu == this_cpu_id()) return;
+    percpu_t* c = percpu_get((uint32_t)cpu);
+    if (c) lapic_send_ipi(c->apic_id, VEC_IPI_WAKE);
+}
+
+void vcpu_set_paused(int on) {
+    __atomic_store_n(&g_pause_req, on ? 1u : 0u, __ATOMIC_RELEASE);
+    vcpu_kick();
+}
+
+int vcpu_is_paused(void) {
+    return (int)__atomic_load_n(&g_paused, __ATOMIC_ACQUIRE);
+}
+
+/* Exit 処理の後、次の VM-entry の前（IF=0 で入り IF=0 で戻る） */
+static void vcpu_exit_tail(void) {
+    percpu_t* c = this_cpu();
+    if (__atomic_load_n(&c->work_queue, __ATOMIC_ACQUIRE)) {
+        __asm__ __volatile__("sti" ::: "memory");
+        workqueue_drain_local();
+        __asm__ __volatile__("cli" ::: "memory");
+    }
+    if (__builtin_expect(!__atomic_load_n(&g_pause_req, __ATOMIC_ACQUIRE), 1)) return;
+
+    __atomic_store_n(&g_paused, 1, __ATOMIC_RELEASE);
+    METRIC_SET(vcpu_paused, 1);
+    KLOG_INFO("vcpu", "paused on cpu%u", c->cpu_id);
+    while (__atomic_load_n(&g_pause_req, __ATOMIC_ACQUIRE)) {
+        softirq_run_pending();
+        if (__atomic_load_n(&c->work_queue, __ATOMIC_ACQUIRE)) {
+            __asm__ __volatile__("sti" ::: "memory");
+            workqueue_drain_local();
+            __asm__ __volatile__("cli" ::: "memory");
+            continue;
+        }
+        /* cpu_idle_loop と同じく STI 直後の 1 命令で HLT に入る */
+        __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+    }
+    __atomic_store_n(&g_paused, 0, __ATOMIC_RELEASE);
+    METRIC_SET(vcpu_paused, 0);
+    KLOG_INFO("vcpu", "resumed");
 }
 
 /* =========================================================
@@ -392,11 +524,13 @@ void vmexit_dispatch(Vcpu* vcpu) {
  *   - 失敗（= VMX instruction error）ならエラーを表示して停止
  * ========================================================= */
 int vcpu_loop(Vcpu* vcpu) {
+    __atomic_store_n(&g_vcpu_cpu, (int32_t)this_cpu_id(), __ATOMIC_RELEASE);
     for (;;) {
         uint8_t ok = asm_vmentry(vcpu);
         if (ok == 0) {
             /* 成功: VMEXIT で戻ってきた → Exit を捌いて再度 Entry へ */
             vmexit_dispatch(vcpu);
+            vcpu_exit_tail();
             continue;
         }
 
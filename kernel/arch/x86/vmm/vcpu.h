@@ -26,5 +26,13 @@ void vmexit_dispatch(Vcpu* vcpu);
 /* VMX Root に入った後、VMCS を構築して VMLAUNCH する */
 int vcpu_build_vmcs_and_launch(void);
 
+/* Exit 理由ごとの回数と処理サイクルを KLOG に出す */
+void vcpu_dump_exit_stats(void);
+
+/* 一時停止 / 再開。停止要求は vCPU の CPU に起床 IPI を送って VM-exit させ、
+ * Exit 処理の後ろで再開要求まで HLT で待たせる（待つ間も work/softirq は回す） */
+void vcpu_set_paused(int on);
+int  vcpu_is_paused(void);              /* 実際に止まっていれば 1 */
+
 /* HLT ループするだけの最小ゲスト */
 void vcpu_guest_hlt_loop(void) __attribute__((noreturn));
@@ -1,5 +1,8 @@
 #include "bin_alloc.h"
 #include "page_alloc.h"
+#include "spinlock.h"
+#include "trace.h"
+#include "metrics.h"
 
 /* 4KiB ページ固定 */
 #ifndef PAGE_SIZE
@@ -15,8 +18,23 @@ typedef struct chunk_node {
     struct chunk_node* next;
 } chunk_node;
 
-/* 各 bin のフリーリスト先頭 */
+/* 各 bin のフリーリスト先頭（g_bin_lock で保護） */
 static chunk_node* g_free_heads[BIN_COUNT];
+static DEFINE_SPINLOCK(g_bin_lock);
+
+/* 統計（bin 分は g_bin_lock 下、大物は atomic） */
+typedef struct bin_stat {
+    uint64_t allocs, frees, pages, free_chunks;
+} bin_stat_t;
+static bin_stat_t g_bin_stat[BIN_COUNT];
+static uint64_t   g_large_allocs, g_large_frees;
+_Static_assert(BIN_COUNT <= BIN_ALLOC_MAX_BINS, "raise BIN_ALLOC_MAX_BINS");
+
+METRIC_COUNTER_DEFINE(kmalloc_bin,   "kmalloc.bin");
+METRIC_COUNTER_DEFINE(kmalloc_large, "kmalloc.large");
+METRIC_COUNTER_DEFINE(kfree_bin,     "kfree.bin");
+METRIC_COUNTER_DEFINE(kfree_large,   "kfree.large");
+METRIC_GAUGE_DEFINE(bin_pages,       "kmalloc.bin_pages");
 
 /* --- ユーティリティ --- */
 static inline size_t max_size(size_t a, size_t b) { return a > b ? a : b; }
@@ -58,6 +76,9 @@ static int refill_bin(int idx)
         chunk_node* n = (chunk_node*)(page + i * bsz);
         push_node(&g_free_heads[idx], n);
     }
+    g_bin_stat[idx].pages++;
+    METRIC_INC(bin_pages);
+    g_bin_stat[idx].free_chunks += cnt;
     return 1;
 }
 
@@ -73,6 +94,9 @@ void bin_alloc_init(void)
  * - size > 最大 bin → バックエンド（ページアロケータ）へ
  * - align > bin_size の場合は「need = max(size, align)」で bin を選ぶ
  */
+TRACE_EVENT_DEFINE(kmalloc, "size=%llu align=%llu bin=%lld ptr=0x%llx");
+TRACE_EVENT_DEFINE(kfree, "ptr=0x%llx size=%llu");
+
 void* kmalloc(size_t n, size_t align)
 {
     if (n == 0) return NULL;
@@ -82,10 +106,19 @@ void* kmalloc(size_t n, size_t align)
 
     int idx = bin_index_for(need);
     if (idx >= 0) {
+        uint64_t flags = spin_lock_irqsave(&g_bin_lock);
         /* 該当 bin が空なら 4KiB 追加割当 */
-        if (!g_free_heads[idx] && !refill_bin(idx)) return NULL;
+        if (!g_free_heads[idx] && !refill_bin(idx)) {
+            spin_unlock_irqrestore(&g_bin_lock, flags);
+            return NULL;
+        }
 
         chunk_node* n0 = pop_node(&g_free_heads[idx]);
+        g_bin_stat[idx].allocs++;
+        g_bin_stat[idx].free_chunks--;
+        spin_unlock_irqrestore(&g_bin_lock, flags);
+        METRIC_INC(kmalloc_bin);
+        TRACE4(kmalloc, n, align, idx, n0);
         return (void*)n0; /* メタ無しでそのままユーザに返す */
     }
 
@@ -93,18 +126,26 @@ void* kmalloc(size_t n, size_t align)
        - align がページサイズ以下 → バイト確保で OK（ページ境界保証が不要なら）
        - align がページサイズ超 → ページ API で align 指定
      */
+    void* p;
     if (align > PAGE_SIZE) {
         size_t pages = (n + PAGE_SIZE - 1) / PAGE_SIZE;
-        return page_alloc_pages(pages, align);
+        p = page_alloc_pages(pages, align);
     } else {
         /* ページ境界不要なら bytes API（内部はページ割当） */
-        return page_alloc_bytes(n);
+        p = page_alloc_bytes(n);
+    }
+    if (p) {
+        __atomic_add_fetch(&g_large_allocs, 1, __ATOMIC_RELAXED);
+        METRIC_INC(kmalloc_large);
     }
+    TRACE4(kmalloc, n, align, -1, p);
+    return p;
 }
 
 void kfree(void* p, size_t n)
 {
     if (!p || n == 0) return;
+    TRACE2(kfree, p, n);
 
     /* どの bin 相当か判定
        解放サイズが bin のちょうど値でなくても、「そのサイズが入る最小 bin」に戻すだけで OK */
@@ -112,10 +153,36 @@ void kfree(void* p, size_t n)
 
     if (idx >= 0) {
         chunk_node* node = (chunk_node*)p;
+        uint64_t flags = spin_lock_irqsave(&g_bin_lock);
         push_node(&g_free_heads[idx], node);
+        g_bin_stat[idx].frees++;
+        g_bin_stat[idx].free_chunks++;
+        spin_unlock_irqrestore(&g_bin_lock, flags);
+        METRIC_INC(kfree_bin);
         return;
     }
 
     /* 大物はそのまま bytes で返す（ページ境界に切り上げて確保している想定） */
+    __atomic_add_fetch(&g_large_frees, 1, __ATOMIC_RELAXED);
+    METRIC_INC(kfree_large);
     page_free_bytes(p, n);
 }
+
+void bin_alloc_get_stats(bin_alloc_stats_t* out)
+{
+    if (!out) return;
+    out->nbins = BIN_COUNT;
+
+    uint64_t flags = spin_lock_irqsave(&g_bin_lock);
+    for (int i = 0; i < BIN_COUNT; ++i) {
+        out->bin[i].size        = g_bin_sizes[i];
+        out->bin[i].allocs      = g_bin_stat[i].allocs;
+        out->bin[i].frees       = g_bin_stat[i].frees;
+        out->bin[i].pages       = g_bin_stat[i].pages;
+        out->bin[i].free_chunks = g_bin_stat[i].free_chunks;
+    }
+    spin_unlock_irqrestore(&g_bin_lock, flags);
+
+    out->large_allocs = __atomic_load_n(&g_large_allocs, __ATOMIC_RELAXED);
+    out->large_frees  = __atomic_load_n(&g_large_frees, __ATOMIC_RELAXED);
+}
@@ -9,3 +9,23 @@ void  bin_alloc_init(void);
 void* kmalloc(size_t n, size_t align);
 /* 確保時のサイズ n を渡して解放（Bin はサイズから判断できる） */
 void  kfree(void* p, size_t n);
+
+/* 統計（bin ごと。counts は g_bin_lock 下で更新） */
+#define BIN_ALLOC_MAX_BINS  8
+
+typedef struct bin_alloc_bin_stats {
+    uint64_t size;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t pages;        /* refill で割いたページ数 */
+    uint64_t free_chunks;  /* フリーリスト上の数 */
+} bin_alloc_bin_stats_t;
+
+typedef struct bin_alloc_stats {
+    uint32_t              nbins;
+    bin_alloc_bin_stats_t bin[BIN_ALLOC_MAX_BINS];
+    uint64_t              large_allocs;   /* ページアロケータへ回した分 */
+    uint64_t              large_frees;
+} bin_alloc_stats_t;
+
+void bin_alloc_get_stats(bin_alloc_stats_t* out);
@@ -50,9 +50,27 @@ enum {
 
 #define BOOTINFO_MAGIC 0xDEADBEEFCAFEBABEull
 
+/* 起動タイムライン（bootloader/bootinfo.h と同じレイアウト） */
+#define BOOT_STAMP_MAX       16
+#define BOOT_STAMP_NAME_MAX  16
+
+typedef struct {
+    uint64_t tsc;
+    char     name[BOOT_STAMP_NAME_MAX];
+} BOOT_STAMP;
+
+typedef struct {
+    uint32_t   count;
+    uint32_t   reserved;
+    uint64_t   tsc_hz;        /* ローダの較正値（0 なら未較正） */
+    BOOT_STAMP stamp[BOOT_STAMP_MAX];
+} BOOT_TIMELINE;
+
 typedef struct {
     uint64_t  magic;
     MEMORY_MAP memory_map;
+    uint64_t  acpi_rsdp;      /* RSDP の物理アドレス（見つからなければ 0） */
+    BOOT_TIMELINE timeline;   /* efi_main から ExitBootServices までの TSC */
 } BOOT_INFO;
 
 
@@ -0,0 +1,88 @@
+#include "boottime.h"
+#include "bootinfo.h"
+#include "log.h"
+#include "ktime.h"
+
+typedef struct boottime_stamp {
+    uint64_t    tsc;
+    const char* name;
+} boottime_stamp_t;
+
+static boottime_stamp_t g_stamps[BOOTTIME_MAX_STAMPS];
+static uint32_t         g_nstamps;
+
+void boottime_stamp(const char* name)
+{
+    if (g_nstamps >= BOOTTIME_MAX_STAMPS) return;
+    g_stamps[g_nstamps].tsc  = rdtsc();
+    g_stamps[g_nstamps].name = name;
+    ++g_nstamps;
+}
+
+/* カーネルの較正値を優先（乗算だけ）。較正前ならローダの MHz で割る */
+static uint64_t cyc_to_us(uint64_t cycles, uint64_t loader_mhz)
+{
+    if (g_ktime.hz) return ktime_cyc2ns(cycles) / NSEC_PER_USEC;
+    return loader_mhz ? cycles / loader_mhz : 0;
+}
+
+typedef struct report {
+    uint64_t    prev;
+    uint64_t    t0;
+    uint64_t    mhz;
+    uint64_t    longest_us;
+    const char* longest;
+} report_t;
+
+static void report_row(report_t* r, const char* side, const char* name, uint64_t tsc)
+{
+    uint64_t took = (tsc > r->prev) ? cyc_to_us(tsc - r->prev, r->mhz) : 0;
+    uint64_t at   = (tsc > r->t0)   ? cyc_to_us(tsc - r->t0, r->mhz)   : 0;
+    KLOG_INFO("boottime", "%10llu  %10llu  %s:%s",
+              (unsigned long long)took, (unsigned long long)at, side, name);
+    if (took > r->longest_us) {
+        r->longest_us = took;
+        r->longest    = name;
+    }
+    r->prev = tsc;
+}
+
+void boottime_report(void)
+{
+    const BOOT_INFO*     bi = bootinfo_snapshot();
+    const BOOT_TIMELINE* tl = bi ? &bi->timeline : NULL;
+    uint32_t nl = tl ? tl->count : 0;
+    if (nl > BOOT_STAMP_MAX) nl = BOOT_STAMP_MAX;
+
+    report_t r = { .mhz = (tl ? tl->tsc_hz : 0) / 1000000u };
+    if (!g_ktime.hz && !r.mhz) {
+        KLOG_WARN("boottime", "TSC not calibrated; no boot timeline");
+        return;
+    }
+    if (!nl && !g_nstamps) return;
+
+    /* ローダの名前は固定長配列なので NUL を保証して写す */
+    char names[BOOT_STAMP_MAX][BOOT_STAMP_NAME_MAX];
+    for (uint32_t i = 0; i < nl; ++i) {
+        for (uint32_t k = 0; k < BOOT_STAMP_NAME_MAX; ++k) names[i][k] = tl->stamp[i].name[k];
+        names[i][BOOT_STAMP_NAME_MAX - 1] = '\0';
+    }
+
+    r.t0   = nl ? tl->stamp[0].tsc : g_stamps[0].tsc;
+    r.prev = r.t0;
+    KLOG_INFO("boottime", "boot timeline (%s, t=0 at %s; ~%llu ms after TSC reset):",
+              g_ktime.hz ? "kernel TSC calibration" : "loader TSC calibration",
+              nl ? names[0] : g_stamps[0].name,
+              (unsigned long long)(cyc_to_us(r.t0, r.mhz) / 1000));
+    KLOG_INFO("boottime", "  took(us)      at(us)  phase");
+
+    for (uint32_t i = 0; i < nl; ++i) report_row(&r, "loader", names[i], tl->stamp[i].tsc);
+    uint64_t loader_end = r.prev;
+    for (uint32_t i = 0; i < g_nstamps; ++i) report_row(&r, "kernel", g_stamps[i].name, g_stamps[i].tsc);
+
+    KLOG_INFO("boottime", "total %llu us (loader %llu us, kernel %llu us), longest phase: %s %llu us",
+              (unsigned long long)cyc_to_us(r.prev - r.t0, r.mhz),
+              (unsigned long long)cyc_to_us(loader_end - r.t0, r.mhz),
+              (unsigned long long)cyc_to_us(r.prev - loader_end, r.mhz),
+              r.longest ? r.longest : "-", (unsigned long long)r.longest_us);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * 起動タイムライン（efi_main → VMLAUNCH）
+ *  - ローダが BOOT_INFO.timeline に残した TSC の区切りに、カーネル側の区切りを続ける
+ *  - 区切りは「そこで終わった区間」の名前。区間の長さ = 直前の区切りとの差
+ *  - TSC はリセットからの通し番号なので、ローダとカーネルの値をそのまま並べられる
+ *    （換算はカーネルの較正値。較正前ならローダの値を使う）
+ *  - BSP の起動経路だけで使う（ロック無し）
+ * =========================================================== */
+
+#define BOOTTIME_MAX_STAMPS  24
+
+/* 区切りを打つ。name は文字列リテラル（ポインタをそのまま持つ） */
+void boottime_stamp(const char* name);
+
+/* ローダ分と合わせた区間ごとの表を KLOG_INFO で出す（bootinfo_snapshot_init の後） */
+void boottime_report(void);
@@ -11,6 +11,16 @@ void* memcpy(void* dst, const void* src, size_t n)
     return dst;
 }
 
+void* memset(void* dst, int c, size_t n)
+{
+    unsigned char* d = (unsigned char*)dst;
+
+    while (n--) {
+        *d++ = (unsigned char)c;
+    }
+    return dst;
+}
+
 int memcmp(const void* s1, const void* s2, size_t n)
 {
     const unsigned char* a = (const unsigned char*)s1;
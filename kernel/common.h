@@ -4,4 +4,5 @@
 
 /* 注意: memcpy はオーバーラップ未対応（必要なら memmove を実装） */
 void* memcpy(void* dst, const void* src, size_t n);
+void* memset(void* dst, int c, size_t n);
 int   memcmp(const void* s1, const void* s2, size_t n);
@@ -0,0 +1,351 @@
+#include "console.h"
+#include "log.h"
+#include "workqueue.h"
+#include "timer.h"
+#include "trace.h"
+#include "softirq.h"
+#include "spinlock.h"
+#include "page_alloc.h"
+#include "bin_alloc.h"
+#include "metrics.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/intr_stat.h"
+#include "arch/x86/prof.h"
+#include "arch/x86/vmm/vcpu.h"
+
+#define CONSOLE_LINE_MAX     80
+#define CONSOLE_POLL_NS      (20ULL * 1000 * 1000)   /* ポーリング時の RX 確認間隔 */
+#define CONSOLE_PROF_PERIOD  100000u                 /* prof start の既定サンプル間隔（コアサイクル） */
+#define CONSOLE_PROF_TOP     10
+#define CONSOLE_PROF_TOP_MAX 64
+
+static const char k_prompt[] = "mon> ";
+
+typedef struct console {
+    serial_device_t* dev;
+    uint32_t         cpu;
+    char             line[CONSOLE_LINE_MAX + 1];
+    uint32_t         len;
+    uint8_t          esc;       /* 0: 通常 / 1: ESC の直後 / 2: CSI の途中 */
+    uint8_t          last_cr;   /* CRLF の LF を読み飛ばす */
+} console_t;
+
+static console_t g_con;
+static void console_work_fn(void* arg);
+static void console_poll_fn(void* arg);
+static work_t   g_con_work = WORK_INIT(console_work_fn, NULL);
+static ktimer_t g_con_poll = KTIMER_INIT(console_poll_fn, NULL);
+
+/* ---- 文字列の小道具（libc が無いので最小限） ---- */
+static uint32_t str_len(const char* s)
+{
+    uint32_t n = 0;
+    while (s[n]) ++n;
+    return n;
+}
+
+static int str_eq(const char* a, const char* b)
+{
+    while (*a && *a == *b) { ++a; ++b; }
+    return *a == *b;
+}
+
+/* s の先頭の語が w なら、その後ろ（空白は飛ばす）を返す。違えば NULL */
+static const char* str_word(const char* s, const char* w)
+{
+    while (*w && *s == *w) { ++s; ++w; }
+    if (*w || (*s && *s != ' ')) return NULL;
+    while (*s == ' ') ++s;
+    return s;
+}
+
+/* 10 進の符号無し整数。空・数字以外・桁あふれで -1 */
+static int str_to_u32(const char* s, uint32_t* out)
+{
+    if (!*s) return -1;
+    uint64_t v = 0;
+    for (; *s; ++s) {
+        if (*s < '0' || *s > '9') return -1;
+        v = v * 10 + (uint64_t)(*s - '0');
+        if (v > 0xFFFFFFFFu) return -1;
+    }
+    *out = (uint32_t)v;
+    return 0;
+}
+
+static void con_puts(const char* s)
+{
+    serial_write_buf(g_con.dev, s, str_len(s));
+}
+
+/* ---- コマンド ---- */
+typedef struct console_cmd {
+    const char* name;
+    const char* help;
+    void (*fn)(const char* arg);
+} console_cmd_t;
+
+static void cmd_help(const char* arg);
+
+static void cmd_mem(const char* arg)
+{
+    (void)arg;
+    page_alloc_stats_t ps;
+    page_alloc_get_stats(&ps);
+    KLOG_INFO("console", "pages: managed=%llu free=%llu (%llu KiB) largest_run=%llu",
+              (unsigned long long)ps.managed_frames, (unsigned long long)ps.free_frames,
+              (unsigned long long)(ps.free_frames * (PAGE_SIZE >> 10)),
+              (unsigned long long)ps.largest_free_run);
+
+    bin_alloc_stats_t bs;
+    bin_alloc_get_stats(&bs);
+    for (uint32_t i = 0; i < bs.nbins; ++i) {
+        const bin_alloc_bin_stats_t* b = &bs.bin[i];
+        KLOG_INFO("console", "bin %4llu: allocs=%llu frees=%llu pages=%llu free_chunks=%llu",
+                  (unsigned long long)b->size, (unsigned long long)b->allocs,
+                  (unsigned long long)b->frees, (unsigned long long)b->pages,
+                  (unsigned long long)b->free_chunks);
+    }
+    KLOG_INFO("console", "large: allocs=%llu frees=%llu",
+              (unsigned long long)bs.large_allocs, (unsigned long long)bs.large_frees);
+}
+
+static void cmd_irq(const char* arg)
+{
+    (void)arg;
+    intr_stat_dump();
+}
+
+static void cmd_vmexit(const char* arg)
+{
+    (void)arg;
+    vcpu_dump_exit_stats();
+}
+
+static void cmd_trace(const char* arg)
+{
+    (void)arg;
+    trace_dump(g_con.dev);
+}
+
+static void cmd_metrics(const char* arg)
+{
+    (void)arg;
+    metrics_dump_json(g_con.dev);
+}
+
+static void cmd_stats(const char* arg)
+{
+    (void)arg;
+    serial_stats_t ss;
+    serial_get_stats(&ss);
+    KLOG_INFO("console", "serial: tx=%llu tx_irqs=%llu tx_ring_full=%llu rx=%llu rx_dropped=%llu",
+              (unsigned long long)ss.tx_bytes, (unsigned long long)ss.tx_irqs,
+              (unsigned long long)ss.tx_ring_full, (unsigned long long)ss.rx_bytes,
+              (unsigned long long)ss.rx_dropped);
+    softirq_dump_stats();
+    workqueue_dump_stats();
+    timer_dump_stats();
+    klog_dump_stats();
+    lockstat_dump();
+}
+
+static void cmd_log(const char* arg)
+{
+    static const char* const names[] = { "debug", "info", "warn", "error" };
+    for (int i = 0; i < 4; ++i) {
+        if (str_eq(arg, names[i])) {
+            klog_set_level((klog_level_t)i);
+            KLOG_WARN("console", "log level -> %s", names[i]);
+            return;
+        }
+    }
+    KLOG_WARN("console", "usage: log <debug|info|warn|error> (now %s)", names[g_klog_level]);
+}
+
+/* prof start [period] | stop | top [N] | reset（PMU サンプリング。period はコアサイクル） */
+static void cmd_prof(const char* arg)
+{
+    const char* rest;
+    uint32_t n;
+
+    if ((rest = str_word(arg, "start")) != NULL) {
+        n = CONSOLE_PROF_PERIOD;
+        if (!*rest || str_to_u32(rest, &n) == 0) {
+            if (prof_is_running()) KLOG_WARN("console", "prof: already running");
+            else prof_start(n);
+            return;
+        }
+    } else if ((rest = str_word(arg, "stop")) != NULL && !*rest) {
+        if (!prof_is_running()) {
+            KLOG_WARN("console", "prof: not running");
+        } else {
+            prof_stop();
+            KLOG_INFO("console", "prof: stopped");
+        }
+        return;
+    } else if ((rest = str_word(arg, "top")) != NULL) {
+        n = CONSOLE_PROF_TOP;
+        if (!*rest || (str_to_u32(rest, &n) == 0 && n > 0)) {
+            prof_report_top((int)(n < CONSOLE_PROF_TOP_MAX ? n : CONSOLE_PROF_TOP_MAX));
+            return;
+        }
+    } else if ((rest = str_word(arg, "reset")) != NULL && !*rest) {
+        prof_reset();
+        KLOG_INFO("console", "prof: samples cleared");
+        return;
+    }
+    KLOG_WARN("console", "usage: prof start [period] | stop | top [N] | reset");
+}
+
+static void cmd_pause(const char* arg)
+{
+    (void)arg;
+    vcpu_set_paused(1);
+    KLOG_INFO("console", "vcpu pause requested");
+}
+
+static void cmd_resume(const char* arg)
+{
+    (void)arg;
+    vcpu_set_paused(0);
+    KLOG_INFO("console", "vcpu resume requested");
+}
+
+static const console_cmd_t k_cmds[] = {
+    { "help",   "this list",                          cmd_help   },
+    { "mem",    "page / bin allocator usage",         cmd_mem    },
+    { "irq",    "interrupt counters",                 cmd_irq    },
+    { "vmexit", "VM-exit counts per reason",          cmd_vmexit },
+    { "trace",  "dump the trace buffer (KTRACE ...)", cmd_trace  },
+    { "stats",  "serial/softirq/wq/timer/klog/locks", cmd_stats  },
+    { "metrics","metrics snapshot (KMETRICS JSON)",   cmd_metrics },
+    { "log",    "log <debug|info|warn|error>",        cmd_log    },
+    { "prof",   "prof <start|stop|top|reset> [n]",    cmd_prof   },
+    { "pause",  "pause the vCPU",                     cmd_pause  },
+    { "resume", "resume the vCPU",                    cmd_resume },
+};
+#define NR_CMDS  (sizeof(k_cmds) / sizeof(k_cmds[0]))
+
+static void cmd_help(const char* arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < NR_CMDS; ++i) {
+        KLOG_INFO("console", "%s - %s", k_cmds[i].name, k_cmds[i].help);
+    }
+}
+
+/* 行を "名前 引数" に割って実行（line は書き換える） */
+static void console_exec(char* line)
+{
+    while (*line == ' ') ++line;
+    if (!*line) return;
+
+    char* arg = line;
+    while (*arg && *arg != ' ') ++arg;
+    if (*arg) *arg++ = '\0';
+    while (*arg == ' ') ++arg;
+
+    for (uint32_t i = 0; i < NR_CMDS; ++i) {
+        if (str_eq(line, k_cmds[i].name)) {
+            k_cmds[i].fn(arg);
+            return;
+        }
+    }
+    KLOG_WARN("console", "unknown command '%s' (try 'help')", line);
+}
+
+/* ---- 行編集 ---- */
+static void console_input(uint8_t c)
+{
+    console_t* con = &g_con;
+
+    if (con->esc == 1) { con->esc = (c == '[') ? 2 : 0; return; }
+    if (con->esc == 2) { if (c >= 0x40 && c <= 0x7E) con->esc = 0; return; }   /* 矢印キー等は捨てる */
+
+    if (c == '\n' && con->last_cr) { con->last_cr = 0; return; }
+    con->last_cr = (c == '\r');
+
+    switch (c) {
+    case '\r':
+    case '\n':
+        con_puts("\r\n");
+        con->line[con->len] = '\0';
+        console_exec(con->line);
+        con->len = 0;
+        klog_flush();                    /* 結果を出し切ってからプロンプト */
+        con_puts(k_prompt);
+        break;
+    case 0x08:
+    case 0x7F:
+        if (con->len) {
+            --con->len;
+            con_puts("\b \b");
+        }
+        break;
+    case 0x15:                            /* Ctrl-U: 行を消す */
+        while (con->len) { --con->len; con_puts("\b \b"); }
+        break;
+    case 0x1B:
+        con->esc = 1;
+        break;
+    default:
+        if (c >= 0x20 && c < 0x7F && con->len < CONSOLE_LINE_MAX) {
+            con->line[con->len++] = (char)c;
+            char echo = (char)c;
+            serial_write_buf(con->dev, &echo, 1);
+        }
+        break;
+    }
+}
+
+/* console CPU の work：RX リングを空になるまで読む */
+static void console_work_fn(void* arg)
+{
+    (void)arg;
+    int c;
+    while ((c = serial_read_byte(g_con.dev)) >= 0) console_input((uint8_t)c);
+}
+
+/* RX 割込み（IF=0）から：work を積むだけ */
+static void console_rx_notify(void)
+{
+    queue_work_on(g_con.cpu, &g_con_work);
+}
+
+/* 割込みモードでない時：console CPU のタイマで周期的に work を積む */
+static void console_poll_fn(void* arg)
+{
+    (void)arg;
+    queue_work(&g_con_work);
+    timer_arm_after(&g_con_poll, CONSOLE_POLL_NS);
+}
+
+/* タイマは登録した CPU のホイールで回るので、console CPU 上で張る */
+static void console_start_poll(void* arg)
+{
+    (void)arg;
+    timer_arm_after(&g_con_poll, CONSOLE_POLL_NS);
+}
+static work_t g_con_start = WORK_INIT(console_start_poll, NULL);
+
+int console_init(serial_device_t* dev, uint32_t console_cpu)
+{
+    if (!dev || g_con.dev || !percpu_get(console_cpu)) return -1;
+
+    g_con.dev     = dev;
+    g_con.cpu     = console_cpu;
+    g_con.len     = 0;
+    g_con.esc     = 0;
+    g_con.last_cr = 0;
+
+    if (dev->irq_mode) {
+        serial_set_rx_notify(dev, console_rx_notify);
+    } else if (queue_work_on(console_cpu, &g_con_start) < 0) {
+        return -1;
+    }
+    KLOG_INFO("console", "monitor on cpu%u (%s), type 'help'",
+              console_cpu, dev->irq_mode ? "rx irq" : "polled");
+    con_puts(k_prompt);
+    return 0;
+}
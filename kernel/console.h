@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include "serial.h"
+
+/* =========================== 概要 ===========================
+ * シリアルのモニタ用コンソール（統計表示と簡単な操作）
+ *  - 受信は UART 割込み → RX リング。ISR は console CPU に work を積むだけ
+ *    （割込みモードでない時は console CPU のタイマで RX をポーリングする）
+ *  - 行編集（エコー・BS/DEL・Ctrl-U）とコマンド実行は全て work の中。
+ *    VM-exit の経路では何もしないので vCPU の Exit 遅延には効かない
+ *  - 結果は KLOG_INFO で出す（プロンプトとエコーだけ UART へ直接）
+ *
+ *  コマンド: help / mem / irq / vmexit / trace / stats / metrics /
+ *            log <debug|info|warn|error> / prof <start|stop|top|reset> [n] /
+ *            pause / resume
+ * =========================================================== */
+
+/* dev の受信を console_cpu の work で捌くようにする。0:ok / -1 */
+int console_init(serial_device_t* dev, uint32_t console_cpu);
@@ -0,0 +1,48 @@
+#include "kline.h"
+
+/* 本文に使えるのは cap - 2 バイトまで（残りは kline_emit の "\r\n"） */
+static inline int kline_room(const kline_t* l, uint32_t n)
+{
+    return l->len + n + 2 <= l->cap;
+}
+
+void kline_put_str(kline_t* l, const char* s)
+{
+    while (*s && kline_room(l, 1)) l->buf[l->len++] = *s++;
+}
+
+void kline_put_u64(kline_t* l, uint64_t v)
+{
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n && kline_room(l, 1)) l->buf[l->len++] = tmp[--n];
+}
+
+void kline_put_s64(kline_t* l, int64_t v)
+{
+    if (v < 0) {
+        kline_put_str(l, "-");
+        kline_put_u64(l, (uint64_t)0 - (uint64_t)v);
+    } else {
+        kline_put_u64(l, (uint64_t)v);
+    }
+}
+
+void kline_put_hex(kline_t* l, const void* p, uint32_t n)
+{
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t* b = (const uint8_t*)p;
+    for (uint32_t i = 0; i < n && kline_room(l, 2); ++i) {
+        l->buf[l->len++] = digits[b[i] >> 4];
+        l->buf[l->len++] = digits[b[i] & 0xF];
+    }
+}
+
+void kline_emit(serial_device_t* dev, kline_t* l)
+{
+    l->buf[l->len++] = '\r';
+    l->buf[l->len++] = '\n';
+    serial_write_buf(dev, l->buf, l->len);
+    l->len = 0;
+}
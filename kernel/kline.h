@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "serial.h"
+
+/* =========================== 概要 ===========================
+ * シリアルへ直接出す機械可読の行（KTRACE / KMETRICS など）の組み立て
+ *  - バッファは呼び出し側が持つ。溢れた分は切り捨て、"\r\n" の 2 バイトは常に残す
+ *  - ログ行と混ざっても拾えるよう、行頭は各形式の見出し（"KTRACE " 等）にする
+ * =========================================================== */
+
+typedef struct kline {
+    char*    buf;
+    uint32_t len;
+    uint32_t cap;       /* buf のバイト数（"\r\n" の分を含む） */
+} kline_t;
+
+#define KLINE_INIT(b)  { (b), 0, (uint32_t)sizeof(b) }
+
+void kline_put_str(kline_t* l, const char* s);
+void kline_put_u64(kline_t* l, uint64_t v);
+void kline_put_s64(kline_t* l, int64_t v);
+/* p から n バイトを 16 進 2 桁ずつ（メモリ順） */
+void kline_put_hex(kline_t* l, const void* p, uint32_t n);
+
+/* "\r\n" を付けて dev へ書き、行を空にする */
+void kline_emit(serial_device_t* dev, kline_t* l);
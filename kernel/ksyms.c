@@ -0,0 +1,50 @@
+#include "ksyms.h"
+
+/* tools/gen_ksyms.sh が生成する（build/kernel/ksyms_gen.S） */
+extern const uint64_t __ksym_count;
+extern const uint64_t __ksym_addrs[];
+extern const uint32_t __ksym_name_offs[];
+extern const char     __ksym_names[];
+
+/* テキストの終端（これより後ろは最後のシンボルに含めない） */
+extern uint8_t __text_end[];
+
+uint64_t ksym_count(void)
+{
+    return __ksym_count;
+}
+
+int64_t ksym_index(uint64_t addr)
+{
+    uint64_t n = __ksym_count;
+    if (n == 0 || addr < __ksym_addrs[0] || addr >= (uint64_t)(uintptr_t)__text_end) return -1;
+
+    /* addrs[lo] <= addr < addrs[hi] を保って詰める */
+    uint64_t lo = 0, hi = n;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (__ksym_addrs[mid] <= addr) lo = mid;
+        else                           hi = mid;
+    }
+    return (int64_t)lo;
+}
+
+const char* ksym_name(int64_t idx)
+{
+    if (idx < 0 || (uint64_t)idx >= __ksym_count) return NULL;
+    return &__ksym_names[__ksym_name_offs[idx]];
+}
+
+uint64_t ksym_addr(int64_t idx)
+{
+    if (idx < 0 || (uint64_t)idx >= __ksym_count) return 0;
+    return __ksym_addrs[idx];
+}
+
+const char* ksym_lookup(uint64_t addr, uint64_t* off)
+{
+    int64_t idx = ksym_index(addr);
+    if (idx < 0) return NULL;
+    if (off) *off = addr - __ksym_addrs[idx];
+    return ksym_name(idx);
+}
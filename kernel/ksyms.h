@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* =========================== 概要 ===========================
+ * リンク時に埋め込んだカーネルのシンボル表（テキストのみ、アドレス昇順）
+ *  - Makefile が 1 回目のリンク結果から tools/gen_ksyms.sh で生成して再リンクする
+ *  - ksym_lookup は二分探索
+ * =========================================================== */
+
+/* addr を含む関数名を返す（見つからなければ NULL）。off には関数先頭からのオフセット */
+const char* ksym_lookup(uint64_t addr, uint64_t* off);
+
+/* addr を含む関数の表インデックス（見つからなければ -1） */
+int64_t ksym_index(uint64_t addr);
+
+/* インデックスから名前・先頭アドレス */
+const char* ksym_name(int64_t idx);
+uint64_t    ksym_addr(int64_t idx);
+
+uint64_t ksym_count(void);
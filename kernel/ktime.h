@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+#include "arch/x86/arch_x86_low.h"
+
+/* =========================== 概要 ===========================
+ * 単調増加の高分解能クロック
+ *  - 時間源は TSC（tsc_init で較正。それまでは 0 を返す）
+ *  - 起点は較正時点。ns への換算は mult/shift の乗算 1 回（除算なし）
+ *      ns  = (cycles * mult) >> KTIME_SHIFT
+ *      cyc = (ns * inv_mult) >> KTIME_INV_SHIFT
+ * =========================================================== */
+
+#define KTIME_SHIFT       32
+#define KTIME_INV_SHIFT   24
+#define NSEC_PER_SEC      1000000000ULL
+#define NSEC_PER_MSEC     1000000ULL
+#define NSEC_PER_USEC     1000ULL
+
+typedef struct ktime_conv {
+    uint64_t base_cycles;    /* 較正時点の TSC */
+    uint64_t mult;           /* cycles → ns */
+    uint64_t inv_mult;       /* ns → cycles */
+    uint64_t hz;             /* 0 = 未較正 */
+} ktime_conv_t;
+
+extern ktime_conv_t g_ktime;
+
+static inline uint64_t ktime_cyc2ns(uint64_t cycles)
+{
+    return (uint64_t)(((unsigned __int128)cycles * g_ktime.mult) >> KTIME_SHIFT);
+}
+
+static inline uint64_t ktime_ns2cyc(uint64_t ns)
+{
+    return (uint64_t)(((unsigned __int128)ns * g_ktime.inv_mult) >> KTIME_INV_SHIFT);
+}
+
+/* 較正時点からの TSC サイクル */
+static inline uint64_t ktime_cycles(void)
+{
+    if (!g_ktime.hz) return 0;
+    return rdtsc() - g_ktime.base_cycles;
+}
+
+/* 較正時点からの ns */
+static inline uint64_t ktime_ns(void)
+{
+    return ktime_cyc2ns(ktime_cycles());
+}
+
+/* ktime_ns() の値を TSC の絶対値に戻す（TSC-deadline 等の設定用） */
+static inline uint64_t ktime_ns_to_tsc(uint64_t ns)
+{
+    return g_ktime.base_cycles + ktime_ns2cyc(ns);
+}
@@ -20,20 +20,155 @@ typedef struct {
     klog_level_t level;      /* これ未満のレベルは出力しない */
 } klog_options_t;
 
-/* 初期化：必ずシリアル初期化（serial_init）が先 */
+/* コンパイル時の下限（0=DEBUG .. 3=ERROR）。これ未満の KLOG_* は引数の評価ごと消える。
+ * make KLOG_MIN_LEVEL=1 などで指定 */
+#ifndef KLOG_MIN_LEVEL
+#define KLOG_MIN_LEVEL 0
+#endif
+
+/* 実行時の下限（klog_set_level で変える）。マクロ側で先に見て呼び出しを省く */
+extern klog_level_t g_klog_level;
+
+/* 出力先。完成した 1 行（"\r\n" 付き）を write で受け取る。
+ * g_log_lock 下で呼ばれるので、中で KLOG_* を使わないこと */
+typedef struct klog_sink {
+    const char* name;
+    void (*write)(struct klog_sink* sink, const char* buf, uint32_t len);
+    void*       ctx;
+} klog_sink_t;
+
+/* 初期化：必ずシリアル初期化（serial_init）が先。シリアルとメモリリングのシンクを登録する */
 void klog_init(serial_device_t* dev, klog_options_t opt);
 /* ランタイムでログレベルを変える場合 */
 void klog_set_level(klog_level_t level);
 
+/* シンクを追加する（最大 4 個）。0:ok / -1:満杯 */
+int  klog_add_sink(klog_sink_t* sink);
+/* write の中から呼ぶ：その行を記録した CPU（非同期時は drain CPU ではなく元の CPU） */
+uint32_t klog_sink_cpu(void);
+
+/* メモリリングのシンクから *pos 以降を最大 cap バイト読む（上書き済みの分は飛ばす）。
+ * 読んだバイト数を返し、*pos を進める */
+uint32_t klog_mem_read(uint64_t* pos, char* out, uint32_t cap);
+
+#ifdef KERNEL_BENCH
+/* 1 行の整形・シンク書き込みにかかるサイクル数を測る */
+void klog_bench(void);
+#endif
+
+/* 以降のログを CPU ごとのリングに積み、drain_cpu のワークキューで
+ * シリアルへ書き出す（呼び出し側はシリアルを待たない）。
+ * drain_cpu は workqueue_init_cpu 済みで online であること */
+void klog_start_async(uint32_t drain_cpu);
+/* リングに残っているレコードを呼び出し CPU で全て書き出す */
+void klog_flush(void);
+/* 同期・ポーリング出力へ戻す（リングは先に吐き出す）。panic 用 */
+void klog_stop_async(void);
+
 /* 低レベル API（printf 互換）。scope は任意（NULL 可） */
 void klog_logf(klog_level_t level, const char* scope, const char* fmt, ...);
 void klog_vlogf(klog_level_t level, const char* scope, const char* fmt, va_list ap);
 
+/* 遅延整形：fmt のポインタと u64 に直した引数だけを積み、整形は drain 側で行う。
+ * fmt と %s の引数は文字列リテラルなど消えない領域に限る。整数・ポインタのみ */
+#define KLOG_DEFER_MAX_ARGS 6
+void klog_deferf(klog_level_t level, const char* scope, const char* fmt,
+                 uint32_t nargs, const uint64_t* argv);
+
+/* レベル判定（定数の比較はコンパイル時に畳まれ、DEBUG は外れ側に予測） */
+#define KLOG_ENABLED(level)                                                  \
+    ((level) >= KLOG_MIN_LEVEL &&                                            \
+     __builtin_expect((level) >= g_klog_level, (level) >= KLOG_INFO))
+
+#define KLOG_AT(level, scope, fmt, ...)                                      \
+    do {                                                                     \
+        if (KLOG_ENABLED(level))                                             \
+            klog_logf((level), (scope), (fmt), ##__VA_ARGS__);               \
+    } while (0)
+
+/* 引数を u64 配列に詰める（最大 KLOG_DEFER_MAX_ARGS 個） */
+#define KLOG_U64(x)  ((uint64_t)(x))
+#define KLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define KLOG_NARGS(...) KLOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define KLOG_ARGV_0()
+#define KLOG_ARGV_1(a)                   KLOG_U64(a)
+#define KLOG_ARGV_2(a, b)                KLOG_U64(a), KLOG_U64(b)
+#define KLOG_ARGV_3(a, b, c)             KLOG_ARGV_2(a, b), KLOG_U64(c)
+#define KLOG_ARGV_4(a, b, c, d)          KLOG_ARGV_3(a, b, c), KLOG_U64(d)
+#define KLOG_ARGV_5(a, b, c, d, e)       KLOG_ARGV_4(a, b, c, d), KLOG_U64(e)
+#define KLOG_ARGV_6(a, b, c, d, e, f)    KLOG_ARGV_5(a, b, c, d, e), KLOG_U64(f)
+#define KLOG_ARGV__(n, ...)  KLOG_ARGV_##n(__VA_ARGS__)
+#define KLOG_ARGV_(n, ...)   KLOG_ARGV__(n, ##__VA_ARGS__)
+
+#define KLOG_DEFER_CALL_(level, scope, fmt, ...)                             \
+    do {                                                                     \
+        const uint64_t klog_argv_[KLOG_NARGS(__VA_ARGS__) + 1] =             \
+            { KLOG_ARGV_(KLOG_NARGS(__VA_ARGS__), ##__VA_ARGS__) };          \
+        klog_deferf((level), (scope), (fmt), KLOG_NARGS(__VA_ARGS__), klog_argv_); \
+    } while (0)
+
+#define KLOG_DEFER_AT(level, scope, fmt, ...)                                \
+    do {                                                                     \
+        if (KLOG_ENABLED(level))                                             \
+            KLOG_DEFER_CALL_((level), (scope), (fmt), ##__VA_ARGS__);        \
+    } while (0)
+
+/* ---- 呼び出し点ごとのレート制限（トークンバケット） ----
+ * burst 個まで連続で出し、以降は interval_ns あたり burst 個のペースで補充。
+ * 抑制した件数は次に出せた時に 1 行で報告し、klog_dump_stats() でも見える */
+typedef struct klog_ratelimit {
+    uint64_t                interval_ns;
+    uint32_t                burst;
+    uint32_t                tokens;
+    uint64_t                last_ns;        /* 最後に補充した時刻 */
+    uint64_t                suppressed;     /* 次の報告までに抑制した件数 */
+    uint64_t                total_suppressed;
+    const char*             file;
+    int                     line;
+    volatile uint32_t       busy;           /* 取れなければ抑制扱い（待たない） */
+    uint32_t                registered;
+    struct klog_ratelimit*  next;
+} klog_ratelimit_t;
+
+#define KLOG_RATELIMIT_BURST        10
+#define KLOG_RATELIMIT_INTERVAL_NS  5000000000ULL     /* 5 秒で 10 行 */
+#define KLOG_RATELIMIT_INIT(BURST, INTERVAL_NS) \
+    { .interval_ns = (INTERVAL_NS), .burst = (BURST), .tokens = (BURST), \
+      .file = __FILE__, .line = __LINE__ }
+
+/* 出してよければ 1。直前まで抑制していた分があれば先に報告する */
+int klog_ratelimit(klog_ratelimit_t* rl, klog_level_t level, const char* scope);
+
+#define KLOG_RATELIMITED_(LOGMACRO, level, scope, fmt, ...)                  \
+    do {                                                                     \
+        if (KLOG_ENABLED(level)) {                                           \
+            static klog_ratelimit_t klog_rl_ =                               \
+                KLOG_RATELIMIT_INIT(KLOG_RATELIMIT_BURST, KLOG_RATELIMIT_INTERVAL_NS); \
+            if (klog_ratelimit(&klog_rl_, (level), (scope)))                 \
+                LOGMACRO((level), (scope), (fmt), ##__VA_ARGS__);            \
+        }                                                                    \
+    } while (0)
+
+/* ドロップ・抑制・重複行の集計を出す */
+void klog_dump_stats(void);
+
 /* 使いやすいマクロ（Zig の std.log.* 相当） */
-#define KLOG_DEBUG(scope, fmt, ...) klog_logf(KLOG_DEBUG, (scope), (fmt), ##__VA_ARGS__)
-#define KLOG_INFO(scope,  fmt, ...) klog_logf(KLOG_INFO,  (scope), (fmt), ##__VA_ARGS__)
-#define KLOG_WARN(scope,  fmt, ...) klog_logf(KLOG_WARN,  (scope), (fmt), ##__VA_ARGS__)
-#define KLOG_ERROR(scope, fmt, ...) klog_logf(KLOG_ERROR, (scope), (fmt), ##__VA_ARGS__)
+#define KLOG_DEBUG(scope, fmt, ...) KLOG_AT(KLOG_DEBUG, (scope), (fmt), ##__VA_ARGS__)
+#define KLOG_INFO(scope,  fmt, ...) KLOG_AT(KLOG_INFO,  (scope), (fmt), ##__VA_ARGS__)
+#define KLOG_WARN(scope,  fmt, ...) KLOG_AT(KLOG_WARN,  (scope), (fmt), ##__VA_ARGS__)
+#define KLOG_ERROR(scope, fmt, ...) KLOG_AT(KLOG_ERROR, (scope), (fmt), ##__VA_ARGS__)
+
+/* ホットパス用（VM-exit ハンドラ等）：整形を drain 側へ回す */
+#define KLOG_DEBUG_DEFER(scope, fmt, ...) KLOG_DEFER_AT(KLOG_DEBUG, (scope), (fmt), ##__VA_ARGS__)
+#define KLOG_INFO_DEFER(scope,  fmt, ...) KLOG_DEFER_AT(KLOG_INFO,  (scope), (fmt), ##__VA_ARGS__)
+
+/* ゲストが叩ける経路用：呼び出し点ごとにレート制限 */
+#define KLOG_DEBUG_RATELIMITED(scope, fmt, ...) KLOG_RATELIMITED_(klog_logf, KLOG_DEBUG, scope, fmt, ##__VA_ARGS__)
+#define KLOG_INFO_RATELIMITED(scope,  fmt, ...) KLOG_RATELIMITED_(klog_logf, KLOG_INFO,  scope, fmt, ##__VA_ARGS__)
+#define KLOG_WARN_RATELIMITED(scope,  fmt, ...) KLOG_RATELIMITED_(klog_logf, KLOG_WARN,  scope, fmt, ##__VA_ARGS__)
+#define KLOG_ERROR_RATELIMITED(scope, fmt, ...) KLOG_RATELIMITED_(klog_logf, KLOG_ERROR, scope, fmt, ##__VA_ARGS__)
+#define KLOG_DEBUG_DEFER_RATELIMITED(scope, fmt, ...) \
+    KLOG_RATELIMITED_(KLOG_DEFER_CALL_, KLOG_DEBUG, scope, fmt, ##__VA_ARGS__)
 
 #ifdef __cplusplus
 }
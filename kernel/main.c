@@ -8,6 +8,25 @@
 #include "arch/x86/paging.h"
 #include "bin_alloc.h"
 #include "arch/x86/pic.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/smpboot.h"
+#include "arch/x86/smp.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/ioapic.h"
+#include "acpi.h"
+#include "arch/x86/intr_bench.h"
+#include "workqueue.h"
+#include "timer.h"
+#include "trace.h"
+#include "shmlog.h"
+#include "console.h"
+#include "metrics.h"
+#include "boottime.h"
+#include "arch/x86/intr_stat.h"
+#include "arch/x86/vectors.h"
+#include "arch/x86/prof.h"
+#include "arch/x86/pit.h"
+#include "arch/x86/tsc.h"
 #include "page_alloc.h"
 #include "memmap.h"
 #include "panic.h"
@@ -65,6 +84,11 @@ static void kernelTrampoline(void *boot_info)
 
 static void kernelMain(BOOT_INFO *bi)
 {
+    boottime_stamp("kernel_entry");
+
+    /* --- BSP の per-CPU 領域（GS base）。以降 this_cpu() が使える --- */
+    percpu_init_bsp();
+
     /* --- シリアル初期化 --- */
     serial_device_t com1;
     serial_init(&com1, COM1, 115200);
@@ -72,6 +96,14 @@ static void kernelMain(BOOT_INFO *bi)
     /* --- ログ初期化 --- */
     klog_init(&com1, (klog_options_t){ .level = KLOG_DEBUG });
 
+    /* --- TSC 較正（以降ログに時刻が付き、ktime_ns() が使える） --- */
+    if (tsc_init() != 0) {
+        KLOG_WARN("main", "TSC calibration failed; ktime stays at 0");
+    }
+    boottime_stamp("tsc_calib");
+    trace_init();
+    metrics_init();
+
     if (bootinfo_snapshot_init(bi) != 0) {
         KLOG_ERROR("main", "bootinfo snapshot failed");
         for(;;) __asm__ __volatile__("hlt");
@@ -83,37 +115,114 @@ static void kernelMain(BOOT_INFO *bi)
 
     /* GDT → IDT（順序はこのままでOK） */
     gdt_init();
+    boottime_stamp("gdt");
     KLOG_INFO("main", "Initialized GDT.");
 
     intr_init_all_vectors();   /* IDT 構築＋LIDT＋STI */
+    boottime_stamp("idt");
     KLOG_INFO("main", "Initialized IDT.");
 
     page_allocator_init(bootinfo_snapshot_memmap());
+    smp_reserve_trampoline();   /* 1MiB 未満が他の確保で埋まる前に */
+    boottime_stamp("page_alloc");
     KLOG_INFO("main", "Reconstructing memory mapping...");
     if (paging_reconstruct_and_mark() != 0) {
         KLOG_ERROR("main", "paging reconstruct failed");
         for(;;) __asm__ __volatile__("hlt");
     }
     KLOG_INFO("main", "Paging is reconstructed.");
+    boottime_stamp("paging");
     page_allocator_release_boot_services_data(bootinfo_snapshot_memmap());
     KLOG_INFO("main", "BootServicesData released to allocator.");
 
     bin_alloc_init();
     KLOG_INFO("main", "Initialized bin allocator.");
 
-    pic_init();
-    KLOG_INFO("main", "Initialized PIC.");
+    /* UART 無しでも読める共有メモリログ（ivshmem があればそこ） */
+    if (shmlog_init() != 0) {
+        KLOG_WARN("main", "shared-memory log unavailable");
+    }
+
+    /* 8259 は全マスクして以後使わない。割込みコントローラは LAPIC */
+    pic_disable();
+    lapic_init();
+    percpu_finish_bsp(lapic_id());
+    KLOG_INFO("main", "Initialized LAPIC (%s), 8259 PIC masked.",
+              lapic_is_x2apic() ? "x2APIC" : "xAPIC");
+
+    /* tickless タイマ（TSC-deadline ワンショット） */
+    if (timer_init_cpu() != 0) {
+        KLOG_WARN("main", "LAPIC timer unavailable; timers will not fire");
+    }
+
+    /* MADT（CPU 一覧・IOAPIC・ISO）を読むために ACPI を先に */
+    if (acpi_init(bootinfo_snapshot()->acpi_rsdp) != 0) {
+        KLOG_WARN("main", "ACPI tables not found");
+    }
+    if (ioapic_init() == 0) {
+        KLOG_INFO("main", "Initialized IOAPIC (all pins masked).");
+        /* COM1 (IRQ4) を割込み駆動に */
+        int vec = serial_enable_irq(&com1, 4, lapic_id());
+        if (vec >= 0) {
+            KLOG_INFO("main", "serial: irq-driven (vector 0x%x, fifo %u bytes)", vec, com1.fifo_depth);
+        }
+    }
+
+    boottime_stamp("intr_ctrl");
+
+    if (smp_boot_aps() < 0) {
+        KLOG_WARN("main", "AP bring-up skipped; running on BSP only");
+    }
+    boottime_stamp("smp_boot");
+    /* ログの書き出しは最後の AP に任せる（AP が無ければ同期出力のまま） */
+    cpumask_t online = smp_online_mask() & ~CPUMASK_CPU(this_cpu_id());
+    uint32_t service_cpu = this_cpu_id();
+    if (online) {
+        service_cpu = 63 - (uint32_t)__builtin_clzll(online);
+        klog_start_async(service_cpu);
+        KLOG_INFO("main", "klog: async drain on cpu%u", service_cpu);
+    }
+    /* モニタコンソールも同じ CPU で（BSP だけなら VM-exit の後ろで拾う） */
+    if (console_init(&com1, service_cpu) != 0) {
+        KLOG_WARN("main", "console: init failed");
+    }
+    /* メトリクスを共有メモリログの表へ 1 秒ごとに写す */
+    if (metrics_start_export(service_cpu, 1000ULL * 1000 * 1000) != 0) {
+        KLOG_WARN("main", "metrics: export not started");
+    }
+    boottime_stamp("services");
+#ifdef KERNEL_BENCH
+    intr_bench_pic_vs_lapic();
+    intr_bench_entry_paths();
+    workqueue_bench();
+    klog_bench();
+    timer_bench();
+    intr_stat_dump();
+    intr_stat_dump_hist(VEC_IPI_CALL);
+    if (prof_start(100000) == 0) {
+        pit_delay_us(200000);
+        prof_stop();
+        prof_report_top(10);
+        prof_reset();
+    }
+    smp_tlb_shootdown_bench();
+    klog_dump_stats();
+    trace_dump(&com1);
+    boottime_stamp("bench");
+#endif
 
     if (vmx_init_and_enter() != 0) {
         KLOG_ERROR("kmain", "VMX root entry failed");
         panic("VMXON failed");
     }
+    boottime_stamp("vmxon");
 
     void* vmcs_va = NULL;
     if (vmcs_alloc_and_load(&vmcs_va) != 0) {
         KLOG_ERROR("main", "vmcs_alloc_and_load failed");
         panic("VMCS load failed");
     }
+    boottime_stamp("vmcs_load");
 
     KLOG_INFO("main", "Starting the virtual machine...");
     if (vcpu_build_vmcs_and_launch() != 0) {
@@ -11,6 +11,11 @@
 #define KERNEL_BASE             0xFFFFFFFF80000000ULL
 #define KERNEL_TEXT_BASE        0xFFFFFFFF80100000ULL
 
+/* CPU ごとのカーネルスタック領域（4KiB でマップ、スロット間は未マップのガード） */
+#define CPU_STACK_REGION_BASE   0xFFFFC90000000000ULL
+#define CPU_STACK_PAGES         8                      /* 32 KiB */
+#define CPU_STACK_SLOT_SIZE     (64ULL << 10)          /* guard + stack + 余白 */
+
 /* ページング（レベルごとのシフト） */
 #define LV1_SHIFT               12
 #define LV2_SHIFT               21
@@ -0,0 +1,178 @@
+#include "metrics.h"
+#include "log.h"
+#include "kline.h"
+#include "ktime.h"
+#include "timer.h"
+#include "workqueue.h"
+#include "shmlog.h"
+
+uint64_t g_metric_slots[MAX_CPUS][METRICS_SLOTS_PER_CPU] __attribute__((aligned(64)));
+
+static inline uint32_t metric_width(const metric_t* m)
+{
+    return (m->type == METRIC_HISTOGRAM) ? METRIC_HIST_WIDTH : 1;
+}
+
+int metrics_init(void)
+{
+    /* スロット 0..METRIC_HIST_WIDTH-1 は捨て場（init 前の更新が落ちる先） */
+    uint32_t next = METRIC_HIST_WIDTH;
+    int ok = 0;
+    for (metric_t* m = __metrics_start; m < __metrics_end; ++m) {
+        uint32_t w = metric_width(m);
+        if (next + w > METRICS_SLOTS_PER_CPU) {
+            KLOG_ERROR("metrics", "out of slots at '%s'", m->name);
+            ok = -1;
+            continue;                       /* 捨て場のまま */
+        }
+        m->base = next;
+        next += w;
+    }
+    KLOG_INFO("metrics", "%llu metrics, %u/%u slots per cpu",
+              (unsigned long long)(__metrics_end - __metrics_start), next, METRICS_SLOTS_PER_CPU);
+    return ok;
+}
+
+void metrics_read(const metric_t* m, metric_value_t* out)
+{
+    if (!m || !out) return;
+    uint32_t w = metric_width(m);
+    uint64_t acc[METRIC_HIST_WIDTH] = { 0 };
+
+    uint32_t ncpu = percpu_count();
+    for (uint32_t cpu = 0; cpu < ncpu; ++cpu) {
+        const uint64_t* s = &g_metric_slots[cpu][m->base];
+        for (uint32_t i = 0; i < w; ++i) acc[i] += __atomic_load_n(&s[i], __ATOMIC_RELAXED);
+    }
+
+    out->value = acc[0];
+    out->count = 0;
+    out->sum   = 0;
+    for (uint32_t i = 0; i < METRIC_HIST_BUCKETS; ++i) out->buckets[i] = 0;
+    if (m->type == METRIC_HISTOGRAM) {
+        out->count = acc[METRIC_HIST_COUNT];
+        out->sum   = acc[METRIC_HIST_SUM];
+        for (uint32_t i = 0; i < METRIC_HIST_BUCKETS; ++i) out->buckets[i] = acc[METRIC_HIST_BUCKET + i];
+    }
+}
+
+/* ---- JSON（"KMETRICS " で始まる行） ---- */
+static const char* const k_type_names[] = { "counter", "gauge", "histogram" };
+
+void metrics_dump_json(serial_device_t* dev)
+{
+    if (!dev) return;
+    klog_flush();
+
+    char buf[640];
+    kline_t l = KLINE_INIT(buf);
+    kline_put_str(&l, "KMETRICS {\"version\":1,\"ts_ns\":");
+    kline_put_u64(&l, ktime_ns());
+    kline_put_str(&l, ",\"cpus\":");
+    kline_put_u64(&l, percpu_count());
+    kline_put_str(&l, "}");
+    kline_emit(dev, &l);
+
+    for (const metric_t* m = __metrics_start; m < __metrics_end; ++m) {
+        metric_value_t v;
+        metrics_read(m, &v);
+
+        kline_put_str(&l, "KMETRICS {\"name\":\"");
+        kline_put_str(&l, m->name);
+        kline_put_str(&l, "\",\"type\":\"");
+        kline_put_str(&l, k_type_names[m->type]);
+        kline_put_str(&l, "\"");
+        if (m->type == METRIC_COUNTER) {
+            kline_put_str(&l, ",\"value\":");
+            kline_put_u64(&l, v.value);
+        } else if (m->type == METRIC_GAUGE) {
+            kline_put_str(&l, ",\"value\":");
+            kline_put_s64(&l, (int64_t)v.value);
+        } else {
+            kline_put_str(&l, ",\"count\":");
+            kline_put_u64(&l, v.count);
+            kline_put_str(&l, ",\"sum\":");
+            kline_put_u64(&l, v.sum);
+            /* 末尾の 0 は省く（バケット i の上限は 2^i） */
+            uint32_t n = METRIC_HIST_BUCKETS;
+            while (n && !v.buckets[n - 1]) --n;
+            kline_put_str(&l, ",\"buckets\":[");
+            for (uint32_t i = 0; i < n; ++i) {
+                if (i) kline_put_str(&l, ",");
+                kline_put_u64(&l, v.buckets[i]);
+            }
+            kline_put_str(&l, "]");
+        }
+        kline_put_str(&l, "}");
+        kline_emit(dev, &l);
+    }
+
+    kline_put_str(&l, "KMETRICS END");
+    kline_emit(dev, &l);
+}
+
+/* ---- shmlog へ ---- */
+static int shm_slot_for(metric_t* m, int k, const char* suffix)
+{
+    if (m->shm_slot[k] >= 0) return m->shm_slot[k];
+
+    char name[METRIC_NAME_MAX];
+    int n = 0;
+    for (; n < METRIC_NAME_MAX - 1 && m->name[n]; ++n) name[n] = m->name[n];
+    for (; n < METRIC_NAME_MAX - 1 && suffix && *suffix; ++suffix) name[n++] = *suffix;
+    name[n] = '\0';
+
+    m->shm_slot[k] = shmlog_metric_slot(name);
+    return m->shm_slot[k];
+}
+
+void metrics_publish(void)
+{
+    for (metric_t* m = __metrics_start; m < __metrics_end; ++m) {
+        metric_value_t v;
+        metrics_read(m, &v);
+        if (m->type == METRIC_HISTOGRAM) {
+            shmlog_metric_set(shm_slot_for(m, 0, ".count"), v.count);
+            shmlog_metric_set(shm_slot_for(m, 1, ".sum"), v.sum);
+        } else {
+            shmlog_metric_set(shm_slot_for(m, 0, NULL), v.value);
+        }
+    }
+}
+
+/* ---- 周期書き出し（指定 CPU のタイマ → work。publish は割込み許可で走る） ---- */
+static uint64_t g_export_period_ns;
+
+static void metrics_export_work(void* arg)
+{
+    (void)arg;
+    metrics_publish();
+}
+static work_t g_export_work = WORK_INIT(metrics_export_work, NULL);
+
+static void metrics_export_tick(void* arg)
+{
+    queue_work(&g_export_work);
+    timer_arm_after((ktimer_t*)arg, g_export_period_ns);
+}
+static ktimer_t g_export_timer;
+
+static void metrics_export_start(void* arg)
+{
+    (void)arg;
+    metrics_publish();
+    timer_setup(&g_export_timer, metrics_export_tick, &g_export_timer);
+    timer_arm_after(&g_export_timer, g_export_period_ns);
+}
+static work_t g_export_start = WORK_INIT(metrics_export_start, NULL);
+
+int metrics_start_export(uint32_t cpu, uint64_t period_ns)
+{
+    if (!period_ns || g_export_period_ns) return -1;
+    g_export_period_ns = period_ns;
+    if (queue_work_on(cpu, &g_export_start) < 0) {
+        g_export_period_ns = 0;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include "serial.h"
+#include "arch/x86/percpu.h"
+
+/* =========================== 概要 ===========================
+ * メトリクスの登録簿（counter / gauge / histogram）
+ *  - 定義はコンパイル時に .metrics セクションへ並べる（trace のイベントと同じ形）。
+ *    metrics_init() が各定義に CPU 行内のスロット位置を割り当てる
+ *  - 値は CPU ごとの 64B 整列の行（g_metric_slots[cpu][...]）に持つ。
+ *    更新は自 CPU の行への addq 1 命令だけ（lock 無し・割込みに対しても安全）
+ *  - 読み出し時に全 CPU 分を合算する
+ *      counter   : 単調増加。合計値
+ *      gauge     : 各 CPU の増減の合計（1 か所で set するなら、その CPU の値）
+ *      histogram : 件数・合計・log2 バケット（i = [2^(i-1), 2^i)、0 は 0 だけ）
+ *  - 書き出し:
+ *      metrics_dump_json() : 1 メトリクス 1 行の JSON（行頭 "KMETRICS "）
+ *      metrics_start_export(): 共有メモリログ（shmlog）のメトリクス表へ周期的に写す
+ *
+ * 使い方:
+ *   METRIC_COUNTER_DEFINE(page_alloc, "page.alloc");   // ファイルスコープ
+ *   METRIC_ADD(page_alloc, n);                          // 更新点
+ * =========================================================== */
+
+#define METRIC_NAME_MAX       24
+#define METRIC_HIST_BUCKETS   24
+#define METRICS_SLOTS_PER_CPU 256           /* u64 単位（64B の倍数にする） */
+
+typedef enum {
+    METRIC_COUNTER   = 0,
+    METRIC_GAUGE     = 1,
+    METRIC_HISTOGRAM = 2,
+} metric_type_t;
+
+/* histogram のスロット配置：count, sum, bucket[0..] */
+#define METRIC_HIST_COUNT   0
+#define METRIC_HIST_SUM     1
+#define METRIC_HIST_BUCKET  2
+#define METRIC_HIST_WIDTH   (METRIC_HIST_BUCKET + METRIC_HIST_BUCKETS)
+
+typedef struct metric {
+    char     name[METRIC_NAME_MAX];
+    uint32_t type;
+    uint32_t base;          /* CPU 行内の先頭スロット。0 は metrics_init 前の捨て場 */
+    int32_t  shm_slot[2];   /* shmlog の表の位置（histogram は count と sum）。-1: 未割当 */
+} __attribute__((aligned(64))) metric_t;   /* 64B：コンパイラの詰め物が入らない大きさにそろえる */
+
+extern metric_t __metrics_start[];
+extern metric_t __metrics_end[];
+extern uint64_t g_metric_slots[MAX_CPUS][METRICS_SLOTS_PER_CPU];
+
+#define METRIC_DEFINE_(ID, NAME, TYPE)                                        \
+    static metric_t __metric_##ID                                             \
+        __attribute__((section(".metrics"), used)) = { NAME, (TYPE), 0, { -1, -1 } }
+
+#define METRIC_COUNTER_DEFINE(ID, NAME)    METRIC_DEFINE_(ID, NAME, METRIC_COUNTER)
+#define METRIC_GAUGE_DEFINE(ID, NAME)      METRIC_DEFINE_(ID, NAME, METRIC_GAUGE)
+#define METRIC_HISTOGRAM_DEFINE(ID, NAME)  METRIC_DEFINE_(ID, NAME, METRIC_HISTOGRAM)
+
+static inline uint64_t* metric_cpu_slot(const metric_t* m, uint32_t off)
+{
+    return &g_metric_slots[this_cpu_id()][m->base + off];
+}
+
+/* 自 CPU の行へ 1 命令で足す（読み出し側とは tear しない 64bit 書き込み） */
+static inline void metric_slot_add(uint64_t* p, uint64_t v)
+{
+    __asm__ __volatile__("addq %1, %0" : "+m"(*p) : "er"(v));
+}
+
+static inline unsigned metric_hist_bucket(uint64_t v)
+{
+    if (!v) return 0;
+    unsigned b = 64u - (unsigned)__builtin_clzll(v);
+    return b < METRIC_HIST_BUCKETS ? b : METRIC_HIST_BUCKETS - 1;
+}
+
+static inline void metric_add(metric_t* m, uint64_t v)
+{
+    metric_slot_add(metric_cpu_slot(m, 0), v);
+}
+
+static inline void metric_set(metric_t* m, uint64_t v)
+{
+    __atomic_store_n(metric_cpu_slot(m, 0), v, __ATOMIC_RELAXED);
+}
+
+static inline void metric_observe(metric_t* m, uint64_t v)
+{
+    uint64_t* s = metric_cpu_slot(m, 0);
+    metric_slot_add(&s[METRIC_HIST_COUNT], 1);
+    metric_slot_add(&s[METRIC_HIST_SUM], v);
+    metric_slot_add(&s[METRIC_HIST_BUCKET + metric_hist_bucket(v)], 1);
+}
+
+#define METRIC_ADD(ID, V)      metric_add(&__metric_##ID, (uint64_t)(V))
+#define METRIC_INC(ID)         metric_add(&__metric_##ID, 1)
+#define METRIC_SUB(ID, V)      metric_add(&__metric_##ID, (uint64_t)0 - (uint64_t)(V))
+#define METRIC_SET(ID, V)      metric_set(&__metric_##ID, (uint64_t)(V))
+#define METRIC_OBSERVE(ID, V)  metric_observe(&__metric_##ID, (uint64_t)(V))
+
+/* 全 CPU を合算した値 */
+typedef struct metric_value {
+    uint64_t value;                         /* counter / gauge */
+    uint64_t count, sum;                    /* histogram */
+    uint64_t buckets[METRIC_HIST_BUCKETS];
+} metric_value_t;
+
+/* スロットを割り当てる（percpu_init_bsp の後・各サブシステムより前に 1 回）。0:ok / -1 */
+int  metrics_init(void);
+
+void metrics_read(const metric_t* m, metric_value_t* out);
+
+/* 全メトリクスを JSON Lines でシリアルへ（"KMETRICS {...}"、最後に "KMETRICS END"） */
+void metrics_dump_json(serial_device_t* dev);
+
+/* 共有メモリログのメトリクス表へ今の値を写す */
+void metrics_publish(void);
+
+/* cpu のタイマで period_ns ごとに metrics_publish() する。0:ok / -1 */
+int  metrics_start_export(uint32_t cpu, uint64_t period_ns);
@@ -2,6 +2,8 @@
 #include "memmap.h"
 #include "bootinfo.h"
 #include "arch/x86/paging.h"
+#include "spinlock.h"
+#include "metrics.h"
 #include <string.h>
 
 /* ========== 設計方針 ==========
@@ -24,6 +26,9 @@ enum { MAPLINE_COUNT    = (int)(FRAME_COUNT / BITS_PER_MAPLINE) };
 /* 4MiB の固定ビットマップ */
 static mapline_t g_bitmap[MAPLINE_COUNT];
 
+/* ビットマップと管理範囲を守る。全 CPU が集中するので MCS（待ち手は各自のノードで回る） */
+static DEFINE_MCS_LOCK(g_page_lock);
+
 /* 管理範囲（フレーム番号） */
 static uint64_t g_frame_begin = 1;   /* 0 は予約 */
 static uint64_t g_frame_end   = 0;   /* 有効な終端（[begin, end)） */
@@ -127,6 +132,9 @@ void page_allocator_release_boot_services_data(const MEMORY_MAP* map)
 {
     if (!map) return;
 
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&g_page_lock, &node);
+
     const uint8_t* p    = (const uint8_t*)map->descriptors;
     const size_t   step = (size_t)map->descriptor_size;
     const size_t   end  = (size_t)map->map_size;
@@ -155,16 +163,21 @@ void page_allocator_release_boot_services_data(const MEMORY_MAP* map)
         /* g_frame_end を必要なら伸ばす（保守的に） */
         if (fN > g_frame_end) g_frame_end = fN;
     }
+
+    mcs_unlock_irqrestore(&g_page_lock, &node, flags);
 }
 
-/* ====== 探索：連続した空きフレームを見つける（先頭から） ====== */
-static int find_run(uint64_t needed, uint64_t align_frames, uint64_t* out_start)
+/* ====== 探索：連続した空きフレームを見つける（先頭から） ======
+ * limit_frame: 探索の終端（[begin, limit) に収まる run だけを返す） */
+static int find_run(uint64_t needed, uint64_t align_frames, uint64_t limit_frame,
+                    uint64_t* out_start)
 {
     if (align_frames == 0) align_frames = 1;
+    if (limit_frame > g_frame_end) limit_frame = g_frame_end;
 
     uint64_t start = (g_frame_begin + align_frames - 1) / align_frames * align_frames;
 
-    while (start + needed <= g_frame_end) {
+    while (start + needed <= limit_frame) {
         uint64_t i = 0;
         for (; i < needed; ++i) {
             if (bm_get(start + i)) break; /* used に当たった */
@@ -182,15 +195,28 @@ static int find_run(uint64_t needed, uint64_t align_frames, uint64_t* out_start)
 
 /* ====== 公開 API ====== */
 
+METRIC_COUNTER_DEFINE(page_alloc, "page.alloc_frames");
+METRIC_COUNTER_DEFINE(page_free,  "page.free_frames");
+METRIC_COUNTER_DEFINE(page_fail,  "page.alloc_fail");
+
 void* page_alloc_bytes(size_t nbytes)
 {
     if (nbytes == 0) return NULL;
 
     uint64_t need_frames = (nbytes + PAGE_SIZE - 1) / PAGE_SIZE;
     uint64_t start;
-    if (!find_run(need_frames, 1, &start)) return NULL;
 
-    mark_range_used(start, need_frames);
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&g_page_lock, &node);
+    int found = find_run(need_frames, 1, g_frame_end, &start);
+    if (found) mark_range_used(start, need_frames);
+    mcs_unlock_irqrestore(&g_page_lock, &node, flags);
+    if (!found) {
+        METRIC_INC(page_fail);
+        return NULL;
+    }
+    METRIC_ADD(page_alloc, need_frames);
+
     uintptr_t phys = frame_to_phys(start);
     return (void*)phys2virt(phys);
 }
@@ -205,10 +231,19 @@ void page_free_bytes(void* ptr, size_t nbytes)
     uint64_t  frames    = (nbytes + PAGE_SIZE - 1) / PAGE_SIZE;
     uint64_t  start_frm = phys_to_frame(virt2phys(vbase));
 
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&g_page_lock, &node);
     mark_range_unused(start_frm, frames);
+    mcs_unlock_irqrestore(&g_page_lock, &node, flags);
+    METRIC_ADD(page_free, frames);
 }
 
 void* page_alloc_pages(size_t num_pages, size_t align_bytes)
+{
+    return page_alloc_pages_below(num_pages, align_bytes, MAX_PHYS_SIZE);
+}
+
+void* page_alloc_pages_below(size_t num_pages, size_t align_bytes, uint64_t phys_limit)
 {
     if (num_pages == 0) return NULL;
 
@@ -218,9 +253,18 @@ void* page_alloc_pages(size_t num_pages, size_t align_bytes)
     }
 
     uint64_t start;
-    if (!find_run(num_pages, align_frames, &start)) return NULL;
 
-    mark_range_used(start, num_pages);
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&g_page_lock, &node);
+    int found = find_run(num_pages, align_frames, phys_to_frame(phys_limit), &start);
+    if (found) mark_range_used(start, num_pages);
+    mcs_unlock_irqrestore(&g_page_lock, &node, flags);
+    if (!found) {
+        METRIC_INC(page_fail);
+        return NULL;
+    }
+    METRIC_ADD(page_alloc, num_pages);
+
     uintptr_t phys = frame_to_phys(start);
     return (void*)phys2virt(phys);
 }
@@ -237,3 +281,45 @@ void page_free_4k(void* ptr)
     /* 4KiB固定サイズとして解放（内部で境界丸め） */
     page_free_bytes(ptr, PAGE_SIZE);
 }
+
+/* ====== 統計 ====== */
+void page_alloc_get_stats(page_alloc_stats_t* out)
+{
+    if (!out) return;
+    uint64_t free = 0, run = 0, best = 0;
+
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&g_page_lock, &node);
+    uint64_t f = g_frame_begin;
+    while (f < g_frame_end) {
+        uint64_t li = f / BITS_PER_MAPLINE;
+        mapline_t line = g_bitmap[li];
+        /* 1 行まるごと範囲内なら行単位で数える */
+        if (f % BITS_PER_MAPLINE == 0 && f + BITS_PER_MAPLINE <= g_frame_end &&
+            (line == 0 || line == ~0ULL)) {
+            if (line == 0) {
+                free += BITS_PER_MAPLINE;
+                run  += BITS_PER_MAPLINE;
+            } else {
+                if (run > best) best = run;
+                run = 0;
+            }
+            f += BITS_PER_MAPLINE;
+            continue;
+        }
+        if (bm_get(f)) {
+            if (run > best) best = run;
+            run = 0;
+        } else {
+            ++free;
+            ++run;
+        }
+        ++f;
+    }
+    if (run > best) best = run;
+    out->managed_frames = (g_frame_end > g_frame_begin) ? g_frame_end - g_frame_begin : 0;
+    mcs_unlock_irqrestore(&g_page_lock, &node, flags);
+
+    out->free_frames      = free;
+    out->largest_free_run = best;
+}
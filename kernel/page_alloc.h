@@ -18,5 +18,16 @@ void  page_free_bytes(void* ptr, size_t nbytes);
 
 /* ページ数とアラインメント（>= PAGE_SIZE）を指定して確保 */
 void* page_alloc_pages(size_t num_pages, size_t align_bytes);
+/* 物理アドレス phys_limit 未満に収まる範囲から確保（AP トランポリン等の低位メモリ用） */
+void* page_alloc_pages_below(size_t num_pages, size_t align_bytes, uint64_t phys_limit);
 void* page_alloc_4k_aligned(void);
 void  page_free_4k(void* ptr);
+
+/* 空き状況（console 等の表示用。ビットマップを数えるので軽くはない） */
+typedef struct page_alloc_stats {
+    uint64_t managed_frames;   /* [begin, end) のフレーム数 */
+    uint64_t free_frames;
+    uint64_t largest_free_run; /* 最長の連続空きフレーム数 */
+} page_alloc_stats_t;
+
+void page_alloc_get_stats(page_alloc_stats_t* out);
@@ -108,6 +108,9 @@ void panic(const char* msg)
     }
     g_panicked = 1;
 
+    /* 溜まっているログを先に出し、以降は同期出力にする */
+    klog_stop_async();
+
     if (msg && *msg) KLOG_ERROR("panic", "%s", msg);
     else             KLOG_ERROR("panic", "(no message)");
 
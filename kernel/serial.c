@@ -1,6 +1,22 @@
 // kernel/serial.c
 #include "serial.h"
 #include "arch_x86_io.h"
+#include "spinlock.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/ioapic.h"
+#include "arch/x86/lapic.h"
+
+/* =========================== 概要 ===========================
+ * 16550 系 UART
+ *  - 初期化で FIFO を有効化し段数を判定（16750 なら 64 段）
+ *  - serial_enable_irq 後は
+ *      送信: TX リングに積み、THR が空いていれば FIFO 段数分まとめて書く。
+ *            残りは THRE 割込みで補充（1 バイトごとに LSR を回さない）
+ *      受信: 割込みで RBR を RX リングへ。serial_read_byte はリングから取る
+ *  - リング満杯時は送信側がポーリングで FIFO を吐かせて進める（割込み禁止中でも進む）
+ *  - panic は serial_force_polled でポーリング送出に戻す
+ * 割込み駆動にできる UART は 1 つだけ（コンソール用）。
+ * =========================================================== */
 
 /* UART レジスタの COM ベースからのオフセット */
 enum {
@@ -15,8 +31,32 @@ enum {
 };
 
 /* LSR bits */
+#define LSR_DR    (1u << 0)  /* Data Ready */
 #define LSR_THRE  (1u << 5)  /* Transmitter Holding Register Empty */
 
+/* IER bits */
+#define IER_RDI   (1u << 0)  /* 受信データ割込み */
+#define IER_THRI  (1u << 1)  /* THR 空き割込み */
+
+/* FCR bits */
+#define FCR_ENABLE     (1u << 0)
+#define FCR_CLEAR_RX   (1u << 1)
+#define FCR_CLEAR_TX   (1u << 2)
+#define FCR_64BYTE     (1u << 5)  /* 16750 のみ（DLAB=1 で書く） */
+#define FCR_TRIG_14    (3u << 6)  /* RX 割込みは 14 バイト溜まってから（+ タイムアウト） */
+
+/* IIR bits */
+#define IIR_NO_INT     (1u << 0)
+#define IIR_FIFO_64    (1u << 5)
+#define IIR_FIFO_MASK  (3u << 6)
+
+/* MCR bits */
+#define MCR_OUT2       (1u << 3)  /* PC 互換機では IRQ 線のゲート */
+
+/* リング（2 の冪） */
+#define TX_RING_SIZE   4096u
+#define RX_RING_SIZE   256u
+
 /* 既定 UART 基準クロック */
 #define UART_CLOCK 115200u
 
@@ -29,6 +69,102 @@ static void serial_write_byte_impl(serial_device_t* dev, uint8_t byte) {
     outb(dev->base + REG_THR_RBR_DLL, byte);
 }
 
+/* ---- 割込み駆動モードの状態（コンソール 1 本分） ---- */
+static serial_device_t* g_irq_dev = 0;
+static DEFINE_SPINLOCK(g_tx_lock);       /* TX リング + THR への書き込み */
+static DEFINE_SPINLOCK(g_rx_lock);
+static uint8_t  g_tx_ring[TX_RING_SIZE];
+static uint32_t g_tx_head, g_tx_tail;    /* head: 次に積む位置 / tail: 次に送る位置 */
+static uint8_t  g_rx_ring[RX_RING_SIZE];
+static uint32_t g_rx_head, g_rx_tail;
+static uint8_t  g_ier;                   /* IER のシャドウ（g_tx_lock 下で更新） */
+static serial_stats_t g_stats;
+static void (*volatile g_rx_notify)(void) = 0;
+
+/* THR が空いていれば FIFO 段数分をリングから書く（g_tx_lock 下） */
+static void tx_fill_locked(serial_device_t* dev) {
+    if ((inb(dev->base + REG_LSR) & LSR_THRE) == 0) return;
+
+    uint32_t n = 0;
+    while (n < dev->fifo_depth && g_tx_tail != g_tx_head) {
+        outb(dev->base + REG_THR_RBR_DLL, g_tx_ring[g_tx_tail & (TX_RING_SIZE - 1)]);
+        ++g_tx_tail;
+        ++n;
+    }
+
+    /* 残りがある間だけ THRE 割込みを有効にする */
+    uint8_t ier = (g_tx_tail != g_tx_head) ? (g_ier | IER_THRI) : (uint8_t)(g_ier & ~IER_THRI);
+    if (ier != g_ier) {
+        g_ier = ier;
+        outb(dev->base + REG_IER_DLM, ier);
+    }
+}
+
+/* リング満杯：THR が空くのを待って吐かせる（g_tx_lock 下） */
+static void tx_wait_room_locked(serial_device_t* dev) {
+    ++g_stats.tx_ring_full;
+    while (g_tx_head - g_tx_tail >= TX_RING_SIZE) {
+        while ((inb(dev->base + REG_LSR) & LSR_THRE) == 0)
+            cpu_relax();
+        tx_fill_locked(dev);
+    }
+}
+
+static void serial_write_byte_irq(serial_device_t* dev, uint8_t byte) {
+    serial_write_buf(dev, (const char*)&byte, 1);
+}
+
+static int serial_read_byte_irq(serial_device_t* dev) {
+    (void)dev;
+    int c = -1;
+    uint64_t flags = spin_lock_irqsave(&g_rx_lock);
+    if (g_rx_tail != g_rx_head) {
+        c = g_rx_ring[g_rx_tail & (RX_RING_SIZE - 1)];
+        ++g_rx_tail;
+    }
+    spin_unlock_irqrestore(&g_rx_lock, flags);
+    return c;
+}
+
+static int serial_read_byte_polled(serial_device_t* dev) {
+    if ((inb(dev->base + REG_LSR) & LSR_DR) == 0) return -1;
+    return inb(dev->base + REG_THR_RBR_DLL);
+}
+
+static void serial_irq(intr_context_t* ctx) {
+    (void)ctx;
+    serial_device_t* dev = g_irq_dev;
+
+    /* 受信：FIFO が空になるまで吸い出す */
+    int got = 0;
+    spin_lock(&g_rx_lock);
+    while (inb(dev->base + REG_LSR) & LSR_DR) {
+        uint8_t b = inb(dev->base + REG_THR_RBR_DLL);
+        if (g_rx_head - g_rx_tail < RX_RING_SIZE) {
+            g_rx_ring[g_rx_head & (RX_RING_SIZE - 1)] = b;
+            ++g_rx_head;
+            ++g_stats.rx_bytes;
+            got = 1;
+        } else {
+            ++g_stats.rx_dropped;
+        }
+    }
+    spin_unlock(&g_rx_lock);
+
+    /* 送信：FIFO を補充 */
+    spin_lock(&g_tx_lock);
+    if (g_tx_tail != g_tx_head) ++g_stats.tx_irqs;
+    tx_fill_locked(dev);
+    spin_unlock(&g_tx_lock);
+
+    /* IIR を読んで残りの要因（MSR/LSR 変化）を落とす */
+    (void)inb(dev->base + REG_IIR_FCR);
+    lapic_eoi();
+
+    void (*notify)(void) = g_rx_notify;
+    if (got && notify) notify();
+}
+
 void serial_init(serial_device_t* dev, serial_port_t port, uint32_t baud) {
     if (!dev) return;
     if (baud == 0) baud = UART_CLOCK; /* 既定: 115200 */
@@ -42,8 +178,18 @@ void serial_init(serial_device_t* dev, serial_port_t port, uint32_t baud) {
     /* 2) 割込みは使わない（ポーリング） */
     outb(dev->base + REG_IER_DLM, 0x00);
 
-    /* 3) FIFO は無効化（最小構成） */
-    outb(dev->base + REG_IIR_FCR, 0x00);
+    /* 3) FIFO を有効化してクリア。64 段の許可ビットは DLAB=1 でないと書けない（16750） */
+    outb(dev->base + REG_LCR, 0x83);
+    outb(dev->base + REG_IIR_FCR, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX | FCR_64BYTE | FCR_TRIG_14);
+    outb(dev->base + REG_LCR, 0x03);
+    uint8_t iir = inb(dev->base + REG_IIR_FCR);
+    if ((iir & IIR_FIFO_MASK) != IIR_FIFO_MASK) {
+        dev->fifo_depth = 1;                      /* 16450 など FIFO 無し */
+        outb(dev->base + REG_IIR_FCR, 0x00);
+    } else {
+        dev->fifo_depth = (iir & IIR_FIFO_64) ? 64 : 16;
+    }
+    dev->irq_mode = 0;
 
     /* 4) ボーレート設定: divisor = 115200 / baud */
     uint32_t divisor = UART_CLOCK / baud;
@@ -58,7 +204,7 @@ void serial_init(serial_device_t* dev, serial_port_t port, uint32_t baud) {
 
     /* デフォルトの関数実体をバインド */
     dev->write_byte = serial_write_byte_impl;
-    dev->read_byte  = 0; /* 未実装 */
+    dev->read_byte  = serial_read_byte_polled;
 }
 
 void serial_write_byte(serial_device_t* dev, uint8_t byte) {
@@ -81,3 +227,75 @@ void serial_writeln(serial_device_t* dev, const char* s) {
     serial_write(dev, s);
     serial_write(dev, "\r\n");
 }
+
+void serial_write_buf(serial_device_t* dev, const char* buf, uint32_t len) {
+    if (!dev || !buf) return;
+    if (!dev->irq_mode) {
+        for (uint32_t i = 0; i < len; ++i) serial_write_byte(dev, (uint8_t)buf[i]);
+        return;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&g_tx_lock);
+    for (uint32_t i = 0; i < len; ++i) {
+        if (g_tx_head - g_tx_tail >= TX_RING_SIZE) tx_wait_room_locked(dev);
+        g_tx_ring[g_tx_head & (TX_RING_SIZE - 1)] = (uint8_t)buf[i];
+        ++g_tx_head;
+    }
+    g_stats.tx_bytes += len;
+    tx_fill_locked(dev);
+    spin_unlock_irqrestore(&g_tx_lock, flags);
+}
+
+int serial_read_byte(serial_device_t* dev) {
+    if (!dev || !dev->read_byte) return -1;
+    return dev->read_byte(dev);
+}
+
+int serial_enable_irq(serial_device_t* dev, uint8_t isa_irq, uint32_t dest_apic) {
+    if (!dev || g_irq_dev) return -1;
+
+    int vec = intr_alloc_vector(serial_irq);
+    if (vec < 0) return -1;
+    if (ioapic_route_isa_irq(isa_irq, (uint8_t)vec, dest_apic) != 0) {
+        intr_free_vector(vec);
+        return -1;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&g_tx_lock);
+    g_irq_dev       = dev;
+    dev->write_byte = serial_write_byte_irq;
+    dev->read_byte  = serial_read_byte_irq;
+    dev->irq_mode   = 1;
+    outb(dev->base + REG_MCR, 0x03 | MCR_OUT2);
+    g_ier = IER_RDI;
+    outb(dev->base + REG_IER_DLM, g_ier);
+    spin_unlock_irqrestore(&g_tx_lock, flags);
+
+    ioapic_unmask(ioapic_isa_to_gsi(isa_irq, 0));
+    return vec;
+}
+
+void serial_force_polled(serial_device_t* dev) {
+    if (!dev || !dev->irq_mode) return;
+
+    outb(dev->base + REG_IER_DLM, 0x00);
+    dev->irq_mode = 0;
+
+    /* 他 CPU が g_tx_lock を持ったまま止まっていても構わず吐く */
+    while (g_tx_tail != g_tx_head) {
+        serial_write_byte_impl(dev, g_tx_ring[g_tx_tail & (TX_RING_SIZE - 1)]);
+        ++g_tx_tail;
+    }
+    dev->write_byte = serial_write_byte_impl;
+    dev->read_byte  = serial_read_byte_polled;
+}
+
+void serial_set_rx_notify(serial_device_t* dev, void (*fn)(void)) {
+    (void)dev;   /* 割込みモードの UART は 1 台だけ */
+    g_rx_notify = fn;
+}
+
+void serial_get_stats(serial_stats_t* out) {
+    if (!out) return;
+    *out = g_stats;
+}
@@ -17,11 +17,23 @@ typedef enum {
 typedef struct serial_device {
     uint16_t      base;      /* I/O base port */
     uint32_t      baud;      /* 設定済みボーレート */
+    uint16_t      fifo_depth;/* 送信 FIFO 段数（16450:1 / 16550:16 / 16750:64） */
+    uint8_t       irq_mode;  /* 1: 送受信をリング + 割込みで行う */
+    uint8_t       rsv;
     /* 必要なら関数ポインタで差し替え可能 */
     void (*write_byte)(struct serial_device*, uint8_t);
-    int  (*read_byte)(struct serial_device*); /* 未実装なら負値 */
+    int  (*read_byte)(struct serial_device*); /* 受信データ無しなら負値 */
 } serial_device_t;
 
+/* 送受信統計（serial_get_stats） */
+typedef struct serial_stats {
+    uint64_t tx_bytes;
+    uint64_t tx_irqs;        /* THRE 割込みで FIFO を詰めた回数 */
+    uint64_t tx_ring_full;   /* リング満杯でポーリングに落ちた回数 */
+    uint64_t rx_bytes;
+    uint64_t rx_dropped;     /* RX リング満杯で捨てたバイト数 */
+} serial_stats_t;
+
 /* 初期化：8N1 / 指定ボーレート（既定 115200） */
 void serial_init(serial_device_t* dev, serial_port_t port, uint32_t baud);
 
@@ -34,6 +46,27 @@ void serial_write(serial_device_t* dev, const char* s);
 /* 換行付きの簡易出力 */
 void serial_writeln(serial_device_t* dev, const char* s);
 
+/* len バイトをそのまま送出（割込みモードではリングへの投入をまとめて行う） */
+void serial_write_buf(serial_device_t* dev, const char* buf, uint32_t len);
+
+/* 1 バイト受信。データが無ければ -1（待たない） */
+int  serial_read_byte(serial_device_t* dev);
+
+/* 割込み駆動に切り替える：ISA IRQ を IOAPIC 経由で dest_apic へ route し、
+ * 送信は TX リング + THRE 割込み、受信は RX リングで行う。
+ * 成功でベクタ番号、IOAPIC が無い等で -1（ポーリングのまま） */
+int  serial_enable_irq(serial_device_t* dev, uint8_t isa_irq, uint32_t dest_apic);
+
+/* panic 用：割込みを止め、TX リングの残りをポーリングで吐いてから
+ * 以降をポーリング送出に戻す（ロックは取らない） */
+void serial_force_polled(serial_device_t* dev);
+
+void serial_get_stats(serial_stats_t* out);
+
+/* 割込みモードで受信があった時に ISR の最後から呼ぶ（IF=0・短く済ませること。
+ * 重い処理は queue_work 等で後ろへ回す）。NULL で解除 */
+void serial_set_rx_notify(serial_device_t* dev, void (*fn)(void));
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,211 @@
+#include "shmlog.h"
+#include "log.h"
+#include "spinlock.h"
+#include "arch/x86/pci.h"
+#include "arch/x86/paging.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/tsc.h"
+#include "common.h"
+
+#define SHMLOG_SIZE        (SHMLOG_HEADER_SIZE + MAX_CPUS * SHMLOG_SECTION_SIZE)
+#define SECTION_DATA       (SHMLOG_SECTION_SIZE - SHMLOG_SECTION_HDR)
+
+#define IVSHMEM_VENDOR     0x1af4
+#define IVSHMEM_DEVICE     0x1110
+#define IVSHMEM_BAR_SHMEM  2
+
+/* ivshmem が無い時の置き場（カーネル像は物理的に連続なので .bss でもそのまま連続） */
+static uint8_t g_shmlog_area[SHMLOG_SIZE] __attribute__((aligned(4096)));
+
+static volatile uint8_t* g_base = 0;
+static uint64_t          g_phys = 0;
+static uint32_t          g_nsec = 0;
+static DEFINE_SPINLOCK(g_metric_lock);
+
+static inline shmlog_header_t* hdr(void) { return (shmlog_header_t*)g_base; }
+
+static inline shmlog_section_t* section(uint32_t i)
+{
+    return (shmlog_section_t*)(g_base + SHMLOG_HEADER_SIZE + (uint64_t)i * SHMLOG_SECTION_SIZE);
+}
+
+static inline shmlog_metric_t* metrics(void)
+{
+    return (shmlog_metric_t*)(g_base + SHMLOG_METRICS_OFF);
+}
+
+/* ---- ivshmem 探索 ---- */
+typedef struct ivshmem_find {
+    int      found;
+    uint64_t phys;
+    uint64_t size;
+} ivshmem_find_t;
+
+static void ivshmem_probe(pci_addr_t a, uint16_t vendor, uint16_t device,
+                          uint32_t class_rev, void* ctx)
+{
+    (void)class_rev;
+    ivshmem_find_t* f = (ivshmem_find_t*)ctx;
+    if (f->found || vendor != IVSHMEM_VENDOR || device != IVSHMEM_DEVICE) return;
+
+    uint8_t  off = (uint8_t)(PCI_BAR0 + IVSHMEM_BAR_SHMEM * 4);
+    uint32_t lo  = pci_read32(a, off);
+    if (lo & 1) return;                                  /* I/O BAR は対象外 */
+    int is64 = (((lo >> 1) & 0x3) == 0x2);
+    uint32_t hi = is64 ? pci_read32(a, (uint8_t)(off + 4)) : 0;
+
+    /* BAR のサイズ（全 1 を書いて戻す）。その間はメモリデコードを止める */
+    uint16_t cmd = pci_read16(a, PCI_COMMAND);
+    pci_write16(a, PCI_COMMAND, (uint16_t)(cmd & ~0x2u));
+    pci_write32(a, off, 0xFFFFFFFFu);
+    uint64_t mask = pci_read32(a, off) & ~0xFULL;
+    pci_write32(a, off, lo);
+    if (is64) {
+        pci_write32(a, (uint8_t)(off + 4), 0xFFFFFFFFu);
+        mask |= (uint64_t)pci_read32(a, (uint8_t)(off + 4)) << 32;
+        pci_write32(a, (uint8_t)(off + 4), hi);
+    } else {
+        mask |= 0xFFFFFFFF00000000ULL;
+    }
+    pci_write16(a, PCI_COMMAND, (uint16_t)(cmd | 0x2u));
+
+    uint64_t phys = (lo & ~0xFULL) | ((uint64_t)hi << 32);
+    if (!phys || !mask) return;
+    f->found = 1;
+    f->phys  = phys;
+    f->size  = ~mask + 1;
+}
+
+/* ---- klog シンク ---- */
+/* リングの head から n バイト写す。折り返しは memcpy 2 回（剰余は 1 回だけ） */
+static void ring_copy(uint8_t* data, uint64_t head, const char* src, uint32_t n)
+{
+    if (n > SECTION_DATA) {                              /* 入りきらない分は古い側を捨てる */
+        src  += n - SECTION_DATA;
+        head += n - SECTION_DATA;
+        n     = SECTION_DATA;
+    }
+    uint32_t off   = (uint32_t)(head % SECTION_DATA);
+    uint32_t first = (n < SECTION_DATA - off) ? n : SECTION_DATA - off;
+    memcpy(data + off, src, first);
+    if (first < n) memcpy(data, src + first, n - first);
+}
+
+static void section_append(uint32_t cpu, const char* buf, uint32_t len)
+{
+    /* "\r\n" は "\n" に詰める（読み手で行に割るだけにする）。'\r' の間を塊で写す */
+    shmlog_section_t* s = section(cpu);
+    uint8_t* data = (uint8_t*)s + SHMLOG_SECTION_HDR;
+    uint64_t head = s->head;
+    while (len) {
+        uint32_t n = 0;
+        while (n < len && buf[n] != '\r') ++n;
+        ring_copy(data, head, buf, n);
+        head += n;
+        if (n < len) ++n;                                /* '\r' を飛ばす */
+        buf += n;
+        len -= n;
+    }
+    __atomic_store_n(&s->head, head, __ATOMIC_RELEASE);
+}
+
+static void shmlog_sink_write(klog_sink_t* sink, const char* buf, uint32_t len)
+{
+    (void)sink;
+    uint32_t cpu = klog_sink_cpu();
+    if (cpu >= g_nsec) cpu = 0;
+    section_append(cpu, buf, len);
+    section(cpu)->lines++;
+    __atomic_add_fetch(&hdr()->write_seq, 1, __ATOMIC_RELEASE);
+}
+
+static klog_sink_t g_shmlog_sink = { "shmlog", shmlog_sink_write, NULL };
+
+int shmlog_init(void)
+{
+    if (g_base) return 0;
+
+    ivshmem_find_t f = { 0, 0, 0 };
+    pci_enumerate(ivshmem_probe, &f);
+
+    uint64_t size;
+    const char* where;
+    if (f.found && f.size >= SHMLOG_HEADER_SIZE + SHMLOG_SECTION_SIZE) {
+        g_base = (volatile uint8_t*)(uintptr_t)phys2virt(f.phys);
+        g_phys = f.phys;
+        size   = (f.size < SHMLOG_SIZE) ? f.size : SHMLOG_SIZE;
+        where  = "ivshmem";
+    } else {
+        g_base = g_shmlog_area;
+        g_phys = virt2phys((uint64_t)(uintptr_t)g_shmlog_area);
+        size   = SHMLOG_SIZE;
+        where  = "kernel bss";
+    }
+    g_nsec = (uint32_t)((size - SHMLOG_HEADER_SIZE) / SHMLOG_SECTION_SIZE);
+    if (g_nsec > MAX_CPUS) g_nsec = MAX_CPUS;
+
+    for (uint64_t i = 0; i < SHMLOG_HEADER_SIZE + (uint64_t)g_nsec * SHMLOG_SECTION_SIZE; ++i) {
+        g_base[i] = 0;
+    }
+
+    shmlog_header_t* h = hdr();
+    h->version       = SHMLOG_VERSION;
+    h->header_size   = SHMLOG_HEADER_SIZE;
+    h->total_size    = SHMLOG_HEADER_SIZE + (uint64_t)g_nsec * SHMLOG_SECTION_SIZE;
+    h->nr_sections   = g_nsec;
+    h->section_size  = SHMLOG_SECTION_SIZE;
+    h->tsc_hz        = tsc_hz();
+    h->phys_base     = g_phys;
+    h->metrics_off   = SHMLOG_METRICS_OFF;
+    h->metrics_count = 0;
+    /* magic は最後（読み手が半端なヘッダを掴まないように） */
+    __atomic_store_n(&h->magic, SHMLOG_MAGIC, __ATOMIC_RELEASE);
+
+    /* 登録前のログ（メモリリングに残っている分）を CPU0 のセクションへ写す */
+    char buf[256];
+    uint64_t pos = 0;
+    uint32_t n;
+    while ((n = klog_mem_read(&pos, buf, sizeof(buf))) != 0) section_append(0, buf, n);
+
+    if (klog_add_sink(&g_shmlog_sink) != 0) return -1;
+    KLOG_INFO("shmlog", "region at phys 0x%llx (%llu KiB, %u sections, %s)",
+              (unsigned long long)g_phys, (unsigned long long)(h->total_size >> 10), g_nsec, where);
+    return 0;
+}
+
+uint64_t shmlog_phys_base(void) { return g_phys; }
+
+int shmlog_metric_slot(const char* name)
+{
+    if (!g_base || !name) return -1;
+    shmlog_header_t* h = hdr();
+    shmlog_metric_t* m = metrics();
+    int slot = -1;
+
+    uint64_t flags = spin_lock_irqsave(&g_metric_lock);
+    for (uint32_t i = 0; i < h->metrics_count; ++i) {
+        int same = 1;
+        for (int k = 0; k < SHMLOG_METRIC_NAME; ++k) {
+            if (m[i].name[k] != name[k]) { same = 0; break; }
+            if (!name[k]) break;
+        }
+        if (same) { slot = (int)i; break; }
+    }
+    if (slot < 0 && h->metrics_count < SHMLOG_METRICS_MAX) {
+        uint32_t i = h->metrics_count;
+        int k = 0;
+        for (; k < SHMLOG_METRIC_NAME - 1 && name[k]; ++k) m[i].name[k] = name[k];
+        m[i].name[k] = '\0';
+        m[i].value = 0;
+        __atomic_store_n(&h->metrics_count, i + 1, __ATOMIC_RELEASE);
+        slot = (int)i;
+    }
+    spin_unlock_irqrestore(&g_metric_lock, flags);
+    return slot;
+}
+
+void shmlog_metric_set(int slot, uint64_t value)
+{
+    if (!g_base || slot < 0 || slot >= SHMLOG_METRICS_MAX) return;
+    __atomic_store_n(&metrics()[slot].value, value, __ATOMIC_RELAXED);
+}
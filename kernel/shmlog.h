@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * 共有メモリログ（UART を使わずに外から読めるログ + メトリクス）
+ *  - 物理的に連続した領域を 1 つ持つ。ivshmem（PCI 1af4:1110）の BAR2 が
+ *    あればそこ、無ければカーネル .bss 内の固定領域（pmemsave / ダンプで読む）
+ *  - 先頭 4KiB がヘッダ（magic "SHMLOG01"・CPU セクション配置・メトリクス表）、
+ *    以降が CPU ごとのセクション（行テキストのバイトリング）
+ *  - klog のシンクとして登録するので、行はその行を記録した CPU のセクションへ入る
+ *  - 読み出しは tools/shmlog_read.py（magic を探すので開始物理アドレスは問わない）
+ * =========================================================== */
+
+#define SHMLOG_MAGIC          0x3130474F4C4D4853ULL     /* "SHMLOG01"（LE） */
+#define SHMLOG_VERSION        1
+#define SHMLOG_HEADER_SIZE    4096u
+#define SHMLOG_SECTION_SIZE   8192u                      /* CPU あたり（2 の冪） */
+#define SHMLOG_SECTION_HDR    64u
+#define SHMLOG_METRICS_OFF    1024u
+#define SHMLOG_METRICS_MAX    64
+#define SHMLOG_METRIC_NAME    24
+
+typedef struct shmlog_header {
+    uint64_t          magic;
+    uint32_t          version;
+    uint32_t          header_size;
+    uint64_t          total_size;
+    uint32_t          nr_sections;
+    uint32_t          section_size;
+    uint64_t          tsc_hz;
+    uint64_t          phys_base;
+    volatile uint64_t write_seq;       /* 全セクション合計の書き込み行数（更新検出用） */
+    uint32_t          metrics_off;
+    uint32_t          metrics_count;   /* 登録済みスロット数 */
+} shmlog_header_t;
+
+/* 各セクションの先頭 64B。data は head を法としたバイトリング */
+typedef struct shmlog_section {
+    volatile uint64_t head;            /* 書いた総バイト数 */
+    volatile uint64_t lines;
+    uint8_t           pad[SHMLOG_SECTION_HDR - 16];
+} shmlog_section_t;
+
+typedef struct shmlog_metric {
+    char              name[SHMLOG_METRIC_NAME];
+    volatile uint64_t value;
+} shmlog_metric_t;
+
+/* 領域を決めてヘッダを書き、klog のシンクに登録する。
+ * paging_reconstruct_and_mark 後（Direct Map で BAR を触るため）。0:ok / -1 */
+int shmlog_init(void);
+
+/* 物理アドレス（未初期化なら 0） */
+uint64_t shmlog_phys_base(void);
+
+/* メトリクスのスロットを name で確保（同名があればそれを返す）。満杯/未初期化で -1 */
+int  shmlog_metric_slot(const char* name);
+void shmlog_metric_set(int slot, uint64_t value);
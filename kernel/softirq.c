@@ -0,0 +1,143 @@
+#include "softirq.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/arch_x86_low.h"
+#include "log.h"
+
+static void tasklet_action(void);
+
+/* tasklet は最初から登録済み。他は softirq_register で */
+static softirq_fn_t g_softirq_fn[SOFTIRQ_NR_MAX] = {
+    [SOFTIRQ_TASKLET] = tasklet_action,
+};
+
+/* CPU ごとの統計（自 CPU しか書かないのでロック不要） */
+typedef struct softirq_stat {
+    uint64_t runs[SOFTIRQ_NR_MAX];
+    uint64_t max_cycles[SOFTIRQ_NR_MAX];
+    uint64_t deferred;                    /* 出口で回し切れず idle へ持ち越した回数 */
+} __attribute__((aligned(64))) softirq_stat_t;
+
+static softirq_stat_t g_stat[MAX_CPUS];
+
+/* 自 CPU の tasklet リスト（IF=0 でしか触らない） */
+static tasklet_t* g_tasklets[MAX_CPUS];
+
+void softirq_register(enum softirq_nr nr, softirq_fn_t fn)
+{
+    if ((unsigned)nr >= SOFTIRQ_NR_MAX) return;
+    __atomic_store_n(&g_softirq_fn[nr], fn, __ATOMIC_RELEASE);
+}
+
+void raise_softirq(enum softirq_nr nr)
+{
+    if ((unsigned)nr >= SOFTIRQ_NR_MAX) return;
+    __atomic_or_fetch(&this_cpu()->softirq_pending, 1u << nr, __ATOMIC_RELAXED);
+}
+
+int softirq_has_pending(void)
+{
+    return __atomic_load_n(&this_cpu()->softirq_pending, __ATOMIC_RELAXED) != 0;
+}
+
+/* IF=0 で入り IF=0 で戻る。ハンドラ本体は IF=1 で走らせる */
+static void softirq_run(percpu_t* c)
+{
+    softirq_stat_t* st = &g_stat[c->cpu_id];
+    c->softirq_active = 1;
+
+    for (int restart = 0; restart < SOFTIRQ_MAX_RESTART; ++restart) {
+        uint32_t pend = __atomic_exchange_n(&c->softirq_pending, 0, __ATOMIC_ACQ_REL);
+        if (!pend) break;
+
+        __asm__ __volatile__("sti" ::: "memory");
+        while (pend) {
+            unsigned nr = (unsigned)__builtin_ctz(pend);
+            pend &= pend - 1;
+
+            softirq_fn_t fn = __atomic_load_n(&g_softirq_fn[nr], __ATOMIC_ACQUIRE);
+            if (!fn) continue;
+
+            uint64_t t0 = rdtsc();
+            fn();
+            uint64_t dt = rdtsc() - t0;
+            st->runs[nr]++;
+            if (dt > st->max_cycles[nr]) st->max_cycles[nr] = dt;
+        }
+        __asm__ __volatile__("cli" ::: "memory");
+    }
+
+    if (c->softirq_pending) st->deferred++;
+    c->softirq_active = 0;
+}
+
+void softirq_irq_exit(int interrupted_if)
+{
+    percpu_t* c = this_cpu();
+    if (!interrupted_if || c->softirq_active || !c->softirq_pending) return;
+    softirq_run(c);
+}
+
+void softirq_run_pending(void)
+{
+    percpu_t* c = this_cpu();
+    if (c->softirq_active || !c->softirq_pending) return;
+    softirq_run(c);
+}
+
+/* ---- tasklet ---- */
+
+void tasklet_schedule(tasklet_t* t)
+{
+    if (!t || !t->fn) return;
+    if (__atomic_exchange_n(&t->scheduled, 1, __ATOMIC_ACQ_REL)) return;   /* 既に予約済み */
+
+    uint64_t flags = irq_save();
+    uint32_t id = this_cpu_id();
+    t->next = g_tasklets[id];
+    g_tasklets[id] = t;
+    raise_softirq(SOFTIRQ_TASKLET);
+    irq_restore(flags);
+}
+
+static void tasklet_action(void)
+{
+    uint64_t flags = irq_save();
+    uint32_t id = this_cpu_id();
+    tasklet_t* list = g_tasklets[id];
+    g_tasklets[id] = NULL;
+    irq_restore(flags);
+
+    /* LIFO で積まれているので反転して予約順に */
+    tasklet_t* fifo = NULL;
+    while (list) {
+        tasklet_t* next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+    while (fifo) {
+        tasklet_t* next = fifo->next;
+        __atomic_store_n(&fifo->scheduled, 0, __ATOMIC_RELEASE);   /* fn 内からの再予約を許す */
+        fifo->fn(fifo->arg);
+        fifo = next;
+    }
+}
+
+void softirq_dump_stats(void)
+{
+    static const char* const names[SOFTIRQ_NR_MAX] = {
+        [SOFTIRQ_TIMER] = "timer", [SOFTIRQ_TASKLET] = "tasklet",
+    };
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) {
+        const softirq_stat_t* st = &g_stat[cpu];
+        for (int nr = 0; nr < SOFTIRQ_NR_MAX; ++nr) {
+            if (!st->runs[nr]) continue;
+            KLOG_INFO("softirq", "cpu%u %s: runs=%llu max=%llu cycles", cpu,
+                      names[nr] ? names[nr] : "?",
+                      (unsigned long long)st->runs[nr], (unsigned long long)st->max_cycles[nr]);
+        }
+        if (st->deferred) {
+            KLOG_INFO("softirq", "cpu%u deferred to idle: %llu", cpu, (unsigned long long)st->deferred);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * softirq（割込みの後半処理）と tasklet
+ *  - ハードウェア割込みハンドラは raise_softirq() で印を付けて即座に戻る
+ *  - 共通 ISR の出口（割込まれた側が IF=1 のとき）で、割込み許可状態のまま
+ *    保留分を実行する。1 回の出口で回すのは最大 SOFTIRQ_MAX_RESTART 巡まで
+ *  - 残った分（や高速経路で立った分）は idle ループが拾う
+ *  - すべて CPU ローカル。立てた CPU で実行される
+ * =========================================================== */
+
+enum softirq_nr {
+    SOFTIRQ_TIMER   = 0,
+    SOFTIRQ_TASKLET = 1,
+    SOFTIRQ_NR_MAX  = 8,
+};
+
+#define SOFTIRQ_MAX_RESTART  4
+
+typedef void (*softirq_fn_t)(void);
+
+/* nr の処理関数を登録（起動時に 1 回） */
+void softirq_register(enum softirq_nr nr, softirq_fn_t fn);
+
+/* 自 CPU に nr の実行を要求する（割込みハンドラから呼ぶ想定。IF は問わない） */
+void raise_softirq(enum softirq_nr nr);
+
+/* 共通 ISR の出口から呼ぶ（IF=0 で入り IF=0 で戻る）。
+ * interrupted_if: 割込まれた文脈が IF=1 だったか（IF=0 の区間は割込まない） */
+void softirq_irq_exit(int interrupted_if);
+
+/* 保留分を実行する（idle ループ用。IF=0 で呼ぶ） */
+void softirq_run_pending(void);
+
+/* 自 CPU に保留があるか */
+int softirq_has_pending(void);
+
+/* ---- tasklet ----
+ * 自 CPU の SOFTIRQ_TASKLET で 1 回だけ走る軽量な後半処理。
+ * 実行前に再スケジュールされても 1 回にまとまる */
+typedef struct tasklet {
+    struct tasklet*   next;
+    void            (*fn)(void* arg);
+    void*             arg;
+    volatile uint32_t scheduled;
+} tasklet_t;
+
+#define TASKLET_INIT(f, a)  { NULL, (f), (a), 0 }
+
+void tasklet_schedule(tasklet_t* t);
+
+/* 種類ごとの実行回数・最大実行サイクル・idle へ持ち越した回数を KLOG に出す */
+void softirq_dump_stats(void);
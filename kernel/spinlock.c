@@ -0,0 +1,89 @@
+#include "spinlock.h"
+#include "log.h"
+
+/* ---- MCS ----
+ * tail に自分のノードを xchg で繋ぎ、前任者がいればその next に自分を書いて
+ * 自分の locked だけを見て待つ（待ち手ごとに別キャッシュライン）。 */
+void mcs_lock(mcs_lock_t* l, mcs_node_t* me)
+{
+    me->next   = NULL;
+    me->locked = 1;
+
+    mcs_node_t* prev = __atomic_exchange_n(&l->tail, me, __ATOMIC_ACQ_REL);
+    int contended = (prev != NULL);
+    if (prev) {
+        __atomic_store_n(&prev->next, me, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&me->locked, __ATOMIC_ACQUIRE)) cpu_relax();
+    }
+    LOCKSTAT_ACQUIRED(l, contended);
+}
+
+void mcs_unlock(mcs_lock_t* l, mcs_node_t* me)
+{
+    LOCKSTAT_RELEASE(l);
+
+    mcs_node_t* succ = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE);
+    if (!succ) {
+        /* 後続がいなければ tail を空に戻して終わり */
+        mcs_node_t* expected = me;
+        if (__atomic_compare_exchange_n(&l->tail, &expected, NULL, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        /* xchg 済みで next をまだ書いていない後続を待つ */
+        while (!(succ = __atomic_load_n(&me->next, __ATOMIC_ACQUIRE))) cpu_relax();
+    }
+    __atomic_store_n(&succ->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* ---- lock-stat ---- */
+#ifdef LOCK_STAT
+
+static lock_stat_t* volatile g_lockstat_head = NULL;
+
+/* 統計は保持中にしか触らないので、ロック自身が排他を保証する */
+void lockstat_on_acquire(lock_stat_t* s, int contended)
+{
+    if (!__atomic_load_n(&s->registered, __ATOMIC_ACQUIRE)) {
+        uint32_t zero = 0;
+        if (__atomic_compare_exchange_n(&s->registered, &zero, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            lock_stat_t* head = __atomic_load_n(&g_lockstat_head, __ATOMIC_RELAXED);
+            do {
+                s->next = head;
+            } while (!__atomic_compare_exchange_n(&g_lockstat_head, &head, s, 0,
+                                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        }
+    }
+
+    s->acquired++;
+    if (contended) s->contended++;
+    s->hold_start = rdtsc();
+}
+
+void lockstat_on_release(lock_stat_t* s)
+{
+    uint64_t held = rdtsc() - s->hold_start;
+    if (held > s->max_hold_cycles) s->max_hold_cycles = held;
+}
+
+void lockstat_dump(void)
+{
+    KLOG_INFO("lockstat", "    acquired    contended  max_hold_cyc  class");
+    for (lock_stat_t* s = __atomic_load_n(&g_lockstat_head, __ATOMIC_ACQUIRE); s; s = s->next) {
+        KLOG_INFO("lockstat", "%12llu %12llu %13llu  %s",
+                  (unsigned long long)s->acquired,
+                  (unsigned long long)s->contended,
+                  (unsigned long long)s->max_hold_cycles,
+                  s->name ? s->name : "(anon)");
+    }
+}
+
+#else
+
+void lockstat_dump(void)
+{
+    KLOG_INFO("lockstat", "lock statistics disabled (build with LOCK_STAT=1)");
+}
+
+#endif
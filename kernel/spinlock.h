@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+
+/* =========================== 概要 ===========================
+ * スピンロック
+ *  - spinlock_t : チケットロック（FIFO 公平・1 キャッシュラインで完結）
+ *  - mcs_lock_t : MCS キューロック（待ち手は自分のノードだけを回る。
+ *                 競合の激しいロック向け。ノードは呼び出し側のスタックに置く）
+ *  - *_irqsave  : 割込みを禁止して取る版（割込みハンドラとも共有するロック用）
+ *
+ * -DLOCK_STAT（make LOCK_STAT=1）でロックごとに
+ *   取得回数・競合回数・最大保持時間（TSC サイクル）を記録し、
+ *   lockstat_dump() で一覧できる。無効時はフィールドもコードも消える。
+ * =========================================================== */
+
+/* ---- lock-stat ---- */
+#ifdef LOCK_STAT
+typedef struct lock_stat {
+    const char*        name;
+    uint64_t           acquired;
+    uint64_t           contended;
+    uint64_t           max_hold_cycles;
+    uint64_t           hold_start;       /* 保持中のみ有効 */
+    struct lock_stat*  next;             /* 登録リスト */
+    uint32_t           registered;
+} lock_stat_t;
+
+void lockstat_on_acquire(lock_stat_t* s, int contended);
+void lockstat_on_release(lock_stat_t* s);
+
+#  define LOCK_STAT_FIELD            lock_stat_t stat;
+#  define LOCK_STAT_INIT(n)          .stat = { .name = (n) },
+#  define LOCKSTAT_ACQUIRED(l, c)    lockstat_on_acquire(&(l)->stat, (c))
+#  define LOCKSTAT_RELEASE(l)        lockstat_on_release(&(l)->stat)
+#else
+#  define LOCK_STAT_FIELD
+#  define LOCK_STAT_INIT(n)
+#  define LOCKSTAT_ACQUIRED(l, c)    ((void)(c))
+#  define LOCKSTAT_RELEASE(l)        ((void)0)
+#endif
+
+/* 登録済みロックの統計を KLOG に出す（LOCK_STAT 無効時は一行だけ） */
+void lockstat_dump(void);
+
+/* ---- チケットロック ---- */
+typedef struct spinlock {
+    volatile uint32_t next;    /* 次に配る整理券 */
+    volatile uint32_t owner;   /* 現在呼ばれている整理券 */
+    LOCK_STAT_FIELD
+} spinlock_t;
+
+#define SPINLOCK_INIT(n)      { .next = 0, .owner = 0, LOCK_STAT_INIT(n) }
+#define DEFINE_SPINLOCK(var)  spinlock_t var = SPINLOCK_INIT(#var)
+
+static inline void spin_lock(spinlock_t* l)
+{
+    uint32_t me = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED);
+    int contended = 0;
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != me) {
+        contended = 1;
+        cpu_relax();
+    }
+    LOCKSTAT_ACQUIRED(l, contended);
+}
+
+static inline int spin_trylock(spinlock_t* l)
+{
+    uint32_t owner = __atomic_load_n(&l->owner, __ATOMIC_RELAXED);
+    uint32_t expected = owner;
+    /* next == owner（誰も待っていない）のときだけ整理券を取る */
+    if (!__atomic_compare_exchange_n(&l->next, &expected, owner + 1, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    LOCKSTAT_ACQUIRED(l, 0);
+    return 1;
+}
+
+static inline void spin_unlock(spinlock_t* l)
+{
+    LOCKSTAT_RELEASE(l);
+    /* owner を書くのは保持者だけなので RMW は不要 */
+    __atomic_store_n(&l->owner, l->owner + 1, __ATOMIC_RELEASE);
+}
+
+static inline int spin_is_locked(const spinlock_t* l)
+{
+    return __atomic_load_n(&l->next, __ATOMIC_RELAXED) !=
+           __atomic_load_n(&l->owner, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t spin_lock_irqsave(spinlock_t* l)
+{
+    uint64_t flags = irq_save();
+    spin_lock(l);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* l, uint64_t flags)
+{
+    spin_unlock(l);
+    irq_restore(flags);
+}
+
+/* ---- MCS キューロック ---- */
+typedef struct mcs_node {
+    struct mcs_node* volatile next;
+    volatile uint32_t         locked;   /* 1 の間スピン（前任者が 0 にする） */
+} mcs_node_t;
+
+typedef struct mcs_lock {
+    mcs_node_t* volatile tail;
+    LOCK_STAT_FIELD
+} mcs_lock_t;
+
+#define MCS_LOCK_INIT(n)      { .tail = NULL, LOCK_STAT_INIT(n) }
+#define DEFINE_MCS_LOCK(var)  mcs_lock_t var = MCS_LOCK_INIT(#var)
+
+void mcs_lock(mcs_lock_t* l, mcs_node_t* me);
+void mcs_unlock(mcs_lock_t* l, mcs_node_t* me);
+
+static inline uint64_t mcs_lock_irqsave(mcs_lock_t* l, mcs_node_t* me)
+{
+    uint64_t flags = irq_save();
+    mcs_lock(l, me);
+    return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t* l, mcs_node_t* me, uint64_t flags)
+{
+    mcs_unlock(l, me);
+    irq_restore(flags);
+}
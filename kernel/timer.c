@@ -0,0 +1,326 @@
+#include "timer.h"
+#include "ktime.h"
+#include "softirq.h"
+#include "spinlock.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/vectors.h"
+#include "log.h"
+
+#define LVL_MASK         (TIMER_LVL_SIZE - 1)
+#define LEVEL_EXPIRED    TIMER_LEVELS          /* 期限切れで実行待ち（w->expired 上） */
+#define TICK_NONE        (~0ULL)
+#define TICK_MAX_DELTA   ((1ULL << (TIMER_LVL_BITS * TIMER_LEVELS)) - 1)
+
+typedef struct timer_wheel {
+    spinlock_t lock;
+    uint64_t   clk;                                    /* 次に処理する tick */
+    uint64_t   occupied[TIMER_LEVELS];                 /* 非空スロットのビット */
+    ktimer_t*  slots[TIMER_LEVELS][TIMER_LVL_SIZE];
+    ktimer_t*  expired;                                /* softirq で実行する分 */
+    uint64_t   armed_tick;                             /* LAPIC に設定中の tick（TICK_NONE = 停止） */
+
+    uint64_t   fired;
+    uint64_t   cascaded;
+    uint64_t   programs;                               /* LAPIC の再設定回数 */
+} __attribute__((aligned(64))) timer_wheel_t;
+
+static timer_wheel_t g_wheels[MAX_CPUS];
+static volatile uint32_t g_timer_registered = 0;
+
+static inline uint64_t ns_to_tick_ceil(uint64_t ns)
+{
+    return (ns + (1ULL << TIMER_GRAN_SHIFT) - 1) >> TIMER_GRAN_SHIFT;
+}
+
+static inline uint64_t now_tick(void)
+{
+    return ktime_ns() >> TIMER_GRAN_SHIFT;
+}
+
+static inline uint64_t ror64(uint64_t v, unsigned n)
+{
+    n &= 63;
+    return n ? (v >> n) | (v << (64 - n)) : v;
+}
+
+/* ---- リスト操作（すべて w->lock 下） ---- */
+
+static void list_add(ktimer_t** head, ktimer_t* t)
+{
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+}
+
+static void wheel_unlink(timer_wheel_t* w, ktimer_t* t)
+{
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    if (t->level < TIMER_LEVELS && !w->slots[t->level][t->slot]) {
+        w->occupied[t->level] &= ~(1ULL << t->slot);
+    }
+    t->next  = NULL;
+    t->pprev = NULL;
+}
+
+/* 今の clk を基準に段とスロットを決めて繋ぐ（O(1)） */
+static void wheel_insert(timer_wheel_t* w, ktimer_t* t)
+{
+    if (t->expires < w->clk) t->expires = w->clk;
+    uint64_t delta = t->expires - w->clk;
+    if (delta > TICK_MAX_DELTA) {
+        delta = TICK_MAX_DELTA;                 /* 範囲外は上限で一度起きて積み直す */
+        t->expires = w->clk + delta;
+    }
+
+    unsigned lvl = 0;
+    while (lvl < TIMER_LEVELS - 1 && delta >= (1ULL << (TIMER_LVL_BITS * (lvl + 1)))) ++lvl;
+
+    unsigned slot = (unsigned)(t->expires >> (TIMER_LVL_BITS * lvl)) & LVL_MASK;
+    t->level = (uint8_t)lvl;
+    t->slot  = (uint8_t)slot;
+    list_add(&w->slots[lvl][slot], t);
+    w->occupied[lvl] |= 1ULL << slot;
+}
+
+/* 次に処理が要る tick（段 0 の発火、または非空の上位スロットのカスケード）。無ければ TICK_NONE */
+static uint64_t wheel_next_event(const timer_wheel_t* w)
+{
+    uint64_t best = TICK_NONE;
+    for (unsigned lvl = 0; lvl < TIMER_LEVELS; ++lvl) {
+        uint64_t occ = w->occupied[lvl];
+        if (!occ) continue;
+
+        unsigned shift = TIMER_LVL_BITS * lvl;
+        uint64_t base  = w->clk >> shift;
+        unsigned pos   = (unsigned)base & LVL_MASK;
+        uint64_t r     = ror64(occ, pos);
+
+        /* 段 0 は clk 自身も対象。上位段は clk が境界ちょうどのときだけ現在位置も対象 */
+        int skip_cur = lvl > 0 && (w->clk & ((1ULL << shift) - 1)) != 0;
+        if (skip_cur) r &= ~1ULL;
+        uint64_t k = r ? (uint64_t)__builtin_ctzll(r) : TIMER_LVL_SIZE;
+
+        uint64_t t = (base + k) << shift;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+/* clk の tick を処理：境界ならカスケード → 段 0 のスロットを expired へ */
+static void wheel_process_tick(timer_wheel_t* w)
+{
+    uint64_t c = w->clk;
+    for (unsigned lvl = 1; lvl < TIMER_LEVELS; ++lvl) {
+        unsigned shift = TIMER_LVL_BITS * lvl;
+        if (c & ((1ULL << shift) - 1)) break;
+
+        unsigned slot = (unsigned)(c >> shift) & LVL_MASK;
+        ktimer_t* list = w->slots[lvl][slot];
+        w->slots[lvl][slot] = NULL;
+        w->occupied[lvl] &= ~(1ULL << slot);
+        while (list) {
+            ktimer_t* next = list->next;
+            wheel_insert(w, list);
+            w->cascaded++;
+            list = next;
+        }
+    }
+
+    unsigned slot = (unsigned)c & LVL_MASK;
+    ktimer_t* list = w->slots[0][slot];
+    w->slots[0][slot] = NULL;
+    w->occupied[0] &= ~(1ULL << slot);
+    while (list) {
+        ktimer_t* next = list->next;
+        list->level = LEVEL_EXPIRED;
+        list_add(&w->expired, list);
+        list = next;
+    }
+}
+
+/* now まで進める。空の区間は次のイベントまで飛ばす */
+static void wheel_advance(timer_wheel_t* w, uint64_t now)
+{
+    while (w->clk <= now) {
+        uint64_t t = wheel_next_event(w);
+        if (t > now) { w->clk = now + 1; break; }
+        w->clk = t;
+        wheel_process_tick(w);
+        w->clk++;
+    }
+}
+
+/* 次のイベントに LAPIC を合わせる（変化が無ければ触らない） */
+static void wheel_program(timer_wheel_t* w)
+{
+    uint64_t next = wheel_next_event(w);
+    if (next == w->armed_tick) return;
+    w->armed_tick = next;
+    w->programs++;
+    lapic_timer_arm(next == TICK_NONE ? 0 : ktime_ns_to_tsc(next << TIMER_GRAN_SHIFT));
+}
+
+/* ---- 割込み / softirq ---- */
+
+static void timer_irq_handler(intr_context_t* ctx)
+{
+    (void)ctx;
+    lapic_eoi();
+    raise_softirq(SOFTIRQ_TIMER);
+}
+
+static void timer_softirq(void)
+{
+    timer_wheel_t* w = &g_wheels[this_cpu_id()];
+
+    uint64_t flags = spin_lock_irqsave(&w->lock);
+    w->armed_tick = TICK_NONE;               /* ワンショットは消費済み */
+    wheel_advance(w, now_tick());
+
+    /* 1 つずつ外してロックを離して呼ぶ（コールバックが再登録・取り消しできるように） */
+    while (w->expired) {
+        ktimer_t* t = w->expired;
+        wheel_unlink(w, t);
+        timer_fn_t fn = t->fn;
+        void* arg     = t->arg;
+        w->fired++;
+        spin_unlock_irqrestore(&w->lock, flags);
+
+        fn(arg);
+
+        flags = spin_lock_irqsave(&w->lock);
+    }
+    wheel_program(w);
+    spin_unlock_irqrestore(&w->lock, flags);
+}
+
+int timer_init_cpu(void)
+{
+    if (!__atomic_exchange_n(&g_timer_registered, 1, __ATOMIC_ACQ_REL)) {
+        intr_register_handler(VEC_TIMER, timer_irq_handler);
+        softirq_register(SOFTIRQ_TIMER, timer_softirq);
+    }
+
+    timer_wheel_t* w = &g_wheels[this_cpu_id()];
+    w->lock       = (spinlock_t)SPINLOCK_INIT("timer");
+    w->clk        = now_tick();
+    w->armed_tick = TICK_NONE;
+    return lapic_timer_init(VEC_TIMER);
+}
+
+/* ---- 公開 API ---- */
+
+void timer_setup(ktimer_t* t, timer_fn_t fn, void* arg)
+{
+    t->next  = NULL;
+    t->pprev = NULL;
+    t->fn    = fn;
+    t->arg   = arg;
+    t->cpu   = 0;
+}
+
+/* t が載っているホイールをロックして返す（載っていなければ NULL、ロックも取らない） */
+static timer_wheel_t* lock_owner(const ktimer_t* t, uint64_t* flags)
+{
+    for (;;) {
+        if (!__atomic_load_n(&t->pprev, __ATOMIC_ACQUIRE)) return NULL;
+        uint32_t cpu = __atomic_load_n(&t->cpu, __ATOMIC_RELAXED);
+        timer_wheel_t* w = &g_wheels[cpu];
+        *flags = spin_lock_irqsave(&w->lock);
+        if (t->pprev && t->cpu == cpu) return w;
+        spin_unlock_irqrestore(&w->lock, *flags);   /* 途中で付け替えられた */
+    }
+}
+
+int timer_cancel(ktimer_t* t)
+{
+    uint64_t flags;
+    timer_wheel_t* w = lock_owner(t, &flags);
+    if (!w) return 0;
+    wheel_unlink(w, t);       /* LAPIC は触らない（早く起きたら次で合わせ直す） */
+    spin_unlock_irqrestore(&w->lock, flags);
+    return 1;
+}
+
+int timer_pending(const ktimer_t* t)
+{
+    return __atomic_load_n(&t->pprev, __ATOMIC_ACQUIRE) != NULL;
+}
+
+void timer_arm(ktimer_t* t, uint64_t expires_ns)
+{
+    if (!t || !t->fn) return;
+    timer_cancel(t);
+
+    uint32_t cpu = this_cpu_id();
+    timer_wheel_t* w = &g_wheels[cpu];
+    uint64_t flags = spin_lock_irqsave(&w->lock);
+
+    /* 止まっていた分の clk を進めてから基準にする（空なら飛ばすだけ） */
+    wheel_advance(w, now_tick() ? now_tick() - 1 : 0);
+
+    t->cpu     = cpu;
+    t->expires = ns_to_tick_ceil(expires_ns);
+    wheel_insert(w, t);
+
+    if (w->expired) raise_softirq(SOFTIRQ_TIMER);   /* 進めた分で期限切れが出た */
+    wheel_program(w);
+    spin_unlock_irqrestore(&w->lock, flags);
+}
+
+void timer_arm_after(ktimer_t* t, uint64_t delay_ns)
+{
+    timer_arm(t, ktime_ns() + delay_ns);
+}
+
+void timer_dump_stats(void)
+{
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) {
+        const timer_wheel_t* w = &g_wheels[cpu];
+        if (!w->fired && !w->programs) continue;
+        KLOG_INFO("timer", "cpu%u: fired=%llu cascaded=%llu lapic programs=%llu", cpu,
+                  (unsigned long long)w->fired, (unsigned long long)w->cascaded,
+                  (unsigned long long)w->programs);
+    }
+}
+
+#ifdef KERNEL_BENCH
+#define TIMER_BENCH_N  8
+
+typedef struct timer_bench_ent {
+    ktimer_t t;
+    uint64_t due_ns;
+    uint64_t late_ns;
+    volatile uint32_t done;
+} timer_bench_ent_t;
+
+static void timer_bench_fn(void* arg)
+{
+    timer_bench_ent_t* e = (timer_bench_ent_t*)arg;
+    e->late_ns = ktime_ns() - e->due_ns;
+    __atomic_store_n(&e->done, 1, __ATOMIC_RELEASE);
+}
+
+void timer_bench(void)
+{
+    static const uint64_t delays_us[TIMER_BENCH_N] = { 50, 200, 1000, 3000, 10000, 40000, 100000, 300000 };
+    static timer_bench_ent_t ents[TIMER_BENCH_N];
+
+    for (int i = 0; i < TIMER_BENCH_N; ++i) {
+        timer_setup(&ents[i].t, timer_bench_fn, &ents[i]);
+        ents[i].done   = 0;
+        ents[i].due_ns = ktime_ns() + delays_us[i] * NSEC_PER_USEC;
+        timer_arm(&ents[i].t, ents[i].due_ns);
+    }
+    for (int i = 0; i < TIMER_BENCH_N; ++i) {
+        while (!__atomic_load_n(&ents[i].done, __ATOMIC_ACQUIRE)) __asm__ __volatile__("hlt");
+        KLOG_INFO("timer", "bench: %6llu us timer fired %llu ns late",
+                  (unsigned long long)delays_us[i], (unsigned long long)ents[i].late_ns);
+    }
+    timer_dump_stats();
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * tickless タイマ（CPU ごとの階層タイマホイール）
+ *  - 1 tick = 2^TIMER_GRAN_SHIFT ns。64 スロット × TIMER_LEVELS 段
+ *  - 登録・取り消しは O(1)（双方向リストのスロットに繋ぐ/外すだけ）
+ *  - 上位段のスロットは、下位段が一周した時点で下へ振り直す（カスケード）
+ *  - 周期 tick は無い。LAPIC のワンショット（TSC-deadline）を
+ *    「次に何かが起きる時刻」にだけ設定する。空なら止める
+ *  - 期限切れのコールバックは SOFTIRQ_TIMER（割込み許可）で実行する
+ * =========================================================== */
+
+#define TIMER_GRAN_SHIFT   14          /* 1 tick ≒ 16.4us */
+#define TIMER_LVL_BITS     6
+#define TIMER_LVL_SIZE     (1u << TIMER_LVL_BITS)
+#define TIMER_LEVELS       6           /* 2^(14+36) ns ≒ 13 日先まで */
+
+typedef void (*timer_fn_t)(void* arg);
+
+typedef struct ktimer {
+    struct ktimer*  next;
+    struct ktimer** pprev;      /* NULL = 未登録 */
+    uint64_t        expires;    /* tick */
+    timer_fn_t      fn;
+    void*           arg;
+    uint32_t        cpu;        /* 登録先ホイール */
+    uint8_t         level;
+    uint8_t         slot;
+} ktimer_t;
+
+#define KTIMER_INIT(f, a)  { NULL, NULL, 0, (f), (a), 0, 0, 0 }
+
+/* 自 CPU のホイールと LAPIC タイマを初期化（ktime 較正後、BSP/AP で 1 回ずつ） */
+int  timer_init_cpu(void);
+
+void timer_setup(ktimer_t* t, timer_fn_t fn, void* arg);
+
+/* ktime_ns() が expires_ns 以上になったら fn(arg) を自 CPU で呼ぶ。
+ * 登録済みなら付け替える。コールバック内からの再登録も可 */
+void timer_arm(ktimer_t* t, uint64_t expires_ns);
+void timer_arm_after(ktimer_t* t, uint64_t delay_ns);
+
+/* 取り消し。登録されていたら 1。実行中のコールバックの完了は待たない */
+int  timer_cancel(ktimer_t* t);
+int  timer_pending(const ktimer_t* t);
+
+void timer_dump_stats(void);
+
+#ifdef KERNEL_BENCH
+/* 様々な遅延でタイマを張り、発火の遅れ（ns）を KLOG に出す */
+void timer_bench(void);
+#endif
@@ -0,0 +1,97 @@
+#include "trace.h"
+#include "log.h"
+#include "kline.h"
+#include "arch/x86/tsc.h"
+
+/* メモリダンプから探すための見出し。magic の後ろの値は全て LE 64bit */
+#define TRACE_MAGIC    0x3130454341525454ULL   /* "TTRACE01" */
+#define TRACE_VERSION  1
+
+typedef struct trace_header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t self_vaddr;       /* ダンプ上の位置と比べて物理⇔仮想の差を出す */
+    uint64_t rings_vaddr;
+    uint64_t events_vaddr;
+    uint64_t nr_events;
+    uint64_t max_cpus;
+    uint64_t ring_records;
+    uint64_t record_size;
+    uint64_t event_size;
+    uint64_t tsc_hz;
+} trace_header_t;
+
+trace_ring_t      g_trace_rings[MAX_CPUS];
+volatile uint32_t g_trace_on = 0;
+
+volatile trace_header_t g_trace_hdr = {
+    .magic        = TRACE_MAGIC,
+    .version      = TRACE_VERSION,
+    .max_cpus     = MAX_CPUS,
+    .ring_records = TRACE_RING_RECORDS,
+    .record_size  = sizeof(trace_record_t),
+    .event_size   = sizeof(trace_event_t),
+};
+
+void trace_init(void)
+{
+    g_trace_hdr.self_vaddr   = (uint64_t)(uintptr_t)&g_trace_hdr;
+    g_trace_hdr.rings_vaddr  = (uint64_t)(uintptr_t)g_trace_rings;
+    g_trace_hdr.events_vaddr = (uint64_t)(uintptr_t)__trace_events_start;
+    g_trace_hdr.nr_events    = (uint64_t)(__trace_events_end - __trace_events_start);
+    g_trace_hdr.tsc_hz       = tsc_hz();
+    __atomic_store_n(&g_trace_on, 1, __ATOMIC_RELEASE);
+    KLOG_INFO("trace", "flight recorder on: %llu events, %u records/cpu",
+              (unsigned long long)g_trace_hdr.nr_events, TRACE_RING_RECORDS);
+}
+
+void trace_set_enabled(int on)
+{
+    __atomic_store_n(&g_trace_on, on ? 1u : 0u, __ATOMIC_RELEASE);
+}
+
+/* ---- シリアル書き出し（"KTRACE " で始まる行） ---- */
+void trace_dump(serial_device_t* dev)
+{
+    if (!dev) return;
+
+    uint32_t was_on = __atomic_exchange_n(&g_trace_on, 0, __ATOMIC_ACQ_REL);
+    klog_flush();                          /* 先に溜まったログを出しておく */
+
+    char buf[160];
+    kline_t l = KLINE_INIT(buf);
+    kline_put_str(&l, "KTRACE BEGIN ");
+    kline_put_u64(&l, TRACE_VERSION);
+    kline_put_str(&l, " tsc_hz=");
+    kline_put_u64(&l, tsc_hz());
+    kline_emit(dev, &l);
+
+    uint64_t nev = (uint64_t)(__trace_events_end - __trace_events_start);
+    for (uint64_t i = 0; i < nev; ++i) {
+        const trace_event_t* ev = &__trace_events_start[i];
+        kline_put_str(&l, "KTRACE EV ");
+        kline_put_u64(&l, i);
+        kline_put_str(&l, " ");
+        kline_put_str(&l, ev->name);
+        kline_put_str(&l, " ");
+        kline_put_str(&l, ev->fmt);
+        kline_emit(dev, &l);
+    }
+
+    uint32_t ncpu = percpu_count();
+    for (uint32_t cpu = 0; cpu < ncpu; ++cpu) {
+        trace_ring_t* r = &g_trace_rings[cpu];
+        uint64_t head  = r->head;
+        uint64_t first = (head > TRACE_RING_RECORDS) ? head - TRACE_RING_RECORDS : 0;
+        for (uint64_t s = first; s < head; ++s) {
+            kline_put_str(&l, "KTRACE R ");
+            kline_put_hex(&l, &r->rec[s & (TRACE_RING_RECORDS - 1)], sizeof(trace_record_t));
+            kline_emit(dev, &l);
+        }
+    }
+
+    kline_put_str(&l, "KTRACE END");
+    kline_emit(dev, &l);
+
+    if (was_on) trace_set_enabled(1);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include "serial.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/percpu.h"
+
+/* =========================== 概要 ===========================
+ * バイナリのトレースイベント（常時有効のフライトレコーダ）
+ *  - イベントの書式はコンパイル時に .trace_events セクションへ並べる。
+ *    id = セクション先頭からの添字（リンク時に決まる）
+ *  - 記録は CPU ごとのリング（古いものから上書き）に 48 バイト固定で書くだけ。
+ *    整形はしない（ホスト側 tools/trace_decode.py で行う）
+ *  - 予約は自 CPU のリングに対する lock 無し xadd 1 命令なので、
+ *    割込み・NMI から入れ子で呼ばれても同じスロットを取り合わない
+ *  - 取り出し：trace_dump() でシリアルへ、または g_trace_hdr の magic を
+ *    QEMU のメモリダンプから探して直接読む
+ *
+ * 使い方:
+ *   TRACE_EVENT_DEFINE(irq, "vec=%llu cycles=%llu");   // ファイルスコープ
+ *   TRACE2(irq, vec, cycles);                            // 呼び出し点
+ * =========================================================== */
+
+#define TRACE_MAX_ARGS       4
+#define TRACE_RING_RECORDS   512          /* CPU あたり。2 の冪 */
+#define TRACE_NAME_MAX       24
+#define TRACE_FMT_MAX        64
+
+typedef struct trace_record {
+    uint64_t tsc;
+    uint16_t id;
+    uint8_t  cpu;
+    uint8_t  nargs;
+    uint32_t rsv;
+    uint64_t args[TRACE_MAX_ARGS];
+} trace_record_t;                         /* 48B */
+
+/* 文字列はポインタでなく実体を持つ（メモリダンプだけで名前が引けるように） */
+typedef struct trace_event {
+    char     name[TRACE_NAME_MAX];
+    char     fmt[TRACE_FMT_MAX];
+    uint64_t rsv;
+} __attribute__((aligned(32))) trace_event_t;  /* 96B。GCC が 32B 境界に置くので型の側でそろえる */
+
+typedef struct trace_ring {
+    volatile uint64_t head;               /* 次に書く通し番号（自 CPU だけが進める） */
+    uint64_t          pad[7];
+    trace_record_t    rec[TRACE_RING_RECORDS];
+} __attribute__((aligned(64))) trace_ring_t;
+
+extern const trace_event_t __trace_events_start[];
+extern const trace_event_t __trace_events_end[];
+extern trace_ring_t        g_trace_rings[MAX_CPUS];
+extern volatile uint32_t   g_trace_on;
+
+#define TRACE_EVENT_DEFINE(NAME, FMT)                                         \
+    static const trace_event_t __trace_ev_##NAME                              \
+        __attribute__((section(".trace_events"), used)) = { #NAME, FMT, 0 }
+
+static inline void trace_emit(const trace_event_t* ev, uint8_t nargs,
+                              uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+    uint32_t cpu = this_cpu_id();
+    trace_ring_t* r = &g_trace_rings[cpu];
+
+    /* 自 CPU 内で原子的（lock 不要）。入れ子の割込みは次のスロットを取る */
+    uint64_t seq = 1;
+    __asm__ __volatile__("xaddq %0, %1" : "+r"(seq), "+m"(r->head) :: "memory");
+
+    trace_record_t* rec = &r->rec[seq & (TRACE_RING_RECORDS - 1)];
+    rec->tsc     = rdtsc();
+    rec->id      = (uint16_t)(ev - __trace_events_start);
+    rec->cpu     = (uint8_t)cpu;
+    rec->nargs   = nargs;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+}
+
+#define TRACE_N(NAME, N, A0, A1, A2, A3)                                      \
+    do {                                                                      \
+        if (__builtin_expect(g_trace_on != 0, 1))                             \
+            trace_emit(&__trace_ev_##NAME, (N), (uint64_t)(A0), (uint64_t)(A1), \
+                       (uint64_t)(A2), (uint64_t)(A3));                       \
+    } while (0)
+
+#define TRACE0(NAME)                 TRACE_N(NAME, 0, 0, 0, 0, 0)
+#define TRACE1(NAME, A0)             TRACE_N(NAME, 1, A0, 0, 0, 0)
+#define TRACE2(NAME, A0, A1)         TRACE_N(NAME, 2, A0, A1, 0, 0)
+#define TRACE3(NAME, A0, A1, A2)     TRACE_N(NAME, 3, A0, A1, A2, 0)
+#define TRACE4(NAME, A0, A1, A2, A3) TRACE_N(NAME, 4, A0, A1, A2, A3)
+
+/* 記録を開始する（percpu_init_bsp の後。TSC 較正前でも良い） */
+void trace_init(void);
+void trace_set_enabled(int on);
+
+/* 全 CPU のリングを古い順にシリアルへ書き出す（書き出し中は記録を止める）。
+ * 形式は tools/trace_decode.py が読む行ベースの 16 進 */
+void trace_dump(serial_device_t* dev);
@@ -0,0 +1,178 @@
+#include "workqueue.h"
+#include "softirq.h"
+#include "arch/x86/percpu.h"
+#include "arch/x86/smp.h"
+#include "arch/x86/lapic.h"
+#include "arch/x86/isr.h"
+#include "arch/x86/intr_stat.h"
+#include "arch/x86/vectors.h"
+#include "arch/x86/arch_x86_low.h"
+#include "arch/x86/arch_x86_io.h"
+#include "log.h"
+
+typedef struct wq_stat {
+    uint64_t executed;
+    uint64_t max_depth;
+    uint64_t lat_sum;        /* 投入 → 実行開始（TSC サイクル） */
+    uint64_t lat_max;
+    uint64_t run_max;        /* fn の実行時間 */
+    uint64_t wakeups;        /* この CPU 宛てに送った起床 IPI */
+} __attribute__((aligned(64))) wq_stat_t;
+
+static wq_stat_t g_stat[MAX_CPUS];
+static volatile uint32_t g_wake_registered = 0;
+
+/* 起床 IPI：HLT から抜けさせるだけ */
+static void workqueue_wake_handler(void)
+{
+    uint64_t t0 = rdtsc();
+    lapic_eoi();
+    intr_stat_record(VEC_IPI_WAKE, rdtsc() - t0);
+}
+DEFINE_FAST_ISR(workqueue_wake_stub, workqueue_wake_handler)
+
+void workqueue_init_cpu(void)
+{
+    if (!__atomic_exchange_n(&g_wake_registered, 1, __ATOMIC_ACQ_REL)) {
+        intr_register_fast(VEC_IPI_WAKE, workqueue_wake_stub);
+    }
+    /* キューは percpu 確保時に 0 埋め済み。online 前に積まれた work を消さないよう触らない */
+}
+
+/* push して、空だったなら 1 を返す（smp.c の queue_push と同じ形） */
+static int wq_push(percpu_t* c, work_t* w)
+{
+    work_t* head = __atomic_load_n(&c->work_queue, __ATOMIC_RELAXED);
+    do {
+        w->next = head;
+    } while (!__atomic_compare_exchange_n(&c->work_queue, &head, w, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return head == NULL;
+}
+
+static int wq_enqueue(percpu_t* c, work_t* w)
+{
+    if (!w || !w->fn) return -1;
+    if (__atomic_exchange_n(&w->pending, 1, __ATOMIC_ACQ_REL)) return 0;
+
+    w->queued_tsc = rdtsc();
+    uint32_t depth = __atomic_add_fetch(&c->work_depth, 1, __ATOMIC_RELAXED);
+    wq_stat_t* st = &g_stat[c->cpu_id];
+    if (depth > st->max_depth) st->max_depth = depth;   /* 目安なので競合は気にしない */
+
+    if (wq_push(c, w) && c != this_cpu() && c->online) {
+        st->wakeups++;
+        lapic_send_ipi(c->apic_id, VEC_IPI_WAKE);
+    }
+    return 1;
+}
+
+int queue_work(work_t* w)
+{
+    return wq_enqueue(this_cpu(), w);
+}
+
+int queue_work_on(uint32_t cpu_id, work_t* w)
+{
+    percpu_t* c = percpu_get(cpu_id);
+    if (!c) return -1;
+    return wq_enqueue(c, w);
+}
+
+void workqueue_drain_local(void)
+{
+    percpu_t* c = this_cpu();
+    wq_stat_t* st = &g_stat[c->cpu_id];
+
+    work_t* list;
+    while ((list = __atomic_exchange_n(&c->work_queue, NULL, __ATOMIC_ACQUIRE)) != NULL) {
+        /* LIFO で積まれているので反転して投入順に */
+        work_t* fifo = NULL;
+        while (list) {
+            work_t* next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+        while (fifo) {
+            work_t* next = fifo->next;
+            work_fn_t fn = fifo->fn;
+            void* arg    = fifo->arg;
+
+            uint64_t t0  = rdtsc();
+            uint64_t lat = t0 - fifo->queued_tsc;
+            __atomic_sub_fetch(&c->work_depth, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&fifo->pending, 0, __ATOMIC_RELEASE);   /* fn 内からの再投入を許す */
+
+            fn(arg);
+
+            uint64_t run = rdtsc() - t0;
+            st->executed++;
+            st->lat_sum += lat;
+            if (lat > st->lat_max) st->lat_max = lat;
+            if (run > st->run_max) st->run_max = run;
+            fifo = next;
+        }
+    }
+}
+
+void cpu_idle_loop(void)
+{
+    for (;;) {
+        __asm__ __volatile__("cli" ::: "memory");
+        softirq_run_pending();
+
+        percpu_t* c = this_cpu();
+        if (__atomic_load_n(&c->work_queue, __ATOMIC_ACQUIRE) || softirq_has_pending()) {
+            __asm__ __volatile__("sti" ::: "memory");
+            workqueue_drain_local();
+            continue;
+        }
+        /* STI 直後の 1 命令は割込みが入らないので、検査 → HLT の間に取りこぼさない */
+        __asm__ __volatile__("sti; hlt" ::: "memory");
+    }
+}
+
+void workqueue_dump_stats(void)
+{
+    for (uint32_t cpu = 0; cpu < percpu_count(); ++cpu) {
+        const wq_stat_t* st = &g_stat[cpu];
+        if (!st->executed) continue;
+        KLOG_INFO("wq", "cpu%u: executed=%llu max_depth=%llu lat avg=%llu max=%llu run max=%llu cycles, wakeups=%llu",
+                  cpu, (unsigned long long)st->executed, (unsigned long long)st->max_depth,
+                  (unsigned long long)(st->lat_sum / st->executed), (unsigned long long)st->lat_max,
+                  (unsigned long long)st->run_max, (unsigned long long)st->wakeups);
+    }
+}
+
+#ifdef KERNEL_BENCH
+#define WQ_BENCH_WORKS 16
+
+static volatile uint32_t g_bench_done;
+
+static void wq_bench_fn(void* arg)
+{
+    (void)arg;
+    __atomic_add_fetch(&g_bench_done, 1, __ATOMIC_RELEASE);
+}
+
+void workqueue_bench(void)
+{
+    static work_t works[MAX_CPUS][WQ_BENCH_WORKS];
+    uint32_t self = this_cpu_id();
+    uint32_t expect = 0;
+
+    g_bench_done = 0;
+    for (cpumask_t m = smp_online_mask() & ~CPUMASK_CPU(self); m; m &= m - 1) {
+        uint32_t id = (uint32_t)__builtin_ctzll(m);
+        for (int i = 0; i < WQ_BENCH_WORKS; ++i) {
+            works[id][i] = (work_t)WORK_INIT(wq_bench_fn, NULL);
+            if (queue_work_on(id, &works[id][i]) == 1) ++expect;
+        }
+    }
+    while (__atomic_load_n(&g_bench_done, __ATOMIC_ACQUIRE) < expect) cpu_relax();
+
+    KLOG_INFO("wq", "bench: %u works on %u remote CPUs", expect, expect / WQ_BENCH_WORKS);
+    workqueue_dump_stats();
+}
+#endif
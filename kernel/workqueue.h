@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+/* =========================== 概要 ===========================
+ * CPU ごとのワークキューと idle ループ
+ *  - queue_work() は割込みハンドラからも呼べる（lock-free の MPSC push のみ）
+ *  - 実行は投入先 CPU の idle ループ（cpu_idle_loop）で、割込み許可・非割込み文脈
+ *    → 重い処理を割込み禁止区間や VM-exit の経路から追い出す
+ *  - 他 CPU へ投入してキューが空 → 非空になったときだけ VEC_IPI_WAKE で起こす
+ *  - キュー長（現在・最大）と遅延（投入 → 実行開始）、実行時間を CPU ごとに記録
+ * =========================================================== */
+
+typedef void (*work_fn_t)(void* arg);
+
+typedef struct work {
+    struct work*      next;
+    work_fn_t         fn;
+    void*             arg;
+    uint64_t          queued_tsc;
+    volatile uint32_t pending;     /* キュー中なら 1（二重投入しない） */
+} work_t;
+
+#define WORK_INIT(f, a)  { NULL, (f), (a), 0, 0 }
+
+/* 自 CPU のキューに入れる。入れたら 1、既にキュー中なら 0 */
+int queue_work(work_t* w);
+/* cpu_id のキューに入れる（必要なら起床 IPI）。入れたら 1、既にキュー中なら 0、不正 CPU で -1 */
+int queue_work_on(uint32_t cpu_id, work_t* w);
+
+/* 自 CPU のキューを空になるまで実行（IF=1 で呼ぶ） */
+void workqueue_drain_local(void);
+
+/* 自 CPU の起床 IPI を有効化（BSP/AP の初期化で 1 回ずつ）。
+ * キューは初期化しない（percpu_alloc_ap 直後から queue_work_on でき、online 後に実行される） */
+void workqueue_init_cpu(void);
+
+/* idle ループ：softirq の残り → ワークキュー → HLT を繰り返す（戻らない） */
+void cpu_idle_loop(void) __attribute__((__noreturn__));
+
+void workqueue_dump_stats(void);
+
+#ifdef KERNEL_BENCH
+/* 全 online CPU に空 work を投げ、遅延とキュー長を KLOG に出す */
+void workqueue_bench(void);
+#endif
@@ -0,0 +1,34 @@
+#!/bin/sh
+# カーネルのシンボル表（テキストシンボルのみ、アドレス昇順）をアセンブリで出力する。
+#   使い方: tools/gen_ksyms.sh [kernel.elf] > ksyms.S
+# 引数なしなら空の表を出す（1 回目のリンク用）。
+# 表は .rodata の末尾に入るので、2 回目のリンクでもテキストのアドレスは変わらない。
+set -e
+
+NM=${NM:-nm}
+
+if [ -n "$1" ]; then
+    $NM -n --defined-only "$1"
+fi | awk '
+BEGIN { n = 0 }
+$2 ~ /^[tTwW]$/ && $3 !~ /^\.L/ {
+    addr[n] = $1; name[n] = $3; n++
+}
+END {
+    print "    .section .rodata.ksyms, \"a\""
+    print "    .balign 8"
+    print "    .globl __ksym_count"
+    print "__ksym_count:"
+    printf "    .quad %d\n", n
+    print "    .globl __ksym_addrs"
+    print "__ksym_addrs:"
+    for (i = 0; i < n; i++) printf "    .quad 0x%s\n", addr[i]
+    print "    .globl __ksym_name_offs"
+    print "__ksym_name_offs:"
+    off = 0
+    for (i = 0; i < n; i++) { printf "    .long %d\n", off; off += length(name[i]) + 1 }
+    print "    .globl __ksym_names"
+    print "__ksym_names:"
+    for (i = 0; i < n; i++) printf "    .asciz \"%s\"\n", name[i]
+    print "    .section .note.GNU-stack, \"\", @progbits"
+}'
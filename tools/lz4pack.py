@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+# ファイルを LZ4 フレーム形式で圧縮する（lz4 コマンドが無い環境向け。標準ライブラリだけで動く）。
+#
+#   圧縮 :  tools/lz4pack.py build/kernel/kernel.elf img/kernel.elf.lz4
+#   確認 :  tools/lz4pack.py -d img/kernel.elf.lz4 out.elf
+#
+# 出力は lz4 -d でもそのまま展開できる（ブロック独立・元サイズ・全体の xxHash32 付き）。
+# ローダは展開しながら PT_LOAD へ写すので、ELF ヘッダと PHDR が最初のブロックに入っていれば良い。
+# 圧縮は貪欲法 1 本（4 バイトのハッシュで直近の一致を探すだけ）。比は lz4 -1 と同程度。
+import argparse
+import struct
+import sys
+
+MAGIC = 0x184D2204
+FLG_VERSION = 0x40
+FLG_BLOCK_INDEP = 0x20
+FLG_BLOCK_CSUM = 0x10
+FLG_CONTENT_SIZE = 0x08
+FLG_CONTENT_CSUM = 0x04
+BLOCK_RAW = 0x80000000
+BLOCK_SIZES = {4: 64 << 10, 5: 256 << 10, 6: 1 << 20, 7: 4 << 20}
+
+MIN_MATCH = 4
+MFLIMIT = 12          # 最後のマッチはブロック末尾の 12 バイトより前で始まる
+LAST_LITERALS = 5     # 末尾 5 バイトは必ずリテラル
+MAX_OFFSET = 65535
+
+P1, P2, P3, P4, P5 = 2654435761, 2246822519, 3266489917, 668265263, 374761393
+M32 = 0xFFFFFFFF
+
+
+def _rotl(x, r):
+    return ((x << r) | (x >> (32 - r))) & M32
+
+
+def xxh32(data, seed=0):
+    n = len(data)
+    p = 0
+    if n >= 16:
+        v = [(seed + P1 + P2) & M32, (seed + P2) & M32, seed & M32, (seed - P1) & M32]
+        words = struct.unpack_from("<%dI" % ((n // 16) * 4), data)
+        for i in range(0, len(words), 4):
+            for j in range(4):
+                v[j] = (_rotl((v[j] + words[i + j] * P2) & M32, 13) * P1) & M32
+        p = (n // 16) * 16
+        h = (_rotl(v[0], 1) + _rotl(v[1], 7) + _rotl(v[2], 12) + _rotl(v[3], 18)) & M32
+    else:
+        h = (seed + P5) & M32
+    h = (h + n) & M32
+    while p + 4 <= n:
+        h = (_rotl((h + struct.unpack_from("<I", data, p)[0] * P3) & M32, 17) * P4) & M32
+        p += 4
+    while p < n:
+        h = (_rotl((h + data[p] * P5) & M32, 11) * P1) & M32
+        p += 1
+    h ^= h >> 15
+    h = (h * P2) & M32
+    h ^= h >> 13
+    h = (h * P3) & M32
+    h ^= h >> 16
+    return h
+
+
+def _put_len(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _put_seq(out, lits, mlen, off):
+    lit = len(lits)
+    token = (min(lit, 15) << 4) | (min(mlen - MIN_MATCH, 15) if mlen else 0)
+    out.append(token)
+    if lit >= 15:
+        _put_len(out, lit - 15)
+    out += lits
+    if mlen:
+        out += struct.pack("<H", off)
+        if mlen - MIN_MATCH >= 15:
+            _put_len(out, mlen - MIN_MATCH - 15)
+
+
+def _match_len(src, a, b, limit):
+    """src[a:] と src[b:] の一致長（b + 長さ <= limit）"""
+    n = 0
+    step = 64
+    while b + n < limit:
+        k = min(step, limit - b - n)
+        if src[a + n:a + n + k] == src[b + n:b + n + k]:
+            n += k
+            continue
+        if k == 1:
+            break
+        step = max(1, k // 2)       # 食い違う所まで二分で詰める
+    return n
+
+
+def compress_block(src):
+    n = len(src)
+    out = bytearray()
+    anchor = 0
+    if n > MFLIMIT:
+        table = {}
+        i = 0
+        miss = 0
+        limit = n - LAST_LITERALS
+        while i < n - MFLIMIT:
+            key = src[i:i + 4]
+            cand = table.get(key)
+            table[key] = i
+            if cand is None or i - cand > MAX_OFFSET:
+                miss += 1
+                i += 1 + (miss >> 6)      # 一致しない所は段々飛ばす（lz4 の acceleration と同じ）
+                continue
+            miss = 0
+            # 後ろへは伸ばせるだけ、前へはリテラルの範囲で伸ばす
+            mlen = MIN_MATCH + _match_len(src, cand + MIN_MATCH, i + MIN_MATCH, limit)
+            while i > anchor and cand > 0 and src[i - 1] == src[cand - 1]:
+                i -= 1
+                cand -= 1
+                mlen += 1
+            _put_seq(out, src[anchor:i], mlen, i - cand)
+            i += mlen
+            anchor = i
+            if i - 2 >= 0:
+                table[src[i - 2:i + 2]] = i - 2
+    _put_seq(out, src[anchor:], 0, 0)
+    return bytes(out)
+
+
+def compress(data, bsid=7, block_csum=False):
+    block_max = BLOCK_SIZES[bsid]
+    flg = FLG_VERSION | FLG_BLOCK_INDEP | FLG_CONTENT_SIZE | FLG_CONTENT_CSUM
+    if block_csum:
+        flg |= FLG_BLOCK_CSUM
+    desc = struct.pack("<BBQ", flg, bsid << 4, len(data))
+    out = bytearray(struct.pack("<I", MAGIC) + desc)
+    out.append((xxh32(desc) >> 8) & 0xFF)
+    for off in range(0, len(data), block_max):
+        raw = data[off:off + block_max]
+        blk = compress_block(raw)
+        word = len(blk)
+        if len(blk) >= len(raw):
+            blk, word = raw, len(raw) | BLOCK_RAW
+        out += struct.pack("<I", word) + blk
+        if block_csum:
+            out += struct.pack("<I", xxh32(blk))
+    out += struct.pack("<I", 0)
+    out += struct.pack("<I", xxh32(data))
+    return bytes(out)
+
+
+def decompress_block(src, out, lo):
+    """out の末尾へ展開（lo: マッチが遡れる下限）"""
+    ip = 0
+    n = len(src)
+    while True:
+        token = src[ip]
+        ip += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[ip]
+                ip += 1
+                lit += b
+                if b != 255:
+                    break
+        out += src[ip:ip + lit]
+        ip += lit
+        if ip >= n:
+            return
+        off = src[ip] | (src[ip + 1] << 8)
+        ip += 2
+        mlen = token & 15
+        if mlen == 15:
+            while True:
+                b = src[ip]
+                ip += 1
+                mlen += b
+                if b != 255:
+                    break
+        mlen += MIN_MATCH
+        start = len(out) - off
+        if off == 0 or start < lo:
+            raise ValueError("bad match offset")
+        for k in range(mlen):
+            out.append(out[start + k])
+
+
+def decompress(buf):
+    magic, flg, bd = struct.unpack_from("<IBB", buf, 0)
+    if magic != MAGIC or (flg & 0xC0) != FLG_VERSION or flg & 0x01:
+        raise ValueError("not a supported LZ4 frame")
+    p = 6
+    size = None
+    if flg & FLG_CONTENT_SIZE:
+        size = struct.unpack_from("<Q", buf, p)[0]
+        p += 8
+    if (xxh32(buf[4:p]) >> 8) & 0xFF != buf[p]:
+        raise ValueError("header checksum mismatch")
+    p += 1
+    out = bytearray()
+    while True:
+        word = struct.unpack_from("<I", buf, p)[0]
+        p += 4
+        if word == 0:
+            break
+        blen = word & ~BLOCK_RAW
+        blk = buf[p:p + blen]
+        p += blen
+        if flg & FLG_BLOCK_CSUM:
+            p += 4
+        if word & BLOCK_RAW:
+            out += blk
+        else:
+            decompress_block(blk, out, len(out) if flg & FLG_BLOCK_INDEP else 0)
+    if flg & FLG_CONTENT_CSUM and struct.unpack_from("<I", buf, p)[0] != xxh32(out):
+        raise ValueError("content checksum mismatch")
+    if size is not None and size != len(out):
+        raise ValueError("content size mismatch")
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="LZ4 frame compressor for boot images")
+    ap.add_argument("input")
+    ap.add_argument("output")
+    ap.add_argument("-d", "--decompress", action="store_true")
+    ap.add_argument("-B", "--block-size", type=int, default=7, choices=sorted(BLOCK_SIZES),
+                    help="max block size id (4:64KiB .. 7:4MiB)")
+    ap.add_argument("--block-checksum", action="store_true")
+    args = ap.parse_args()
+
+    data = open(args.input, "rb").read()
+    if args.decompress:
+        out = decompress(data)
+    else:
+        out = compress(data, args.block_size, args.block_checksum)
+        if decompress(out) != data:
+            sys.exit("lz4pack: round trip failed")
+        print("%s: %d -> %d bytes (%.1f%%)" %
+              (args.output, len(data), len(out), 100.0 * len(out) / max(1, len(data))))
+    open(args.output, "wb").write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# 共有メモリログ（kernel/shmlog.{c,h}）を読む。
+#
+#   メモリダンプ :  tools/shmlog_read.py mem.bin          （QEMU monitor の "pmemsave 0 <size> mem.bin" 等）
+#   ivshmem      :  tools/shmlog_read.py /dev/shm/ivshmem --follow
+#   メトリクス   :  ... --metrics          （--json で {"名前": 値} の 1 行）
+#
+# ヘッダの magic "SHMLOG01" を探すので、ファイルの先頭がどの物理アドレスでも良い。
+# 各 CPU セクションはバイトリングなので、一周して切れた先頭の行は捨てる。
+# 行頭の "[    s.us]" でセクションを跨いで時刻順に並べ直す。
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+
+MAGIC = b"SHMLOG01"
+HDR_FMT = "<QIIQIIQQQII"
+HDR_SIZE = struct.calcsize(HDR_FMT)
+SEC_HDR = 64
+METRIC_FMT = "<24sQ"
+METRIC_SIZE = struct.calcsize(METRIC_FMT)
+TS_RE = re.compile(r"^\[\s*(\d+)\.(\d+)\]")
+
+
+def find_header(data):
+    off = 0
+    while True:
+        off = data.find(MAGIC, off)
+        if off < 0:
+            return None
+        f = struct.unpack_from(HDR_FMT, data, off)
+        hdr = dict(zip(("magic", "version", "header_size", "total_size", "nr_sections",
+                        "section_size", "tsc_hz", "phys_base", "write_seq",
+                        "metrics_off", "metrics_count"), f))
+        if hdr["version"] == 1 and hdr["header_size"] >= HDR_SIZE and \
+           off + hdr["total_size"] <= len(data):
+            hdr["off"] = off
+            return hdr
+        off += 1
+
+
+def read_section(data, hdr, i, since=0):
+    """セクション i の since バイト目以降を (新しい head, 行のリスト) で返す"""
+    base = hdr["off"] + hdr["header_size"] + i * hdr["section_size"]
+    head = struct.unpack_from("<Q", data, base)[0]
+    size = hdr["section_size"] - SEC_HDR
+    start = max(since, head - size)
+    ring = data[base + SEC_HDR: base + SEC_HDR + size]
+    out = bytearray()
+    for p in range(start, head):
+        out.append(ring[p % size])
+    text = out.decode("ascii", "replace")
+    lines = text.split("\n")
+    if start > since and lines:
+        lines = lines[1:]                     # 上書きで途中から始まった行
+    return head, [l for l in lines if l]
+
+
+def sort_key(item):
+    cpu, idx, line = item
+    m = TS_RE.match(line)
+    ts = (int(m.group(1)), int(m.group(2))) if m else (0, 0)
+    return (ts, cpu, idx)
+
+
+def dump_lines(data, hdr, positions):
+    items = []
+    for cpu in range(hdr["nr_sections"]):
+        head, lines = read_section(data, hdr, cpu, positions.get(cpu, 0))
+        positions[cpu] = head
+        items += [(cpu, i, l) for i, l in enumerate(lines)]
+    for cpu, _, line in sorted(items, key=sort_key):
+        print("cpu%-2d %s" % (cpu, line))
+    sys.stdout.flush()
+
+
+def read_metrics(data, hdr):
+    base = hdr["off"] + hdr["metrics_off"]
+    out = []
+    for i in range(hdr["metrics_count"]):
+        name, value = struct.unpack_from(METRIC_FMT, data, base + i * METRIC_SIZE)
+        out.append((name.split(b"\0", 1)[0].decode("ascii", "replace"), value))
+    return out
+
+
+def dump_metrics(data, hdr, as_json):
+    metrics = read_metrics(data, hdr)
+    if as_json:
+        print(json.dumps(dict(metrics), sort_keys=True))
+        return
+    for name, value in metrics:
+        print("%-24s %d" % (name, value))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="read the kernel shared-memory log")
+    ap.add_argument("input", help="memory dump or ivshmem backing file")
+    ap.add_argument("--metrics", action="store_true", help="print the metrics table")
+    ap.add_argument("--json", action="store_true", help="with --metrics: one JSON object")
+    ap.add_argument("--follow", action="store_true", help="keep polling for new lines")
+    ap.add_argument("--interval", type=float, default=0.5)
+    args = ap.parse_args()
+
+    data = open(args.input, "rb").read()
+    hdr = find_header(data)
+    if not hdr:
+        sys.exit("shmlog header not found")
+    if args.metrics:
+        dump_metrics(data, hdr, args.json)
+        return
+
+    print("# shmlog phys 0x%x, %d sections x %d bytes, tsc %d Hz" %
+          (hdr["phys_base"], hdr["nr_sections"], hdr["section_size"], hdr["tsc_hz"]))
+
+    positions = {}
+    dump_lines(data, hdr, positions)
+    seq = hdr["write_seq"]
+    while args.follow:
+        time.sleep(args.interval)
+        data = open(args.input, "rb").read()
+        cur = struct.unpack_from("<Q", data, hdr["off"] + 48)[0]   # write_seq
+        if cur != seq:
+            seq = cur
+            dump_lines(data, hdr, positions)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# カーネルのバイナリトレース（kernel/trace.{c,h}）をテキスト / Chrome trace JSON に直す。
+#
+#   シリアルログから :  tools/trace_decode.py serial.log
+#   メモリダンプから :  tools/trace_decode.py --dump mem.bin
+#                        （QEMU monitor の "pmemsave 0 <size> mem.bin" 等。
+#                          g_trace_hdr の magic を探して読むので開始物理アドレスは問わない）
+#   Chrome 形式     :  ... --chrome out.json   （chrome://tracing / Perfetto で開く）
+import argparse
+import json
+import re
+import struct
+import sys
+
+MAGIC = b"TTRACE01"
+HDR_FMT = "<11Q"          # trace_header_t
+REC_FMT = "<QHBBI4Q"      # trace_record_t (48B)
+REC_SIZE = struct.calcsize(REC_FMT)
+EV_NAME_MAX = 24
+EV_FMT_MAX = 64
+
+C_SPEC = re.compile(r"%(0?\d*)(?:ll|l|z|h)?([diuxXpcs%])")
+
+
+def format_args(fmt, args):
+    """C の書式（%llu %llx %lld %p 程度）を Python で展開する"""
+    it = iter(args)
+
+    def sub(m):
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            return "%"
+        v = next(it, 0)
+        if conv in "di":
+            if v >= 1 << 63:
+                v -= 1 << 64
+            return ("%" + flags + "d") % v
+        if conv == "u":
+            return ("%" + flags + "d") % v
+        if conv in "xX":
+            return ("%" + flags + conv) % v
+        if conv == "p":
+            return "0x%016x" % v
+        if conv == "c":
+            return chr(v & 0xFF)
+        return "?"
+
+    return C_SPEC.sub(sub, fmt)
+
+
+def unpack_record(raw):
+    tsc, ev_id, cpu, nargs, _rsv, a0, a1, a2, a3 = struct.unpack(REC_FMT, raw)
+    return {"tsc": tsc, "id": ev_id, "cpu": cpu, "nargs": nargs, "args": [a0, a1, a2, a3]}
+
+
+def parse_serial(path):
+    """行中の "KTRACE ..." を拾う（ログの時刻・レベル前置きは無視）"""
+    events, records, tsc_hz = {}, [], 0
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            i = line.find("KTRACE ")
+            if i < 0:
+                continue
+            body = line[i + 7:].rstrip("\r\n")
+            if body.startswith("BEGIN"):
+                m = re.search(r"tsc_hz=(\d+)", body)
+                tsc_hz = int(m.group(1)) if m else 0
+                events, records = {}, []          # 最後のダンプだけを使う
+            elif body.startswith("EV "):
+                parts = body.split(" ", 3)
+                ev_id, name = int(parts[1]), parts[2]
+                events[ev_id] = (name, parts[3] if len(parts) > 3 else "")
+            elif body.startswith("R "):
+                hexs = body[2:].strip()
+                if len(hexs) != REC_SIZE * 2:
+                    continue                        # 途中で切れた行
+                records.append(unpack_record(bytes.fromhex(hexs)))
+    return events, records, tsc_hz
+
+
+def cstr(b):
+    return b.split(b"\0", 1)[0].decode("ascii", "replace")
+
+
+def parse_dump(path):
+    data = open(path, "rb").read()
+    off = 0
+    while True:
+        off = data.find(MAGIC, off)
+        if off < 0:
+            sys.exit("trace header not found in dump")
+        hdr = struct.unpack_from(HDR_FMT, data, off)
+        (_magic, version, self_va, rings_va, events_va, nr_events,
+         max_cpus, ring_records, record_size, event_size, tsc_hz) = hdr
+        if version == 1 and self_va and record_size == REC_SIZE:
+            break
+        off += 1
+
+    delta = self_va - off                         # 仮想 - ダンプ内オフセット（カーネル像は一定差）
+    events = {}
+    ev_off = events_va - delta
+    for i in range(nr_events):
+        e = data[ev_off + i * event_size: ev_off + (i + 1) * event_size]
+        events[i] = (cstr(e[:EV_NAME_MAX]), cstr(e[EV_NAME_MAX:EV_NAME_MAX + EV_FMT_MAX]))
+
+    ring_stride = (64 + ring_records * record_size + 63) & ~63
+    records = []
+    rings_off = rings_va - delta
+    for cpu in range(max_cpus):
+        base = rings_off + cpu * ring_stride
+        if base + ring_stride > len(data):
+            break
+        head = struct.unpack_from("<Q", data, base)[0]
+        first = head - ring_records if head > ring_records else 0
+        for s in range(first, head):
+            p = base + 64 + (s % ring_records) * record_size
+            records.append(unpack_record(data[p:p + record_size]))
+    return events, records, tsc_hz
+
+
+def main():
+    ap = argparse.ArgumentParser(description="decode kernel binary trace")
+    ap.add_argument("input", help="serial log, or memory dump with --dump")
+    ap.add_argument("--dump", action="store_true", help="input is a raw physical memory dump")
+    ap.add_argument("--chrome", metavar="OUT", help="write Chrome trace JSON to OUT")
+    args = ap.parse_args()
+
+    events, records, tsc_hz = parse_dump(args.input) if args.dump else parse_serial(args.input)
+    records = [r for r in records if r["id"] in events]
+    records.sort(key=lambda r: r["tsc"])
+    if not records:
+        sys.exit("no trace records")
+
+    t0 = records[0]["tsc"]
+    to_us = (lambda c: (c - t0) * 1e6 / tsc_hz) if tsc_hz else (lambda c: float(c - t0))
+
+    if args.chrome:
+        out = []
+        for r in records:
+            name, fmt = events[r["id"]]
+            out.append({
+                "name": name, "ph": "i", "s": "t", "pid": 0, "tid": r["cpu"],
+                "ts": to_us(r["tsc"]),
+                "args": {"msg": format_args(fmt, r["args"][:r["nargs"]])},
+            })
+        with open(args.chrome, "w") as f:
+            json.dump({"traceEvents": out, "displayTimeUnit": "ns"}, f)
+        print("%d events -> %s" % (len(out), args.chrome))
+        return
+
+    unit = "us" if tsc_hz else "cyc"
+    for r in records:
+        name, fmt = events[r["id"]]
+        print("%14.3f%s cpu%-2d %-12s %s" % (to_us(r["tsc"]), unit, r["cpu"], name,
+                                          format_args(fmt, r["args"][:r["nargs"]])))
+
+
+if __name__ == "__main__":
+    main()